@@ -0,0 +1,334 @@
+/*
+  ==============================================================================
+
+    bench.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/engine.h"
+#include "../src/fftbackend.h"
+#include "../src/memfile.h"
+#include "../src/profile.h"
+#include "../src/quantizer.h"
+#include "../src/resamplerpool.h"
+#include "verify.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Frames per block, matching Converter
+static const int blockFrames = 8192;
+
+enum Stage {
+    Decode,
+    Deinterleave,
+    Resample,
+    Interleave,
+    Quantize,
+    Encode,
+    StageCount
+};
+
+static const char* stageNames[StageCount] = {
+    "decode", "deinterleave", "resample", "interleave", "quantize", "encode"
+};
+
+/**
+ * @brief Accumulated cost of one stage.
+ */
+struct StageTime {
+    double seconds = 0.0;
+    uint64_t samples = 0;
+};
+
+/**
+ * @brief One benchmark case: a synthesized source and its timings.
+ */
+struct BenchCase {
+    int rate;
+    int channels;
+    double seconds;
+    StageTime stages[StageCount];
+};
+
+/**
+ * @brief Synthesizes a 24 bit WAV in memory.
+ * Each channel carries a logarithmic sine sweep from 20 Hz to just below
+ * Nyquist at -6 dBFS, offset in phase per channel.
+ * @param file Memory file receiving the encoded WAV.
+ * @param rate Sample rate of the signal.
+ * @param channels Number of channels.
+ * @param frames Length of the signal in frames.
+ * @return bool indicating whether the file was written.
+ */
+static bool synthesize(MemoryFile& file, int rate, int channels, sf_count_t frames)
+{
+    SF_INFO info = {};
+    info.samplerate = rate;
+    info.channels = channels;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_24;
+
+    SNDFILE* sf = file.open(SFM_WRITE, &info);
+    if (!sf) {
+        return false;
+    }
+
+    const double f0 = 20.0;
+    const double f1 = rate * 0.45;
+    const double duration = static_cast<double>(frames) / rate;
+    const double k = std::log(f1 / f0);
+    std::vector<double> block(static_cast<size_t>(blockFrames) * channels);
+
+    for (sf_count_t pos = 0; pos < frames; pos += blockFrames) {
+        int n = static_cast<int>(std::min<sf_count_t>(blockFrames, frames - pos));
+        for (int i = 0; i < n; i++) {
+            double t = static_cast<double>(pos + i) / rate;
+            double phase = R8B_2PI * f0 * duration / k * (std::exp(t / duration * k) - 1.0);
+            for (int c = 0; c < channels; c++) {
+                block[static_cast<size_t>(i) * channels + c] = 0.5 * std::sin(phase + c * 0.5);
+            }
+        }
+        sf_writef_double(sf, block.data(), n);
+    }
+
+    sf_close(sf);
+    return true;
+}
+
+/**
+ * @brief Runs one case through the conversion stages, timing each one.
+ * @param bench Case to run; receives the timings.
+ * @param targetRate Sample rate to convert to.
+ * @param spec Filter parameters of the resamplers.
+ * @param pool Pool the resamplers are taken from.
+ * @return bool indicating whether the case ran.
+ */
+static bool runCase(BenchCase& bench, int targetRate, const ResamplerSpec& spec, ResamplerPool& pool)
+{
+    const int channels = bench.channels;
+    const sf_count_t srcFrames = static_cast<sf_count_t>(bench.rate * bench.seconds);
+
+    MemoryFile source;
+    if (!synthesize(source, bench.rate, channels, srcFrames)) {
+        return false;
+    }
+
+    SF_INFO inInfo = {};
+    SNDFILE* inFile = source.open(SFM_READ, &inInfo);
+    SF_INFO outInfo = inInfo;
+    outInfo.samplerate = targetRate;
+    outInfo.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+    MemoryFile sink;
+    SNDFILE* outFile = sink.open(SFM_WRITE, &outInfo);
+    if (!inFile || !outFile) {
+        return false;
+    }
+
+    std::vector<std::unique_ptr<r8b::CDSPResampler>> resamplers;
+    for (int c = 0; c < channels; c++) {
+        resamplers.push_back(pool.acquire(bench.rate, targetRate, blockFrames, spec));
+    }
+    const int maxOutFrames = resamplers[0]->getMaxOutLen(blockFrames);
+
+    Quantizer quantizer;
+    quantizer.setup(channels, SampleFormat::PCM16, false, DitherMode::TPDF, NoiseShape::None);
+
+    std::vector<double> inBlock(static_cast<size_t>(blockFrames) * channels);
+    std::vector<double> chanBlock(blockFrames);
+    std::vector<std::vector<double>> resampled(channels, std::vector<double>(maxOutFrames));
+    std::vector<double> outBlock(static_cast<size_t>(maxOutFrames) * channels);
+    std::vector<unsigned char> pcmBlock(outBlock.size() * sizeof(short));
+
+    const sf_count_t outTotal = static_cast<sf_count_t>(
+        std::ceil(srcFrames * static_cast<double>(targetRate) / bench.rate));
+    sf_count_t written = 0;
+    bool endOfInput = false;
+
+    auto timed = [&](Stage stage, uint64_t samples, auto&& fn) {
+        Clock::time_point start = Clock::now();
+        fn();
+        bench.stages[stage].seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        bench.stages[stage].samples += samples;
+    };
+
+    while (written < outTotal) {
+        sf_count_t got = 0;
+        if (!endOfInput) {
+            timed(Decode, 0, [&]() { got = sf_readf_double(inFile, inBlock.data(), blockFrames); });
+            bench.stages[Decode].samples += got * channels;
+        }
+        if (got < blockFrames) {
+            std::fill(inBlock.begin() + got * channels, inBlock.end(), 0.0);
+            endOfInput = true;
+        }
+
+        int outFrames = 0;
+        for (int c = 0; c < channels; c++) {
+            timed(Deinterleave, blockFrames, [&]() {
+                deinterleave(inBlock.data(), channels, c, blockFrames, chanBlock.data());
+            });
+
+            double* op;
+            timed(Resample, blockFrames, [&]() {
+                outFrames = resamplers[c]->process(chanBlock.data(), blockFrames, op);
+            });
+
+            timed(Interleave, outFrames, [&]() {
+                interleave(op, channels, c, outFrames, outBlock.data());
+            });
+        }
+
+        int toWrite = static_cast<int>(std::min<sf_count_t>(outFrames, outTotal - written));
+        if (toWrite > 0) {
+            timed(Quantize, static_cast<uint64_t>(toWrite) * channels, [&]() {
+                quantizer.process(outBlock.data(), pcmBlock.data(), toWrite);
+            });
+            timed(Encode, static_cast<uint64_t>(toWrite) * channels, [&]() {
+                sf_write_raw(outFile, pcmBlock.data(), static_cast<sf_count_t>(toWrite) * quantizer.getFrameBytes());
+            });
+            written += toWrite;
+        }
+    }
+
+    sf_close(inFile);
+    sf_close(outFile);
+
+    for (int c = 0; c < channels; c++) {
+        pool.release(bench.rate, targetRate, blockFrames, std::move(resamplers[c]), spec);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Formats the cost of a stage as a JSON object.
+ * @param stage Accumulated cost of the stage.
+ * @param audioSeconds Length of the source audio in seconds.
+ * @return std::string containing the JSON object.
+ */
+static std::string stageJson(const StageTime& stage, double audioSeconds)
+{
+    std::ostringstream ss;
+    double rate = stage.seconds > 0.0 ? stage.samples / stage.seconds : 0.0;
+    double realtime = stage.seconds > 0.0 ? audioSeconds / stage.seconds : 0.0;
+    ss << "{\"seconds\": " << stage.seconds << ", \"samples\": " << stage.samples
+       << ", \"samples_per_sec\": " << rate << ", \"realtime\": " << realtime << "}";
+    return ss.str();
+}
+
+/**
+ * @brief Prints the command line usage.
+ * @param program Name the program was invoked with.
+ */
+static void printUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [-r RATE] [-q QUALITY] [-o FILE] [--long]"
+              << " [--verify] [--budget FILE] [--record-budget FILE]" << std::endl;
+    std::cout << "  -r RATE    Target sample rate in Hz (default: 48000)" << std::endl;
+    std::cout << "  -q QUALITY Resampler quality: draft, standard, high, minphase (default: standard)" << std::endl;
+    std::cout << "  -o FILE    Write the JSON report to FILE instead of stdout" << std::endl;
+    std::cout << "  --long     Also run 10 minute sources" << std::endl;
+    std::cout << "  --verify   Check accuracy (and throughput, with --budget) instead, exit 1 on failure" << std::endl;
+    std::cout << "  --budget FILE        Also check throughput against this budget (default: none)" << std::endl;
+    std::cout << "  --record-budget FILE Write a budget from this machine's throughput instead of checking it" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int targetRate = 48000;
+    std::string quality = "standard";
+    ResamplerSpec spec;
+    std::string outPath;
+    bool longRuns = false;
+    bool verify = false;
+    VerifyOptions verifyOptions;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-r" && i + 1 < argc) {
+            targetRate = std::atoi(argv[++i]);
+        } else if (arg == "-q" && i + 1 < argc) {
+            quality = argv[++i];
+            if (!parseResamplerQuality(quality, spec)) {
+                std::cerr << "Unknown resampler quality: " << quality << std::endl;
+                return 1;
+            }
+        } else if (arg == "-o" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (arg == "--long") {
+            longRuns = true;
+        } else if (arg == "--verify") {
+            verify = true;
+        } else if (arg == "--budget" && i + 1 < argc) {
+            verifyOptions.budgetPath = argv[++i];
+        } else if (arg == "--record-budget" && i + 1 < argc) {
+            verify = true;
+            verifyOptions.recordPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (verify) {
+        return runVerify(verifyOptions);
+    }
+
+    const int rates[] = { 22050, 44100, 48000, 88200, 96000, 192000 };
+    const int channelCounts[] = { 1, 2 };
+    std::vector<double> durations = { 1.0, 10.0, 60.0 };
+    if (longRuns) {
+        durations.push_back(600.0);
+    }
+
+    ResamplerPool pool;
+    std::ostringstream json;
+    json << "{\n  \"r8brain\": \"" << R8B_VERSION << "\",\n  \"fft\": \"" << getFFTBackendName()
+         << "\",\n  \"target_rate\": " << targetRate << ",\n  \"quality\": \"" << quality
+         << "\",\n  \"cases\": [";
+
+    bool first = true;
+    for (int rate : rates) {
+        for (int channels : channelCounts) {
+            for (double seconds : durations) {
+                BenchCase bench = { rate, channels, seconds, {} };
+                std::cerr << "Running.. " << rate << " Hz, " << channels << " ch, " << seconds << " s" << std::endl;
+                if (!runCase(bench, targetRate, spec, pool)) {
+                    std::cerr << "Error running case." << std::endl;
+                    return 1;
+                }
+
+                StageTime total;
+                json << (first ? "\n" : ",\n") << "    {\"rate\": " << rate << ", \"channels\": " << channels
+                     << ", \"seconds\": " << seconds << ", \"stages\": {";
+                for (int s = 0; s < StageCount; s++) {
+                    json << (s ? ", " : "") << "\"" << stageNames[s] << "\": " << stageJson(bench.stages[s], seconds);
+                    total.seconds += bench.stages[s].seconds;
+                }
+                total.samples = bench.stages[Decode].samples;
+                json << "}, \"total\": " << stageJson(total, seconds) << "}";
+                first = false;
+            }
+        }
+    }
+    json << "\n  ]\n}\n";
+
+    if (outPath.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(outPath);
+        out << json.str();
+    }
+
+    return 0;
+}
@@ -0,0 +1,624 @@
+/*
+  ==============================================================================
+
+    verify.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "verify.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+#include "../src/audioio.h"
+#include "../src/converter.h"
+#include "../src/engine.h"
+#include "../src/fftbackend.h"
+#include "../src/json.h"
+#include "../src/mappedfile.h"
+#include "../src/memfile.h"
+#include "../src/profile.h"
+#include "../src/quantizer.h"
+#include "../src/scheduler.h"
+#include "../src/slicer.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Frames per block, matching Converter
+static const int blockFrames = 8192;
+
+// Level of every test tone, -6 dBFS
+static const double toneAmp = 0.5;
+// Length of every test tone
+static const double toneSeconds = 1.0;
+// Cut from both ends of a tone before measuring, past the filters' ringing
+static const double edgeSeconds = 0.1;
+// Number of tones the passband and the stop-band are probed with
+static const int rippleTones = 12;
+static const int stopTones = 8;
+
+// Length of the source each preset's throughput is measured on
+static const double throughputSeconds = 20.0;
+// Share of the measured throughput a recorded budget asks for, leaving
+// room for timing noise between runs
+static const double budgetHeadroom = 0.7;
+
+/**
+ * @brief What a quality tier has to achieve at every rate pair.
+ */
+struct TierLimits {
+    const char* name;
+    // Of a 997 Hz tone, before quantization
+    double minSnr;
+    // Peak to peak, from 20 Hz to the top of the passband
+    double maxRipple;
+    // Worst rejection of aliases when downsampling and of images when upsampling
+    double minStopband;
+    // Source time the resamplers hold back before their first output
+    double maxLatencyMs;
+    // Shift of the output against the source, in output frames
+    double maxDelay;
+};
+
+// Measured with the double precision FFT, less a margin; minimum-phase
+// filters are not linear-phase, so their output may shift
+static const TierLimits tierLimits[] = {
+    { "draft", 113.0, 0.0002, 101.0, 12.0, 0.001 },
+    { "standard", 143.0, 0.00002, 128.0, 90.0, 0.001 },
+    { "high", 175.0, 0.000001, 172.0, 85.0, 0.001 },
+    { "minphase", 143.0, 0.001, 128.0, 75.0, 1.0 },
+};
+
+// A single precision FFT holds every tier to about 130 dB and adds ripple
+// to minimum-phase filters, which is still plenty for 16 bit output
+static const double floatMinSnr = 127.0;
+static const double floatMaxRipple = 0.06;
+
+// Rate pairs every tier is checked at, up and down and by whole factors
+static const int ratePairs[][2] = {
+    { 44100, 48000 }, { 48000, 44100 }, { 96000, 44100 }, { 22050, 44100 },
+};
+
+static const char* presetNames[] = { "sp404", "cd", "mono44", "hires", "sp1200", "s950", "aiff", "ulaw" };
+
+// Rate of the stereo source every preset converts from
+static const int presetSourceRate = 96000;
+
+/**
+ * @brief Lowest SNR a preset's decoded output may have, set by its sample format.
+ * A -6 dBFS tone with TPDF dither sits about 87 dB above the noise at 16 bit.
+ * @param format Sample format of the output.
+ * @return SNR in dB.
+ */
+static double getMinOutputSnr(SampleFormat format)
+{
+    switch (format) {
+        case SampleFormat::PCM24: return 130.0;
+        case SampleFormat::PCM12: return 60.0;
+        case SampleFormat::ULaw: return 35.0;
+        default: return 85.0;
+    }
+}
+
+/**
+ * @brief Amplitude, phase and leftover of a tone fitted to a signal.
+ */
+struct ToneFit {
+    // Amplitude relative to toneAmp
+    double gain = 0.0;
+    // Mean square of what the tone does not explain
+    double residual = 0.0;
+    // How far the tone lags the source, in frames
+    double delay = 0.0;
+};
+
+/**
+ * @brief Counts the checks of a run and reports the failed ones.
+ */
+struct CheckLog {
+    int checks = 0;
+    int failures = 0;
+    std::ostringstream failed;
+
+    /**
+     * @brief Records one measurement against its limit.
+     * @param what Name of the measurement.
+     * @param value Measured value.
+     * @param limit Limit the value must not cross.
+     * @param atLeast Whether the value must be at least the limit, rather than at most.
+     */
+    void check(const char* what, double value, double limit, bool atLeast)
+    {
+        checks++;
+        if (atLeast ? value >= limit : value <= limit) {
+            return;
+        }
+        failures++;
+        failed << " " << what << " " << value << (atLeast ? " < " : " > ") << limit << ";";
+    }
+
+    /**
+     * @brief Ends the line of a case, listing what it failed.
+     * @param out Stream to print to.
+     */
+    void endCase(std::ostream& out)
+    {
+        const std::string text = failed.str();
+        out << (text.empty() ? "  ok" : "  [!] FAILED:" + text) << std::endl;
+        failed.str("");
+    }
+};
+
+/**
+ * @brief Gets the phase of a tone at a frame, kept accurate over long signals.
+ * @param frame Index of the frame.
+ * @param freq Frequency of the tone in Hz.
+ * @param rate Sample rate of the signal.
+ * @return Phase in radians.
+ */
+static double tonePhase(sf_count_t frame, double freq, int rate)
+{
+    const double cycles = static_cast<double>(frame) * freq / rate;
+    return R8B_2PI * (cycles - std::floor(cycles));
+}
+
+/**
+ * @brief Converts a mono tone through an engine.
+ * @param engine Engine set up for the rates and filter to check.
+ * @param srcRate Sample rate of the source.
+ * @param dstRate Sample rate of the output.
+ * @param freq Frequency of the tone in Hz.
+ * @param out Receives the output, cut to the length of the source.
+ */
+static void convertTone(ConversionEngine& engine, int srcRate, int dstRate, double freq, std::vector<double>& out)
+{
+    const sf_count_t srcFrames = static_cast<sf_count_t>(srcRate * toneSeconds);
+    const size_t outTotal = static_cast<size_t>(std::ceil(srcFrames * static_cast<double>(dstRate) / srcRate));
+    std::vector<double> block(blockFrames);
+
+    engine.reset();
+    out.clear();
+    for (sf_count_t pos = 0; out.size() < outTotal; pos += blockFrames) {
+        for (int i = 0; i < blockFrames; i++) {
+            block[i] = pos + i < srcFrames ? toneAmp * std::sin(tonePhase(pos + i, freq, srcRate)) : 0.0;
+        }
+        const double* outBlock;
+        const int outFrames = engine.process(block.data(), blockFrames, outBlock);
+        out.insert(out.end(), outBlock, outBlock + std::min<size_t>(outFrames, outTotal - out.size()));
+    }
+}
+
+/**
+ * @brief Fits a tone of known frequency to a signal by least squares.
+ * The ends of the signal are left out.
+ * @param signal Samples of one channel.
+ * @param stride Distance between the samples of the channel.
+ * @param frames Number of frames in the signal.
+ * @param freq Frequency of the tone in Hz.
+ * @param rate Sample rate of the signal.
+ * @return The fitted tone.
+ */
+static ToneFit fitTone(const double* signal, int stride, size_t frames, double freq, int rate)
+{
+    const size_t edge = static_cast<size_t>(edgeSeconds * rate);
+    double ss = 0.0, cc = 0.0, sc = 0.0, ys = 0.0, yc = 0.0;
+    for (size_t i = edge; i + edge < frames; i++) {
+        const double phase = tonePhase(static_cast<sf_count_t>(i), freq, rate);
+        const double s = std::sin(phase);
+        const double c = std::cos(phase);
+        const double y = signal[i * stride];
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        ys += y * s;
+        yc += y * c;
+    }
+    const double det = ss * cc - sc * sc;
+    const double a = (ys * cc - yc * sc) / det;
+    const double b = (yc * ss - ys * sc) / det;
+
+    double residual = 0.0;
+    for (size_t i = edge; i + edge < frames; i++) {
+        const double phase = tonePhase(static_cast<sf_count_t>(i), freq, rate);
+        const double e = signal[i * stride] - a * std::sin(phase) - b * std::cos(phase);
+        residual += e * e;
+    }
+
+    ToneFit fit;
+    fit.gain = std::hypot(a, b) / toneAmp;
+    fit.residual = residual / (frames - 2 * edge);
+    fit.delay = -std::atan2(b, a) * rate / (R8B_2PI * freq);
+    return fit;
+}
+
+/**
+ * @brief Gets the level of the source tone over some power, in dB.
+ * @param power Mean square to compare the tone with.
+ * @return Ratio in dB, capped where double precision runs out.
+ */
+static double getToneRatio(double power)
+{
+    return 10.0 * std::log10(toneAmp * toneAmp * 0.5 / std::max(power, 1e-30));
+}
+
+/**
+ * @brief Checks the filter of one quality tier at one rate pair.
+ * @param limits Tier to check.
+ * @param srcRate Sample rate of the source.
+ * @param dstRate Sample rate of the output.
+ * @param log Receives the results.
+ */
+static void verifyTier(const TierLimits& limits, int srcRate, int dstRate, CheckLog& log)
+{
+    ResamplerSpec spec;
+    parseResamplerQuality(limits.name, spec);
+    ConversionEngine engine;
+    engine.setup(srcRate, dstRate, 1, 1, blockFrames, spec);
+    std::vector<double> out;
+
+    // A mid-band tone carries the SNR and shows the delay of the output
+    convertTone(engine, srcRate, dstRate, 997.0, out);
+    const ToneFit tone = fitTone(out.data(), 1, out.size(), 997.0, dstRate);
+    const double snr = getToneRatio(tone.residual) + 20.0 * std::log10(tone.gain);
+    const double latencyMs = engine.getPrimingFrames() * 1000.0 / srcRate;
+
+    // The response is flat up to twice the transition band below the
+    // lower Nyquist frequency, as the band reaches down to the -3 dB point
+    const double nyquist = std::min(srcRate, dstRate) * 0.5;
+    const double band = spec.transBand / 100.0;
+    const double passEdge = nyquist * (1.0 - 2.0 * band);
+    double minGain = 1e9, maxGain = -1e9;
+    for (int k = 0; k < rippleTones; k++) {
+        const double freq = 20.0 * std::pow(passEdge / 20.0, static_cast<double>(k) / (rippleTones - 1));
+        convertTone(engine, srcRate, dstRate, freq, out);
+        const double gain = 20.0 * std::log10(fitTone(out.data(), 1, out.size(), freq, dstRate).gain);
+        minGain = std::min(minGain, gain);
+        maxGain = std::max(maxGain, gain);
+    }
+
+    // Downsampling, tones above the output's Nyquist frequency must all
+    // but vanish; upsampling, tones near the source's Nyquist frequency
+    // must leave no images behind
+    double stopband = 1e9;
+    const double stopFirst = dstRate < srcRate ? nyquist * (1.0 + band) : nyquist * 0.5;
+    const double stopLast = dstRate < srcRate ? srcRate * 0.5 * 0.95 : nyquist * (1.0 - band);
+    for (int k = 0; k < stopTones && stopFirst < stopLast; k++) {
+        const double freq = stopFirst + (stopLast - stopFirst) * k / (stopTones - 1);
+        convertTone(engine, srcRate, dstRate, freq, out);
+        double power;
+        if (dstRate < srcRate) {
+            const size_t edge = static_cast<size_t>(edgeSeconds * dstRate);
+            power = 0.0;
+            for (size_t i = edge; i + edge < out.size(); i++) {
+                power += out[i] * out[i];
+            }
+            power /= out.size() - 2 * edge;
+        } else {
+            power = fitTone(out.data(), 1, out.size(), freq, dstRate).residual;
+        }
+        stopband = std::min(stopband, getToneRatio(power));
+    }
+
+    // Downsampling by a little leaves no room above the transition band
+    char stopText[16] = "     -";
+    if (stopFirst < stopLast) {
+        std::snprintf(stopText, sizeof(stopText), "%6.1f", stopband);
+    }
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-8s %6d -> %6d  snr %6.1f dB  ripple %.6f dB  stop-band %s dB  "
+                  "latency %5.2f ms  delay %6.3f", limits.name, srcRate, dstRate, snr, maxGain - minGain,
+                  stopText, latencyMs, tone.delay);
+    std::cout << line;
+    const bool singlePrecision = std::string(getFFTBackendName()) == "pffft";
+    log.check("snr", snr, singlePrecision ? std::min(limits.minSnr, floatMinSnr) : limits.minSnr, true);
+    log.check("ripple", maxGain - minGain,
+              singlePrecision ? std::max(limits.maxRipple, floatMaxRipple) : limits.maxRipple, false);
+    if (stopFirst < stopLast) {
+        log.check("stop-band", stopband,
+                  singlePrecision ? std::min(limits.minStopband, floatMinSnr) : limits.minStopband, true);
+    }
+    log.check("latency", latencyMs, limits.maxLatencyMs, false);
+    log.check("delay", std::fabs(tone.delay), limits.maxDelay, false);
+    log.endCase(std::cout);
+}
+
+/**
+ * @brief Converts a stereo tone the way Converter does for a preset.
+ * The source carries the same tone on both channels, so mixing it down
+ * leaves it as it is.
+ * @param profile Output profile to convert to.
+ * @param seconds Length of the source.
+ * @param engine Engine to convert with, set up for the preset.
+ * @param quantizer Quantizer to convert with, set up for the preset.
+ * @param pcm Receives the encoded output.
+ * @return Seconds spent resampling and quantizing.
+ */
+static double convertPreset(const OutputProfile& profile, double seconds, ConversionEngine& engine,
+                            Quantizer& quantizer, std::vector<unsigned char>& pcm)
+{
+    const sf_count_t srcFrames = static_cast<sf_count_t>(presetSourceRate * seconds);
+    const sf_count_t outTotal = engine.isPassthrough() ? srcFrames : static_cast<sf_count_t>(
+        std::ceil(srcFrames * static_cast<double>(profile.sampleRate) / presetSourceRate));
+    const int frameBytes = quantizer.getFrameBytes();
+
+    // The tone is synthesized up front, so only the conversion is timed
+    std::vector<double> source(static_cast<size_t>(srcFrames + blockFrames) * 2, 0.0);
+    for (sf_count_t i = 0; i < srcFrames; i++) {
+        source[i * 2] = source[i * 2 + 1] = toneAmp * std::sin(tonePhase(i, 997.0, presetSourceRate));
+    }
+    std::vector<double> silence(static_cast<size_t>(blockFrames) * 2, 0.0);
+    pcm.resize(static_cast<size_t>(outTotal + engine.getMaxOutFrames()) * frameBytes);
+
+    const Clock::time_point start = Clock::now();
+    sf_count_t written = 0;
+    for (sf_count_t pos = 0; written < outTotal; pos += blockFrames) {
+        const double* in = pos < srcFrames ? source.data() + pos * 2 : silence.data();
+        const double* outBlock;
+        const int outFrames = engine.process(in, blockFrames, outBlock);
+        const int toWrite = static_cast<int>(std::min<sf_count_t>(outFrames, outTotal - written));
+        quantizer.process(outBlock, pcm.data() + written * frameBytes, toWrite);
+        written += toWrite;
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    pcm.resize(static_cast<size_t>(outTotal) * frameBytes);
+    return elapsed;
+}
+
+/**
+ * @brief Checks the decoded output of a preset and measures its throughput.
+ * @param name Name of the preset.
+ * @param budget Lowest realtime factor allowed for the preset, 0 for none.
+ * @param log Receives the results.
+ * @return Realtime factor measured, 0 if the output could not be checked.
+ */
+static double verifyPreset(const char* name, double budget, CheckLog& log)
+{
+    OutputProfile profile;
+    findPreset(name, profile);
+    const int channels = profile.channels > 0 ? profile.channels : 2;
+
+    ConversionEngine engine;
+    engine.setup(presetSourceRate, profile.sampleRate, 2, channels, blockFrames, profile.resampler);
+    Quantizer quantizer;
+    quantizer.setup(channels, profile.format, profile.container == Container::AIFF, DitherMode::TPDF,
+                    NoiseShape::None);
+    std::vector<unsigned char> pcm;
+    convertPreset(profile, toneSeconds, engine, quantizer, pcm);
+
+    // Encoded into the preset's container and decoded back, natively
+    // where Converter would and by libsndfile otherwise
+    SF_INFO info = {};
+    info.samplerate = profile.sampleRate;
+    info.channels = channels;
+    info.format = getSndfileFormat(profile);
+    const sf_count_t frames = static_cast<sf_count_t>(pcm.size() / quantizer.getFrameBytes());
+    std::vector<unsigned char> bytes;
+    MemoryFile file;
+    MappedWriter mappedWriter;
+    SndfileWriter sndfileWriter;
+    AudioWriter* writer = nullptr;
+    if (mappedWriter.open(bytes, profile.container, profile.format, profile.sampleRate, channels, frames)) {
+        writer = &mappedWriter;
+    } else if (sndfileWriter.open(file, info, quantizer.getFrameBytes())) {
+        writer = &sndfileWriter;
+    }
+    bool ok = writer && writer->write(pcm.data(), frames) == frames;
+    ok = writer && writer->close() && ok;
+    if (writer == &sndfileWriter) {
+        bytes = file.getBytes();
+    }
+
+    MemoryFile encoded(bytes);
+    MappedReader mappedReader;
+    SndfileReader sndfileReader;
+    AudioReader* reader = nullptr;
+    if (mappedReader.open(bytes.data(), bytes.size(), info)) {
+        reader = &mappedReader;
+    } else if (sndfileReader.open(encoded, info)) {
+        reader = &sndfileReader;
+    }
+    std::vector<double> decoded(static_cast<size_t>(frames) * channels);
+    ok = ok && reader && reader->read(decoded.data(), frames) == frames;
+    if (reader) {
+        reader->close();
+    }
+    if (!ok) {
+        std::cerr << "Error encoding the output of preset " << name << "." << std::endl;
+        log.checks++;
+        log.failures++;
+        return 0.0;
+    }
+
+    double snr = 1e9;
+    for (int c = 0; c < channels; c++) {
+        const ToneFit fit = fitTone(decoded.data() + c, channels, static_cast<size_t>(frames), 997.0,
+                                    profile.sampleRate);
+        snr = std::min(snr, getToneRatio(fit.residual) + 20.0 * std::log10(fit.gain));
+    }
+
+    // Throughput of resampling and quantizing, best of three
+    double best = 1e9;
+    for (int run = 0; run < 3; run++) {
+        engine.reset();
+        quantizer.setup(channels, profile.format, profile.container == Container::AIFF, DitherMode::TPDF,
+                        NoiseShape::None);
+        best = std::min(best, convertPreset(profile, throughputSeconds, engine, quantizer, pcm));
+    }
+    const double realtime = throughputSeconds / best;
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-8s %6d -> %6d  %-22s snr %6.1f dB  realtime %7.1fx", name,
+                  presetSourceRate, profile.sampleRate, describeProfile(profile).c_str(), snr, realtime);
+    std::cout << line;
+    log.check("snr", snr, getMinOutputSnr(profile.format), true);
+    if (budget > 0.0) {
+        log.check("realtime", realtime, budget, true);
+    }
+    log.endCase(std::cout);
+    return realtime;
+}
+
+/**
+ * @brief Checks that slicing a long source gives the output of a serial run.
+ * @param log Receives the result.
+ */
+static void verifySlicing(CheckLog& log)
+{
+    const int srcRate = 44100;
+    const int dstRate = 48000;
+    const sf_count_t srcFrames = static_cast<sf_count_t>(2.5 * (1 << 20));
+    const sf_count_t outTotal = static_cast<sf_count_t>(std::ceil(srcFrames * static_cast<double>(dstRate) / srcRate));
+
+    // The source is a 24 bit WAV in memory, as the slices read it through their own readers
+    SF_INFO info = {};
+    info.samplerate = srcRate;
+    info.channels = 1;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_24;
+    MemoryFile file;
+    SNDFILE* sf = file.open(SFM_WRITE, &info);
+    if (!sf) {
+        std::cerr << "Error synthesizing the slicing source." << std::endl;
+        log.checks++;
+        log.failures++;
+        return;
+    }
+    std::vector<double> block(blockFrames);
+    for (sf_count_t pos = 0; pos < srcFrames; pos += blockFrames) {
+        const int n = static_cast<int>(std::min<sf_count_t>(blockFrames, srcFrames - pos));
+        for (int i = 0; i < n; i++) {
+            block[i] = toneAmp * std::sin(tonePhase(pos + i, 997.0, srcRate)) +
+                       0.1 * std::sin(tonePhase(pos + i, 15013.0, srcRate));
+        }
+        sf_writef_double(sf, block.data(), n);
+    }
+    sf_close(sf);
+
+    // Serially, as Converter streams a file
+    ConversionEngine engine;
+    engine.setup(srcRate, dstRate, 1, 1, blockFrames);
+    Quantizer quantizer;
+    quantizer.setup(1, SampleFormat::PCM16, false, DitherMode::TPDF, NoiseShape::None);
+    MappedReader reader;
+    MappedWriter writer;
+    std::vector<unsigned char> serial;
+    std::vector<unsigned char> pcmBlock(static_cast<size_t>(engine.getMaxOutFrames()) * quantizer.getFrameBytes());
+    bool ok = reader.open(file.getBytes().data(), file.getBytes().size(), info) &&
+              writer.open(serial, Container::WAV, SampleFormat::PCM16, dstRate, 1, outTotal);
+    sf_count_t written = 0;
+    while (ok && written < outTotal) {
+        const sf_count_t got = reader.read(block.data(), blockFrames);
+        std::fill(block.begin() + got, block.end(), 0.0);
+        const double* outBlock;
+        const int outFrames = engine.process(block.data(), blockFrames, outBlock);
+        const int toWrite = static_cast<int>(std::min<sf_count_t>(outFrames, outTotal - written));
+        quantizer.process(outBlock, pcmBlock.data(), toWrite);
+        ok = writer.write(pcmBlock.data(), toWrite) == toWrite;
+        written += toWrite;
+    }
+    ok = writer.close() && ok;
+
+    // Sliced on two workers, whatever the machine has
+    TaskScheduler scheduler(2);
+    Slicer slicer;
+    ConversionEngine sliceEngine;
+    sliceEngine.setup(srcRate, dstRate, 1, 1, blockFrames);
+    quantizer.setup(1, SampleFormat::PCM16, false, DitherMode::TPDF, NoiseShape::None);
+    std::vector<unsigned char> sliced;
+    sf_count_t rFrames, wFrames;
+    const bool planned = slicer.plan(sliceEngine, srcFrames, scheduler.getThreadCount());
+    ok = ok && planned && writer.open(sliced, Container::WAV, SampleFormat::PCM16, dstRate, 1, outTotal) &&
+         slicer.run(reader, writer, sliceEngine, quantizer, scheduler, blockFrames, outTotal, rFrames, wFrames);
+    ok = writer.close() && ok;
+    reader.close();
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "slicing  %6d -> %6d  %lld frames, %s", srcRate, dstRate,
+                  static_cast<long long>(srcFrames), planned ? "sliced" : "not sliced");
+    std::cout << line;
+    log.check("identical", ok && serial == sliced ? 1.0 : 0.0, 1.0, true);
+    log.endCase(std::cout);
+}
+
+/**
+ * @brief Loads the lowest realtime factor allowed for each preset.
+ * @param path Path of the budget, a JSON object of preset names and factors.
+ * @param budget Receives the factors.
+ * @return bool indicating whether the budget could be read.
+ */
+static bool loadBudget(const std::string& path, std::map<std::string, double>& budget)
+{
+    std::ifstream file(path);
+    std::stringstream text;
+    text << file.rdbuf();
+    std::map<std::string, std::string> fields;
+    if (!file || !parseJsonObject(text.str(), fields)) {
+        return false;
+    }
+    for (const auto& field : fields) {
+        budget[field.first] = std::atof(field.second.c_str());
+    }
+    return true;
+}
+
+/**
+ * @brief Checks accuracy and throughput against fixed limits.
+ * Every quality tier is checked at several rate pairs for SNR, passband
+ * ripple, stop-band rejection, latency and the alignment of its output.
+ * Every preset converts a 96 kHz stereo tone whose decoded output must
+ * keep the SNR its sample format allows and, if a budget is given, must be
+ * converted at least as fast as it asks. Slicing must give the output of
+ * a serial run.
+ * @param options Budget to check against or to record.
+ * @return Exit code of the program, 1 if any check failed.
+ */
+int runVerify(const VerifyOptions& options)
+{
+    // Throughput depends on the machine, so it is only checked against a
+    // budget asked for explicitly; the quality checks always run
+    std::map<std::string, double> budget;
+    const bool recording = !options.recordPath.empty();
+    if (!recording && !options.budgetPath.empty() && !loadBudget(options.budgetPath, budget)) {
+        std::cerr << "Error reading the throughput budget " << options.budgetPath << "." << std::endl;
+        return 1;
+    }
+
+    CheckLog log;
+    std::cout << "Quality tiers:" << std::endl;
+    for (const TierLimits& limits : tierLimits) {
+        for (const auto& pair : ratePairs) {
+            verifyTier(limits, pair[0], pair[1], log);
+        }
+    }
+
+    std::cout << "Presets:" << std::endl;
+    std::ostringstream recorded;
+    for (const char* name : presetNames) {
+        const double realtime = verifyPreset(name, recording ? 0.0 : budget[name], log);
+        char factor[32];
+        std::snprintf(factor, sizeof(factor), "%.1f", realtime * budgetHeadroom);
+        recorded << (recorded.tellp() > 0 ? ",\n" : "{\n") << "  \"" << name << "\": " << factor;
+    }
+
+    verifySlicing(log);
+
+    if (recording) {
+        std::ofstream file(options.recordPath, std::ios::trunc);
+        file << recorded.str() << "\n}\n";
+        if (!file.good()) {
+            std::cerr << "Error writing the throughput budget." << std::endl;
+            return 1;
+        }
+        std::cout << "Budget written to " << options.recordPath << std::endl;
+    }
+
+    std::cout << log.checks - log.failures << " of " << log.checks << " checks passed" << std::endl;
+    return log.failures > 0 ? 1 : 0;
+}
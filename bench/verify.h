@@ -0,0 +1,28 @@
+/*
+  ==============================================================================
+
+    verify.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <string>
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+/**
+ * @brief Where runVerify() reads and writes the throughput budget.
+ */
+struct VerifyOptions {
+    // Budget the measured throughput is checked against, none if empty
+    std::string budgetPath;
+    // Writes a new budget from this run instead of checking it, if set
+    std::string recordPath;
+};
+
+int runVerify(const VerifyOptions& options);
+
+#endif /* VERIFY_H */
@@ -0,0 +1,284 @@
+/*
+  ==============================================================================
+
+    arena.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "arena.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+namespace arena {
+
+// Size classes hold 64 bytes << class, larger blocks bypass the cache
+static const int minShift = 6;
+static const int classCount = 21;
+static const uint32_t largeClass = classCount;
+
+// Idle memory all threads together keep cached at most, and the least
+// one thread may keep however many there are, in bytes
+static const size_t maxTotalCachedBytes = size_t(1) << 30;
+static const size_t minThreadCachedBytes = size_t(16) << 20;
+
+// Idle memory one thread keeps cached at most, set by setThreadCount()
+static std::atomic<size_t> maxCachedBytes{size_t(256) << 20};
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+/**
+ * @brief Free lists of one thread.
+ * Allocated once and never freed, so blocks can always be returned to
+ * their owner; when the thread exits its lists are emptied and the cache
+ * is handed to the next thread that needs one.
+ */
+struct ThreadCache {
+    FreeBlock* lists[classCount] = {};
+    std::atomic<size_t> cachedBytes{0};
+    // Blocks other threads freed, taken over by the owner on its next miss
+    std::atomic<FreeBlock*> remote{nullptr};
+    std::atomic<size_t> remoteBytes{0};
+    // Next cache waiting for a new owner
+    ThreadCache* nextOrphan = nullptr;
+};
+
+// Every block is preceded by a header, which keeps the payload aligned
+// as strictly as malloc's own
+struct alignas(alignof(std::max_align_t)) Header {
+    uint32_t sizeClass;
+    size_t size;
+    ThreadCache* owner;
+};
+
+// Caches of exited threads, waiting for a new owner
+static std::mutex orphanMutex;
+static ThreadCache* orphans = nullptr;
+
+static std::atomic<size_t> systemAllocs{0};
+
+/**
+ * @brief Cache a thread uses.
+ * Trivially destructible so it stays usable while other thread_local
+ * and static objects are torn down; the Drain guard gives it up instead,
+ * after which blocks go straight to and from malloc.
+ */
+struct ThreadState {
+    ThreadCache* cache;
+    bool dead;
+};
+
+thread_local ThreadState state = {};
+
+static void freeList(FreeBlock* block)
+{
+    while (block) {
+        FreeBlock* next = block->next;
+        std::free(reinterpret_cast<Header*>(block) - 1);
+        block = next;
+    }
+}
+
+/**
+ * @brief Returns a thread's cached blocks to malloc when the thread exits.
+ * The emptied cache is handed to the next thread that needs one; blocks
+ * freed on other threads after this are taken over along with it.
+ */
+struct Drain {
+    ~Drain()
+    {
+        state.dead = true;
+        ThreadCache* cache = state.cache;
+        state.cache = nullptr;
+        if (!cache) {
+            return;
+        }
+        for (int c = 0; c < classCount; c++) {
+            freeList(cache->lists[c]);
+            cache->lists[c] = nullptr;
+        }
+        cache->cachedBytes = 0;
+
+        std::lock_guard<std::mutex> lock(orphanMutex);
+        cache->nextOrphan = orphans;
+        orphans = cache;
+    }
+};
+
+thread_local Drain drain;
+
+/**
+ * @brief Gets the calling thread's cache, taking one over or creating it.
+ * @return The cache, or nullptr once the thread is exiting.
+ */
+static ThreadCache* getCache()
+{
+    if (state.cache || state.dead) {
+        return state.cache;
+    }
+    // Touching drain registers the guard for this thread
+    (void)&drain;
+    {
+        std::lock_guard<std::mutex> lock(orphanMutex);
+        if (orphans) {
+            state.cache = orphans;
+            orphans = orphans->nextOrphan;
+        }
+    }
+    if (!state.cache) {
+        state.cache = new ThreadCache();
+    }
+    return state.cache;
+}
+
+static uint32_t getSizeClass(size_t size)
+{
+    for (uint32_t c = 0; c < largeClass; c++) {
+        if (size <= (size_t(1) << (c + minShift))) {
+            return c;
+        }
+    }
+    return largeClass;
+}
+
+/**
+ * @brief Moves the blocks other threads returned onto the owner's lists.
+ * Blocks beyond the cap go back to malloc.
+ * @param cache Cache of the calling thread.
+ */
+static void takeRemote(ThreadCache* cache)
+{
+    FreeBlock* block = cache->remote.exchange(nullptr, std::memory_order_acquire);
+    while (block) {
+        FreeBlock* next = block->next;
+        Header* header = reinterpret_cast<Header*>(block) - 1;
+        cache->remoteBytes -= header->size;
+        if (cache->cachedBytes + header->size > maxCachedBytes) {
+            std::free(header);
+        } else {
+            block->next = cache->lists[header->sizeClass];
+            cache->lists[header->sizeClass] = block;
+            cache->cachedBytes += header->size;
+        }
+        block = next;
+    }
+}
+
+/**
+ * @brief Allocates a block of at least size bytes.
+ * @param size Size of the block, in bytes.
+ * @return Pointer to the block, or nullptr if the system is out of memory.
+ */
+void* allocate(size_t size)
+{
+    const uint32_t sizeClass = getSizeClass(size);
+    ThreadCache* cache = sizeClass != largeClass ? getCache() : nullptr;
+    if (cache) {
+        if (!cache->lists[sizeClass] && cache->remote.load(std::memory_order_relaxed)) {
+            takeRemote(cache);
+        }
+        if (FreeBlock* block = cache->lists[sizeClass]) {
+            cache->lists[sizeClass] = block->next;
+            cache->cachedBytes -= reinterpret_cast<Header*>(block)[-1].size;
+            return block;
+        }
+    }
+
+    const size_t capacity = sizeClass == largeClass ? size : size_t(1) << (sizeClass + minShift);
+    Header* header = static_cast<Header*>(std::malloc(sizeof(Header) + capacity));
+    if (!header) {
+        return nullptr;
+    }
+    systemAllocs++;
+    header->sizeClass = sizeClass;
+    header->size = capacity;
+    header->owner = cache;
+    return header + 1;
+}
+
+/**
+ * @brief Returns a block to the cache of the thread that allocated it.
+ * @param p Block to free, can be nullptr.
+ */
+void deallocate(void* p)
+{
+    if (!p) {
+        return;
+    }
+
+    Header* header = static_cast<Header*>(p) - 1;
+    ThreadCache* owner = header->owner;
+    if (!owner || owner->cachedBytes + owner->remoteBytes + header->size > maxCachedBytes) {
+        std::free(header);
+        return;
+    }
+
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    if (owner == state.cache) {
+        block->next = owner->lists[header->sizeClass];
+        owner->lists[header->sizeClass] = block;
+        owner->cachedBytes += header->size;
+        return;
+    }
+
+    owner->remoteBytes += header->size;
+    block->next = owner->remote.load(std::memory_order_relaxed);
+    while (!owner->remote.compare_exchange_weak(block->next, block, std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Resizes a block, keeping its contents.
+ * @param p Block to resize, can be nullptr.
+ * @param size New size of the block, in bytes.
+ * @return Pointer to the resized block.
+ */
+void* reallocate(void* p, size_t size)
+{
+    if (!p) {
+        return allocate(size);
+    }
+
+    // The rounded up capacity often already fits the new size
+    const Header* header = static_cast<Header*>(p) - 1;
+    if (size <= header->size) {
+        return p;
+    }
+
+    void* resized = allocate(size);
+    if (resized) {
+        std::memcpy(resized, p, header->size);
+        deallocate(p);
+    }
+    return resized;
+}
+
+/**
+ * @brief Gets the number of blocks the arena had to request from malloc.
+ * @return Count since the start of the program, over all threads.
+ */
+size_t getSystemAllocCount()
+{
+    return systemAllocs;
+}
+
+/**
+ * @brief Splits the cached memory allowed in total between the threads.
+ * Keeps the memory held idle bounded however many workers run.
+ * @param threadCount Number of threads converting at once.
+ */
+void setThreadCount(unsigned int threadCount)
+{
+    maxCachedBytes = std::max(minThreadCachedBytes, maxTotalCachedBytes / std::max(1u, threadCount));
+}
+
+} // namespace arena
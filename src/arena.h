@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    arena.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/**
+ * @brief Per-thread caching allocator for conversion scratch memory.
+ * Blocks are rounded up to a power of two and, once freed, kept on a free
+ * list of the thread that allocated them instead of going back to malloc.
+ * Converters, resamplers and their r8brain buffers are rebuilt with the
+ * same sizes file after file, so after the first file nearly every request
+ * is served from these lists. A block may be freed on any thread; it goes
+ * back to its owner, so memory stays with the thread (and NUMA node) that
+ * first touched it.
+ */
+namespace arena {
+
+void* allocate(size_t size);
+void* reallocate(void* p, size_t size);
+void deallocate(void* p);
+
+size_t getSystemAllocCount();
+void setThreadCount(unsigned int threadCount);
+
+/**
+ * @brief STL allocator drawing from the arena.
+ */
+template <typename T>
+struct Allocator {
+    using value_type = T;
+
+    Allocator() = default;
+    template <typename U>
+    Allocator(const Allocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena::allocate(n * sizeof(T))); }
+    void deallocate(T* p, size_t) { arena::deallocate(p); }
+
+    template <typename U>
+    bool operator==(const Allocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const Allocator<U>&) const { return false; }
+};
+
+template <typename T>
+using Vector = std::vector<T, Allocator<T>>;
+
+} // namespace arena
+
+/**
+ * @brief Replacement for r8b::CStdClassAllocator, set as R8B_BASECLASS.
+ */
+class ArenaClassAllocator
+{
+public:
+    void* operator new(const size_t, void* const p) { return p; }
+    void* operator new(const size_t n) { return arena::allocate(n); }
+    void* operator new[](const size_t n) { return arena::allocate(n); }
+    void operator delete(void* const p) { arena::deallocate(p); }
+    void operator delete[](void* const p) { arena::deallocate(p); }
+};
+
+/**
+ * @brief Replacement for r8b::CStdMemAllocator, set as R8B_MEMALLOCCLASS.
+ */
+class ArenaMemAllocator : public ArenaClassAllocator
+{
+public:
+    static void* allocmem(const size_t size) { return arena::allocate(size); }
+    static void* reallocmem(void* const p, const size_t size) { return arena::reallocate(p, size); }
+    static void freemem(void* const p) { arena::deallocate(p); }
+};
+
+#endif /* ARENA_H */
@@ -0,0 +1,328 @@
+/*
+  ==============================================================================
+
+    asyncfile.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "asyncfile.h"
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "filecopy.h"
+
+/**
+ * @brief Sets up the ring and starts the I/O thread.
+ * @param budgetBytes Most bytes held at once, half for sources read ahead
+ * and half for outputs waiting to be written.
+ */
+AsyncFileIO::AsyncFileIO(size_t budgetBytes) : budgetBytes(budgetBytes)
+{
+    async = ring.init(ringEntries);
+    thread = std::thread(&AsyncFileIO::run, this);
+}
+
+/**
+ * @brief Finishes the queued writes and stops the I/O thread.
+ * Sources read ahead but never taken are dropped.
+ */
+AsyncFileIO::~AsyncFileIO()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+}
+
+/**
+ * @brief Queues a source to be read into memory.
+ * Call in the order the sources will be taken.
+ * @param path Path of the source.
+ */
+void AsyncFileIO::prefetch(const std::string& path)
+{
+    std::shared_ptr<Transfer> transfer = std::make_shared<Transfer>();
+    transfer->path = path;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (reads.emplace(path, transfer).second) {
+        readQueue.push_back(std::move(transfer));
+        changed.notify_all();
+    }
+}
+
+/**
+ * @brief Takes the contents of a prefetched source.
+ * Waits if the source is being read. A source whose read has not started
+ * yet is dropped from the queue, as the caller will open it sooner itself.
+ * @param path Path of the source, as passed to prefetch().
+ * @param bytes Receives the whole file.
+ * @return bool indicating whether the file was read, false if it was
+ * never prefetched, not reached yet, too large or could not be read.
+ */
+bool AsyncFileIO::take(const std::string& path, std::vector<unsigned char>& bytes)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = reads.find(path);
+    if (it == reads.end()) {
+        return false;
+    }
+
+    std::shared_ptr<Transfer> transfer = it->second;
+    reads.erase(it);
+    if (transfer->state == State::Queued) {
+        // Skipped by the I/O thread when it gets there
+        transfer->state = State::Failed;
+        return false;
+    }
+
+    changed.wait(lock, [&transfer]() { return transfer->state != State::Reading; });
+    if (transfer->state != State::Ready) {
+        return false;
+    }
+
+    readBytes -= transfer->bytes.size();
+    bytes = std::move(transfer->bytes);
+    changed.notify_all();
+    return true;
+}
+
+/**
+ * @brief Queues a whole output to be written.
+ * Blocks while the outputs already waiting fill their half of the budget.
+ * @param path Path of the output, replaced once the whole output is written.
+ * @param bytes Contents of the output.
+ * @param onWritten Called on the I/O thread once the output is in place,
+ * not at all if it fails.
+ */
+void AsyncFileIO::write(const std::string& path, std::vector<unsigned char> bytes,
+                        std::function<void()> onWritten)
+{
+    std::shared_ptr<Transfer> transfer = std::make_shared<Transfer>();
+    transfer->path = path;
+    transfer->write = true;
+    transfer->bytes = std::move(bytes);
+    transfer->onWritten = std::move(onWritten);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return writesPending == 0 || writeBytes < budgetBytes / 2; });
+    writeBytes += transfer->bytes.size();
+    writesPending++;
+    writeQueue.push_back(std::move(transfer));
+    changed.notify_all();
+}
+
+/**
+ * @brief Waits until every queued output is on disk.
+ * @return Number of outputs that failed to be written since the last drain.
+ */
+size_t AsyncFileIO::drain()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return writesPending == 0; });
+    const size_t failed = failedWrites;
+    failedWrites = 0;
+    return failed;
+}
+
+/**
+ * @brief Opens the file of a transfer and queues its first request.
+ * Reads only start for regular files up to maxFileBytes.
+ * @param transfer Transfer to start.
+ * @return bool indicating whether a request was queued or, for an empty
+ * output, the transfer already finished.
+ */
+bool AsyncFileIO::start(const std::shared_ptr<Transfer>& transfer)
+{
+    if (transfer->write) {
+        transfer->fd = ::open(getTempPath(transfer->path).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (transfer->fd < 0) {
+            return false;
+        }
+        if (transfer->bytes.empty()) {
+            finish(*transfer, true);
+            return true;
+        }
+    } else {
+        transfer->fd = ::open(transfer->path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (transfer->fd < 0 || fstat(transfer->fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+            static_cast<size_t>(st.st_size) > maxFileBytes) {
+            return false;
+        }
+        transfer->bytes.resize(static_cast<size_t>(st.st_size));
+    }
+
+    const uint64_t tag = nextTag++;
+    inFlight[tag] = transfer;
+    queueChunk(tag, *transfer);
+    return true;
+}
+
+/**
+ * @brief Queues the next part of a transfer.
+ * @param tag Tag of the transfer in inFlight.
+ * @param transfer Transfer to continue.
+ */
+void AsyncFileIO::queueChunk(uint64_t tag, Transfer& transfer)
+{
+    const size_t left = transfer.bytes.size() - transfer.done;
+    const unsigned int length = static_cast<unsigned int>(left < chunkBytes ? left : chunkBytes);
+    if (transfer.write) {
+        ring.queueWrite(transfer.fd, transfer.bytes.data() + transfer.done, length, transfer.done, tag);
+    } else {
+        ring.queueRead(transfer.fd, transfer.bytes.data() + transfer.done, length, transfer.done, tag);
+    }
+}
+
+/**
+ * @brief Continues or finishes the transfer a request belonged to.
+ * @param completion Finished request.
+ */
+void AsyncFileIO::onCompletion(const IoRing::Completion& completion)
+{
+    auto it = inFlight.find(completion.tag);
+    if (it == inFlight.end()) {
+        return;
+    }
+    Transfer& transfer = *it->second;
+
+    if (completion.result > 0) {
+        transfer.done += static_cast<size_t>(completion.result);
+        if (transfer.done < transfer.bytes.size()) {
+            // Short transfers simply continue where they stopped
+            queueChunk(completion.tag, transfer);
+            return;
+        }
+    }
+
+    // A source that shrank since it was opened ends early
+    const bool ok = completion.result > 0 || (completion.result == 0 && !transfer.write && transfer.done > 0);
+    if (ok && !transfer.write) {
+        transfer.bytes.resize(transfer.done);
+    }
+    std::shared_ptr<Transfer> finished = std::move(it->second);
+    inFlight.erase(it);
+    finish(*finished, ok);
+}
+
+/**
+ * @brief Closes the file of a transfer and publishes the result.
+ * A complete output is renamed into place, a failed one is removed, so it
+ * is never mistaken for a current one.
+ * @param transfer Finished transfer.
+ * @param ok Whether every byte was transferred.
+ */
+void AsyncFileIO::finish(Transfer& transfer, bool ok)
+{
+    if (transfer.fd >= 0) {
+        ok = ::close(transfer.fd) == 0 && ok;
+        transfer.fd = -1;
+    }
+    if (transfer.write) {
+        if (ok) {
+            ok = commitTempFile(transfer.path);
+        } else {
+            std::cerr << "Error writing " << transfer.path << std::endl;
+            discardTempFile(transfer.path);
+        }
+        if (ok && transfer.onWritten) {
+            transfer.onWritten();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (transfer.write) {
+        writeBytes -= transfer.bytes.size();
+        writesPending--;
+        if (!ok) {
+            failedWrites++;
+        }
+        transfer.bytes = std::vector<unsigned char>();
+        transfer.onWritten = nullptr;
+    } else if (ok) {
+        transfer.state = State::Ready;
+    } else {
+        readBytes -= transfer.bytes.size();
+        transfer.bytes = std::vector<unsigned char>();
+        transfer.state = State::Failed;
+    }
+    changed.notify_all();
+}
+
+/**
+ * @brief Main loop of the I/O thread.
+ * Starts writes first, as finishing them gives memory back, then reads
+ * while the read budget allows, and hands everything queued to the ring
+ * in one submit before waiting for the next completion.
+ */
+void AsyncFileIO::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        bool queued = false;
+        while (ring.hasSpace() && !writeQueue.empty()) {
+            std::shared_ptr<Transfer> transfer = std::move(writeQueue.front());
+            writeQueue.pop_front();
+            lock.unlock();
+            if (!start(transfer)) {
+                finish(*transfer, false);
+            }
+            queued = true;
+            lock.lock();
+        }
+
+        while (ring.hasSpace() && !readQueue.empty() && readBytes < budgetBytes / 2) {
+            std::shared_ptr<Transfer> transfer = std::move(readQueue.front());
+            readQueue.pop_front();
+            if (transfer->state != State::Queued) {
+                continue;
+            }
+            transfer->state = State::Reading;
+            lock.unlock();
+            const bool started = start(transfer);
+            lock.lock();
+            if (started) {
+                readBytes += transfer->bytes.size();
+            } else {
+                lock.unlock();
+                finish(*transfer, false);
+                lock.lock();
+            }
+            queued = true;
+        }
+
+        if (ring.getPending() > 0) {
+            lock.unlock();
+            // A failing kernel ring still completes every request it
+            // took before giving them back, so buffers are never freed
+            // under the kernel
+            IoRing::Completion completion;
+            if (ring.wait(completion)) {
+                onCompletion(completion);
+            } else {
+                // Nothing left in the ring, fail whatever still waits on it
+                for (auto& entry : inFlight) {
+                    finish(*entry.second, false);
+                }
+                inFlight.clear();
+            }
+            lock.lock();
+            continue;
+        }
+
+        if (queued) {
+            continue;
+        }
+        if (stopping && writeQueue.empty()) {
+            return;
+        }
+        changed.wait(lock);
+    }
+}
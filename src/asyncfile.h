@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    asyncfile.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "uring.h"
+
+#ifndef ASYNCFILE_H
+#define ASYNCFILE_H
+
+/**
+ * @brief Reads small sources ahead and writes small outputs behind the workers.
+ * One I/O thread owns an IoRing. Sources are read whole, in the order the
+ * workers will want them, with many reads in flight at once, so a worker
+ * finds its next file already in memory; outputs built in memory are
+ * handed over and written in batches while the worker moves on. Buffered
+ * bytes are capped, and a source a worker asks for before its read started
+ * is left for the worker to open itself. Outputs are written to a temporary
+ * file and renamed into place once complete; a failed write leaves no
+ * output, so an incremental run converts the source again.
+ */
+class AsyncFileIO
+{
+public:
+    // Sources and outputs up to this size go through the I/O thread
+    static const size_t maxFileBytes = 8u << 20;
+
+    explicit AsyncFileIO(size_t budgetBytes = 256u << 20);
+    ~AsyncFileIO();
+
+    AsyncFileIO(const AsyncFileIO&) = delete;
+    AsyncFileIO& operator=(const AsyncFileIO&) = delete;
+
+    bool isAsync() const { return async; }
+
+    void prefetch(const std::string& path);
+    bool take(const std::string& path, std::vector<unsigned char>& bytes);
+    void write(const std::string& path, std::vector<unsigned char> bytes,
+               std::function<void()> onWritten = nullptr);
+    size_t drain();
+
+private:
+    enum class State {
+        Queued,
+        Reading,
+        Ready,
+        Failed
+    };
+
+    /**
+     * @brief A whole-file read or write.
+     */
+    struct Transfer {
+        std::string path;
+        bool write = false;
+        State state = State::Queued;
+        int fd = -1;
+        std::vector<unsigned char> bytes;
+        size_t done = 0;
+        // Called on the I/O thread once a write is in place
+        std::function<void()> onWritten;
+    };
+
+    // Largest single request, reads and writes of bigger files are split
+    static const unsigned int chunkBytes = 1u << 20;
+    static const unsigned int ringEntries = 64;
+
+    void run();
+    bool start(const std::shared_ptr<Transfer>& transfer);
+    void queueChunk(uint64_t tag, Transfer& transfer);
+    void onCompletion(const IoRing::Completion& completion);
+    void finish(Transfer& transfer, bool ok);
+
+    IoRing ring;
+    bool async = false;
+    const size_t budgetBytes;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::unordered_map<std::string, std::shared_ptr<Transfer>> reads;
+    std::deque<std::shared_ptr<Transfer>> readQueue;
+    std::deque<std::shared_ptr<Transfer>> writeQueue;
+    // Transfers in the ring, by tag, only touched by the I/O thread
+    std::unordered_map<uint64_t, std::shared_ptr<Transfer>> inFlight;
+    uint64_t nextTag = 0;
+    // Bytes held by started reads and by queued writes, each capped at half the budget
+    size_t readBytes = 0;
+    size_t writeBytes = 0;
+    size_t writesPending = 0;
+    size_t failedWrites = 0;
+    bool stopping = false;
+
+    std::thread thread;
+};
+
+#endif /* ASYNCFILE_H */
@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    audioio.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "audioio.h"
+
+/**
+ * @brief Opens a file for reading with libsndfile.
+ * @param path Path of the file.
+ * @param info Receives the format of the file.
+ * @return bool indicating whether libsndfile could open the file.
+ */
+bool SndfileReader::open(const char* path, SF_INFO& info)
+{
+    close();
+    info.format = 0;
+    file = sf_open(path, SFM_READ, &info);
+    return file != nullptr;
+}
+
+/**
+ * @brief Opens a file already in memory for reading with libsndfile.
+ * @param memory Contents of the file, kept alive until close().
+ * @param info Receives the format of the file.
+ * @return bool indicating whether libsndfile could open the file.
+ */
+bool SndfileReader::open(MemoryFile& memory, SF_INFO& info)
+{
+    close();
+    info.format = 0;
+    file = memory.open(SFM_READ, &info);
+    return file != nullptr;
+}
+
+sf_count_t SndfileReader::read(double* out, sf_count_t frames)
+{
+    return sf_readf_double(file, out, frames);
+}
+
+bool SndfileReader::seek(sf_count_t frame)
+{
+    return sf_seek(file, frame, SEEK_SET) == frame;
+}
+
+void SndfileReader::close()
+{
+    if (file) {
+        sf_close(file);
+        file = nullptr;
+    }
+}
+
+/**
+ * @brief Creates a file for writing with libsndfile.
+ * @param path Path of the file.
+ * @param info Format to write.
+ * @param frameBytes Size of one encoded frame.
+ * @return bool indicating whether libsndfile could create the file.
+ */
+bool SndfileWriter::open(const char* path, SF_INFO& info, int frameBytes)
+{
+    close();
+    this->frameBytes = frameBytes;
+    file = sf_open(path, SFM_WRITE, &info);
+    return file != nullptr;
+}
+
+/**
+ * @brief Encodes a file into memory with libsndfile.
+ * @param memory Receives the contents of the file, complete after close().
+ * @param info Format to write.
+ * @param frameBytes Size of one encoded frame.
+ * @return bool indicating whether libsndfile could start the file.
+ */
+bool SndfileWriter::open(MemoryFile& memory, SF_INFO& info, int frameBytes)
+{
+    close();
+    this->frameBytes = frameBytes;
+    file = memory.open(SFM_WRITE, &info);
+    return file != nullptr;
+}
+
+sf_count_t SndfileWriter::write(const void* in, sf_count_t frames)
+{
+    return sf_write_raw(file, in, frames * frameBytes) / frameBytes;
+}
+
+bool SndfileWriter::close()
+{
+    if (!file) {
+        return true;
+    }
+
+    // Closing writes the final header and flushes what is left to disk
+    bool ok = sf_close(file) == 0;
+    file = nullptr;
+    return ok;
+}
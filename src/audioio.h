@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    audioio.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <sndfile.h>
+#include "memfile.h"
+
+#ifndef AUDIOIO_H
+#define AUDIOIO_H
+
+/**
+ * @brief Source of interleaved, normalized double frames.
+ */
+class AudioReader
+{
+public:
+    virtual ~AudioReader() = default;
+
+    /**
+     * @brief Reads the next frames.
+     * @param out Receives frames * channels samples.
+     * @param frames Number of frames to read.
+     * @return Number of frames read, less than frames at the end of the source.
+     */
+    virtual sf_count_t read(double* out, sf_count_t frames) = 0;
+
+    /**
+     * @brief Moves to a frame, the next read starts there.
+     * @param frame Index of the frame.
+     * @return bool indicating whether the source could seek there.
+     */
+    virtual bool seek(sf_count_t frame) = 0;
+    virtual void close() = 0;
+};
+
+/**
+ * @brief Sink for interleaved frames already encoded in the file's sample layout.
+ */
+class AudioWriter
+{
+public:
+    virtual ~AudioWriter() = default;
+
+    /**
+     * @brief Appends frames to the output.
+     * @param in Interleaved encoded frames, as produced by the Quantizer.
+     * @param frames Number of frames to write.
+     * @return Number of frames written, less than frames on error.
+     */
+    virtual sf_count_t write(const void* in, sf_count_t frames) = 0;
+
+    /**
+     * @brief Finishes the output.
+     * @return bool indicating whether everything reached the file.
+     */
+    virtual bool close() = 0;
+};
+
+/**
+ * @brief AudioReader decoding through libsndfile, for any format it knows.
+ */
+class SndfileReader : public AudioReader
+{
+public:
+    ~SndfileReader() override { close(); }
+
+    bool open(const char* path, SF_INFO& info);
+    bool open(MemoryFile& memory, SF_INFO& info);
+    sf_count_t read(double* out, sf_count_t frames) override;
+    bool seek(sf_count_t frame) override;
+    void close() override;
+
+private:
+    SNDFILE* file = nullptr;
+};
+
+/**
+ * @brief AudioWriter writing through libsndfile, for any container it knows.
+ * Samples arrive encoded, so they are passed on as raw data.
+ */
+class SndfileWriter : public AudioWriter
+{
+public:
+    ~SndfileWriter() override { close(); }
+
+    bool open(const char* path, SF_INFO& info, int frameBytes);
+    bool open(MemoryFile& memory, SF_INFO& info, int frameBytes);
+    sf_count_t write(const void* in, sf_count_t frames) override;
+    bool close() override;
+
+private:
+    SNDFILE* file = nullptr;
+    int frameBytes = 0;
+};
+
+#endif /* AUDIOIO_H */
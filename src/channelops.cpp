@@ -0,0 +1,355 @@
+/*
+  ==============================================================================
+
+    channelops.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "channelops.h"
+#include <algorithm>
+#include "includes/r8brain/r8bbase.h"
+
+#if defined(R8B_SSE2) || defined(R8B_NEON)
+#define CHANNELOPS_SIMD
+
+// Two lanes of doubles on either instruction set, so every kernel below is
+// written once. madd multiplies and adds separately, matching the rounding
+// of the scalar loops.
+#if defined(R8B_SSE2)
+typedef __m128d Pair;
+
+static inline Pair pairZero() { return _mm_setzero_pd(); }
+static inline Pair pairLoad(const double* p) { return _mm_loadu_pd(p); }
+static inline void pairStore(double* p, Pair v) { _mm_storeu_pd(p, v); }
+static inline Pair pairSplat(const double* p) { return _mm_load1_pd(p); }
+static inline Pair pairGather(const double* a, const double* b) { return _mm_loadh_pd(_mm_load_sd(a), b); }
+static inline Pair pairMadd(Pair acc, Pair a, Pair b) { return _mm_add_pd(acc, _mm_mul_pd(a, b)); }
+
+static inline void pairTranspose(Pair a, Pair b, Pair& first, Pair& second)
+{
+    first = _mm_unpacklo_pd(a, b);
+    second = _mm_unpackhi_pd(a, b);
+}
+
+static inline void pairUnzip(const double* p, Pair& even, Pair& odd)
+{
+    const Pair a = _mm_loadu_pd(p);
+    const Pair b = _mm_loadu_pd(p + 2);
+    even = _mm_unpacklo_pd(a, b);
+    odd = _mm_unpackhi_pd(a, b);
+}
+
+static inline void pairZipStore(double* p, Pair even, Pair odd)
+{
+    _mm_storeu_pd(p, _mm_unpacklo_pd(even, odd));
+    _mm_storeu_pd(p + 2, _mm_unpackhi_pd(even, odd));
+}
+#else
+typedef float64x2_t Pair;
+
+static inline Pair pairZero() { return vdupq_n_f64(0.0); }
+static inline Pair pairLoad(const double* p) { return vld1q_f64(p); }
+static inline void pairStore(double* p, Pair v) { vst1q_f64(p, v); }
+static inline Pair pairSplat(const double* p) { return vld1q_dup_f64(p); }
+static inline Pair pairGather(const double* a, const double* b) { return vcombine_f64(vld1_f64(a), vld1_f64(b)); }
+static inline Pair pairMadd(Pair acc, Pair a, Pair b) { return vaddq_f64(acc, vmulq_f64(a, b)); }
+
+static inline void pairTranspose(Pair a, Pair b, Pair& first, Pair& second)
+{
+    first = vzip1q_f64(a, b);
+    second = vzip2q_f64(a, b);
+}
+
+static inline void pairUnzip(const double* p, Pair& even, Pair& odd)
+{
+    const float64x2x2_t v = vld2q_f64(p);
+    even = v.val[0];
+    odd = v.val[1];
+}
+
+static inline void pairZipStore(double* p, Pair even, Pair odd)
+{
+    float64x2x2_t v;
+    v.val[0] = even;
+    v.val[1] = odd;
+    vst2q_f64(p, v);
+}
+#endif
+
+// Widest source whose gains are kept in registers/stack by the mix kernels
+static const int maxHoistedChannels = 32;
+#endif
+
+/**
+ * @brief Copies one channel out of interleaved frames.
+ * @param in Interleaved frames.
+ * @param channels Number of interleaved channels.
+ * @param channel Index of the channel to extract.
+ * @param frames Number of frames.
+ * @param out Receives frames samples of the channel.
+ */
+void deinterleave(const double* in, int channels, int channel, int frames, double* out)
+{
+    if (channels == 1) {
+        std::copy(in, in + frames, out);
+        return;
+    }
+
+    // The strided copy is left to the compiler, at -O2 it vectorizes it as
+    // well as intrinsics do
+    for (int i = 0; i < frames; i++) {
+        out[i] = in[static_cast<size_t>(i) * channels + channel];
+    }
+}
+
+/**
+ * @brief Copies one channel into interleaved frames.
+ * @param in Samples of the channel.
+ * @param channels Number of interleaved channels.
+ * @param channel Index of the channel to fill.
+ * @param frames Number of frames.
+ * @param out Interleaved frames receiving the channel.
+ */
+void interleave(const double* in, int channels, int channel, int frames, double* out)
+{
+    if (channels == 1) {
+        std::copy(in, in + frames, out);
+        return;
+    }
+
+    for (int i = 0; i < frames; i++) {
+        out[static_cast<size_t>(i) * channels + channel] = in[i];
+    }
+}
+
+/**
+ * @brief Interleaves separate channel buffers into frames.
+ * Writes whole frames at a time, a stereo pair takes two loads and two
+ * stores for every two frames.
+ * @param in Buffer of each channel.
+ * @param channels Number of channels.
+ * @param frames Number of frames.
+ * @param out Receives the interleaved frames.
+ */
+void interleavePlanar(const double* const* in, int channels, int frames, double* out)
+{
+    if (channels != 2) {
+        for (int c = 0; c < channels; c++) {
+            interleave(in[c], channels, c, frames, out);
+        }
+        return;
+    }
+
+    const double* left = in[0];
+    const double* right = in[1];
+    int i = 0;
+#if defined(CHANNELOPS_SIMD)
+    for (; i + 2 <= frames; i += 2) {
+        pairZipStore(out + static_cast<size_t>(i) * 2, pairLoad(left + i), pairLoad(right + i));
+    }
+#endif
+
+    for (; i < frames; i++) {
+        out[static_cast<size_t>(i) * 2] = left[i];
+        out[static_cast<size_t>(i) * 2 + 1] = right[i];
+    }
+}
+
+/**
+ * @brief Builds the default gains for changing the number of channels.
+ * A mono output averages every source channel and a mono source feeds
+ * every output channel. Otherwise source channel k goes to output channel
+ * k % outChannels, averaged with any other channels folded onto it, and
+ * outputs beyond the source channels repeat them in order.
+ * @param inChannels Number of source channels.
+ * @param outChannels Number of output channels.
+ * @param matrix Receives outChannels x inChannels gains, row per output channel.
+ */
+void buildMixMatrix(int inChannels, int outChannels, std::vector<double>& matrix)
+{
+    matrix.assign(static_cast<size_t>(outChannels) * inChannels, 0.0);
+
+    if (outChannels < inChannels) {
+        for (int o = 0; o < outChannels; o++) {
+            const int folded = (inChannels - o + outChannels - 1) / outChannels;
+            for (int k = o; k < inChannels; k += outChannels) {
+                matrix[static_cast<size_t>(o) * inChannels + k] = 1.0 / folded;
+            }
+        }
+    } else {
+        for (int o = 0; o < outChannels; o++) {
+            matrix[static_cast<size_t>(o) * inChannels + o % inChannels] = 1.0;
+        }
+    }
+}
+
+/**
+ * @brief Mixes interleaved frames into a single channel.
+ * Two frames are mixed per step, stereo sources are split with a single
+ * unzip and wider ones transpose two channels of both frames at a time.
+ * @param in Interleaved frames.
+ * @param channels Number of interleaved channels.
+ * @param gains Gain of each channel.
+ * @param frames Number of frames.
+ * @param out Receives frames samples.
+ */
+void mixChannel(const double* in, int channels, const double* gains, int frames, double* out)
+{
+    int i = 0;
+#if defined(CHANNELOPS_SIMD)
+    if (channels == 2) {
+        const Pair leftGain = pairSplat(gains);
+        const Pair rightGain = pairSplat(gains + 1);
+        for (; i + 2 <= frames; i += 2) {
+            Pair left, right;
+            pairUnzip(in + static_cast<size_t>(i) * 2, left, right);
+            pairStore(out + i, pairMadd(pairMadd(pairZero(), leftGain, left), rightGain, right));
+        }
+    } else if (channels <= maxHoistedChannels) {
+        Pair splatGains[maxHoistedChannels];
+        for (int k = 0; k < channels; k++) {
+            splatGains[k] = pairSplat(gains + k);
+        }
+
+        // Each pair of channels is transposed out of the two frames at once
+        for (; i + 2 <= frames; i += 2) {
+            const double* first = in + static_cast<size_t>(i) * channels;
+            const double* second = first + channels;
+            Pair sum = pairZero();
+            int k = 0;
+            for (; k + 2 <= channels; k += 2) {
+                Pair even, odd;
+                pairTranspose(pairLoad(first + k), pairLoad(second + k), even, odd);
+                sum = pairMadd(sum, splatGains[k], even);
+                sum = pairMadd(sum, splatGains[k + 1], odd);
+            }
+            if (k < channels) {
+                sum = pairMadd(sum, splatGains[k], pairGather(first + k, second + k));
+            }
+            pairStore(out + i, sum);
+        }
+    }
+#endif
+
+    for (; i < frames; i++) {
+        const double* frame = in + static_cast<size_t>(i) * channels;
+        double sum = 0.0;
+        for (int k = 0; k < channels; k++) {
+            sum += gains[k] * frame[k];
+        }
+        out[i] = sum;
+    }
+}
+
+/**
+ * @brief Mixes interleaved frames into interleaved frames of another width.
+ * Mono outputs go through mixChannel. Stereo outputs build each frame as
+ * one pair, adding every source sample times its column of gains.
+ * @param in Interleaved source frames.
+ * @param inChannels Number of source channels.
+ * @param matrix Gains, row per output channel.
+ * @param outChannels Number of output channels.
+ * @param frames Number of frames.
+ * @param out Receives the interleaved frames.
+ */
+void mixFrames(const double* in, int inChannels, const double* matrix, int outChannels,
+               int frames, double* out)
+{
+    if (outChannels == 1) {
+        mixChannel(in, inChannels, matrix, frames, out);
+        return;
+    }
+
+    int i = 0;
+#if defined(CHANNELOPS_SIMD)
+    if (outChannels == 2 && inChannels <= maxHoistedChannels) {
+        Pair columns[maxHoistedChannels];
+        for (int k = 0; k < inChannels; k++) {
+            columns[k] = pairGather(matrix + k, matrix + inChannels + k);
+        }
+
+        for (; i < frames; i++) {
+            const double* frame = in + static_cast<size_t>(i) * inChannels;
+            Pair sum = pairZero();
+            for (int k = 0; k < inChannels; k++) {
+                sum = pairMadd(sum, pairSplat(frame + k), columns[k]);
+            }
+            pairStore(out + static_cast<size_t>(i) * 2, sum);
+        }
+    }
+#endif
+
+    for (; i < frames; i++) {
+        const double* frame = in + static_cast<size_t>(i) * inChannels;
+        for (int o = 0; o < outChannels; o++) {
+            const double* gains = matrix + static_cast<size_t>(o) * inChannels;
+            double sum = 0.0;
+            for (int k = 0; k < inChannels; k++) {
+                sum += gains[k] * frame[k];
+            }
+            out[static_cast<size_t>(i) * outChannels + o] = sum;
+        }
+    }
+}
+
+/**
+ * @brief Mixes separate channel buffers into interleaved frames.
+ * Stereo outputs build each frame as one pair, the mono to stereo upmix
+ * two frames at a time.
+ * @param in Buffer of each source channel.
+ * @param inChannels Number of source channels.
+ * @param matrix Gains, row per output channel.
+ * @param outChannels Number of output channels.
+ * @param frames Number of frames.
+ * @param out Receives the interleaved frames.
+ */
+void mixPlanar(const double* const* in, int inChannels, const double* matrix, int outChannels,
+               int frames, double* out)
+{
+    int i = 0;
+#if defined(CHANNELOPS_SIMD)
+    if (outChannels == 2 && inChannels <= maxHoistedChannels) {
+        // The buffers and gains are copied out first, stores to out could alias them
+        const double* buffers[maxHoistedChannels];
+        Pair columns[maxHoistedChannels];
+        for (int c = 0; c < inChannels; c++) {
+            buffers[c] = in[c];
+            columns[c] = pairGather(matrix + c, matrix + inChannels + c);
+        }
+
+        if (inChannels == 1) {
+            // Mono to stereo, two frames per step
+            const Pair gains = columns[0];
+            for (; i + 2 <= frames; i += 2) {
+                Pair first, second;
+                const Pair samples = pairLoad(buffers[0] + i);
+                pairTranspose(samples, samples, first, second);
+                pairStore(out + static_cast<size_t>(i) * 2, pairMadd(pairZero(), first, gains));
+                pairStore(out + static_cast<size_t>(i) * 2 + 2, pairMadd(pairZero(), second, gains));
+            }
+        } else {
+            for (; i < frames; i++) {
+                Pair sum = pairZero();
+                for (int c = 0; c < inChannels; c++) {
+                    sum = pairMadd(sum, pairSplat(buffers[c] + i), columns[c]);
+                }
+                pairStore(out + static_cast<size_t>(i) * 2, sum);
+            }
+        }
+    }
+#endif
+
+    for (; i < frames; i++) {
+        for (int o = 0; o < outChannels; o++) {
+            const double* gains = matrix + static_cast<size_t>(o) * inChannels;
+            double sum = 0.0;
+            for (int c = 0; c < inChannels; c++) {
+                sum += gains[c] * in[c][i];
+            }
+            out[static_cast<size_t>(i) * outChannels + o] = sum;
+        }
+    }
+}
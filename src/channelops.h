@@ -0,0 +1,35 @@
+/*
+  ==============================================================================
+
+    channelops.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <vector>
+
+#ifndef CHANNELOPS_H
+#define CHANNELOPS_H
+
+/*
+ * Channel layout kernels used around the per-channel resamplers. Each loop
+ * touches every sample once on the way in and once on the way out, so the
+ * stereo interleave and the mixes to stereo and mono, by far the most
+ * common, have SSE2/NEON paths that move two samples per instruction.
+ * Other layouts fall back to scalar code. The vector paths add the products
+ * in the same order as the scalar ones, so both give bit-identical results.
+ */
+
+void deinterleave(const double* in, int channels, int channel, int frames, double* out);
+void interleave(const double* in, int channels, int channel, int frames, double* out);
+void interleavePlanar(const double* const* in, int channels, int frames, double* out);
+
+void buildMixMatrix(int inChannels, int outChannels, std::vector<double>& matrix);
+void mixChannel(const double* in, int channels, const double* gains, int frames, double* out);
+void mixFrames(const double* in, int inChannels, const double* matrix, int outChannels, int frames, double* out);
+void mixPlanar(const double* const* in, int inChannels, const double* matrix, int outChannels,
+               int frames, double* out);
+
+#endif /* CHANNELOPS_H */
@@ -9,88 +9,521 @@
 */
 
 #include "converter.h"
-#include <filesystem>
-#include <fstream>
-#include "includes/r8brain/CDSPResampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "filecopy.h"
+#include "instrument.h"
+#include "pipeline.h"
+#include "wavfile.h"
 
-namespace fs = std::filesystem;
+/**
+ * @brief Checks whether a source already has the samples a profile asks for.
+ * @param sfinfo Format of the input as reported by libsndfile.
+ * @param profile Format the output should have.
+ * @return bool indicating whether the PCM payload can be used as is.
+ */
+bool canFastCopy(const SF_INFO& sfinfo, const OutputProfile& profile)
+{
+    return profile.format == SampleFormat::PCM16 && profile.container == Container::WAV &&
+           (profile.channels == 0 || profile.channels == sfinfo.channels) &&
+           (sfinfo.format & SF_FORMAT_SUBMASK) == SF_FORMAT_PCM_16 && sfinfo.samplerate == profile.sampleRate;
+}
+
+/**
+ * @brief Tries to produce the output without decoding the input.
+ * A 16 bit little-endian file that already has the rate and channels of a
+ * 16 bit WAV profile needs no DSP: a WAV is cloned or copied as is, and an
+ * RF64/Wave64 file only gets its header rewritten in front of the
+ * untouched PCM payload.
+ * @param inPath Path of the file to check/process.
+ * @param outPath Path that the output will be written to.
+ * @param sfinfo Format of the input as reported by libsndfile.
+ * @param profile Format the output should have.
+ * @return bool indicating whether the output was written.
+ */
+bool tryFastCopy(const char* inPath, const char* outPath, const SF_INFO& sfinfo, const OutputProfile& profile)
+{
+    if (!canFastCopy(sfinfo, profile)) {
+        return false;
+    }
+
+    PcmPayload payload;
+    if (!findPcmPayload(inPath, payload)) {
+        return false;
+    }
+
+    if (payload.container == RiffContainer::WAV) {
+        std::cout << "[!] File is already 16 bit at the target rate. Copying instead.." << std::endl;
+        return copyFile(inPath, outPath);
+    }
+
+    std::cout << "[!] File is already 16 bit at the target rate. Rewriting header only.." << std::endl;
+    return copyWithNewHeader(inPath, outPath, payload.offset, payload.length,
+                             sfinfo.samplerate, sfinfo.channels, 16);
+}
 
 /**
- * @brief Copies a file from a source path to destination path.
- * @param sourcePath Source path of the file.
- * @param destinationPath Destination path for the copied file.
+ * @brief Gets the libsndfile format of a profile's output.
+ * @param profile Output profile.
+ * @return SF_FORMAT_* container and subtype.
  */
-void copyFile(const std::string& sourcePath, const std::string& destinationPath) {
-    try {
-        std::ifstream sourceFile(sourcePath, std::ios::binary);
-        if (!sourceFile.is_open()) {
-            throw std::runtime_error("Failed to open source file");
+int getSndfileFormat(const OutputProfile& profile)
+{
+    const int container = profile.container == Container::AIFF ? SF_FORMAT_AIFF : SF_FORMAT_WAV;
+    switch (profile.format) {
+        case SampleFormat::PCM24: return container | SF_FORMAT_PCM_24;
+        case SampleFormat::ULaw: return container | SF_FORMAT_ULAW;
+        default: return container | SF_FORMAT_PCM_16;
+    }
+}
+
+/**
+ * @brief Opens the source with the native reader, or libsndfile for formats it does not handle.
+ * @param path Path of the file.
+ * @param info Receives the format of the file.
+ * @param inMemory Whether to decode memorySource instead of opening the file.
+ * @return The open reader, or nullptr if neither could open the file.
+ */
+AudioReader* Converter::openReader(const char* path, SF_INFO& info, bool inMemory)
+{
+    if (inMemory) {
+        const std::vector<unsigned char>& bytes = memorySource.getBytes();
+        if (settings.mappedIO && mappedReader.open(bytes.data(), bytes.size(), info)) {
+            return &mappedReader;
         }
+        return sndfileReader.open(memorySource, info) ? &sndfileReader : nullptr;
+    }
 
-        std::ofstream destinationFile(destinationPath, std::ios::binary);
-        if (!destinationFile.is_open()) {
-            throw std::runtime_error("Failed to open destination file");
+    if (settings.mappedIO && mappedReader.open(path, info)) {
+        return &mappedReader;
+    }
+    if (sndfileReader.open(path, info)) {
+        return &sndfileReader;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Creates the output with the native writer, or libsndfile if it cannot be mapped.
+ * @param path Path of the file.
+ * @param info Format to write.
+ * @param frames Number of frames that will be written.
+ * @param inMemory Whether to build the file in outputBytes or
+ * memoryOutput, to be written by asyncIO, instead of creating it.
+ * @return The open writer, or nullptr if neither could create the file.
+ */
+AudioWriter* Converter::openWriter(const char* path, SF_INFO& info, sf_count_t frames, bool inMemory)
+{
+    const OutputProfile& profile = settings.output;
+    if (inMemory) {
+        if (mappedWriter.open(outputBytes, profile.container, profile.format, info.samplerate, info.channels, frames)) {
+            return &mappedWriter;
         }
+        return sndfileWriter.open(memoryOutput, info, quantizer.getFrameBytes()) ? &sndfileWriter : nullptr;
+    }
 
-        destinationFile << sourceFile.rdbuf();
-    } catch (const std::exception& e) {
-        std::cerr << "Error copying file: " << e.what() << std::endl;
+    if (settings.mappedIO &&
+        mappedWriter.open(path, profile.container, profile.format, info.samplerate, info.channels, frames)) {
+        return &mappedWriter;
+    }
+    if (sndfileWriter.open(path, info, quantizer.getFrameBytes())) {
+        return &sndfileWriter;
     }
+    return nullptr;
 }
 
 /**
- * @brief Converts a file to a 16 bit wav.
+ * @brief Converts a file to the output profile.
  * Main converter method for the Converter class. 
  * Takes an input path and either processes it or copies it. 
+ * The input is streamed in blocks of blockFrames frames, each channel
+ * is passed through its own resampler and the result is written as it
+ * goes, so memory use does not depend on the length of the file.
+ * The output is built under a temporary name and renamed into place once
+ * it is complete, so a crash never leaves a partial output behind.
  * @param inPath Path of the file to check/process.
  * @param outPath Path that the processed file will be written to.
+ * @return bool indicating whether the output was written successfully.
  */
-void Converter::convert(const char* inPath, const char* outPath)
+bool Converter::convert(const char* inPath, const char* outPath)
 {
+    using instrument::ScopedTimer;
+    using instrument::Stage;
+
+    const OutputProfile& profile = settings.output;
+    const std::string tempPath = getTempPath(outPath);
     SF_INFO sfinfo;
-    SNDFILE *inFile = sf_open(inPath, SFM_READ, &sfinfo);
+    AudioReader* reader;
+    bool inMemory = false;
+    {
+        ScopedTimer timer(Stage::Open);
+        std::vector<unsigned char> prefetched;
+        inMemory = asyncIO && asyncIO->take(inPath, prefetched);
+        memorySource = MemoryFile(std::move(prefetched));
+        reader = openReader(inPath, sfinfo, inMemory);
+    }
 
-    if (!inFile) {
+    if (!reader) {
         std::cerr << "Error opening the input file." << std::endl;
-        return;
+        return false;
+    }
+
+    // Find the audible part first, the rest of the conversion only sees
+    // the trimmed frames
+    sf_count_t srcFrames = sfinfo.frames;
+    bool trimmed = false;
+    if (settings.trim.enabled) {
+        ScopedTimer timer(Stage::Read);
+        if (!trimmedReader.open(*reader, sfinfo.channels, sfinfo.samplerate, srcFrames, settings.trim)) {
+            std::cerr << "Error scanning the input file for silence." << std::endl;
+            reader->close();
+            return false;
+        }
+        trimmed = trimmedReader.isTrimmed();
+        if (trimmed) {
+            reader = &trimmedReader;
+            srcFrames = trimmedReader.getFrames();
+        }
     }
 
-    // Check the subformat mask to check if the file is already 16 bit
-    // If true, then use copyFile and close inFile.
+    // If the file is already 16 bit at the target rate, copy it instead
+    // of converting it and close the input.
     subformat = sfinfo.format & SF_FORMAT_SUBMASK;
-    if (subformat == SF_FORMAT_PCM_16) {
-        std::cout << "[!] File is already 16 bit. Copying instead.." << std::endl;
-        copyFile(inPath, outPath);
-        sf_close(inFile);
-        return;
-    } 
+    if (!trimmed && settings.normalize.mode == NormalizeMode::None) {
+        ScopedTimer timer(Stage::Copy);
+        // A WAV already in memory is handed back to be written as it is
+        const std::vector<unsigned char>& bytes = memorySource.getBytes();
+        if (inMemory && reader == &mappedReader && canFastCopy(sfinfo, profile) &&
+            std::memcmp(bytes.data(), "RIFF", 4) == 0 && std::memcmp(bytes.data() + 8, "WAVE", 4) == 0) {
+            std::cout << "[!] File is already 16 bit at the target rate. Copying instead.." << std::endl;
+            reader->close();
+            asyncIO->write(outPath, std::move(memorySource.getBytes()), getRecorder(inPath, outPath));
+            memorySource = MemoryFile();
+            return true;
+        }
+        if (tryFastCopy(inPath, tempPath.c_str(), sfinfo, profile)) {
+            reader->close();
+            if (!commitTempFile(outPath)) {
+                return false;
+            }
+            recordOutput(inPath, outPath);
+            return true;
+        }
+    }
 
-    // Allocate memory in fArray
-    std::vector<double> fArray(sfinfo.frames * sfinfo.channels);
-    double* fData = fArray.data();
+    const int channels = sfinfo.channels;
+    const int srcRate = sfinfo.samplerate;
+    const int outChannels = profile.channels > 0 ? profile.channels : channels;
 
-    // Read the frames to fArray
-    rFrames = sf_readf_double(inFile, fData, sfinfo.frames);
+    // Build the per-channel resamplers for this source rate; matching rates
+    // skip them. The quantizer is specialized for the output encoding.
+    engine.setup(srcRate, profile.sampleRate, channels, outChannels, blockFrames, profile.resampler);
+    quantizer.setup(outChannels, profile.format, profile.container == Container::AIFF,
+                    settings.dither, settings.noiseShape);
+    inBlock.resize(static_cast<size_t>(blockFrames) * channels);
+    pcmBlock.resize(static_cast<size_t>(engine.getMaxOutFrames()) * quantizer.getFrameBytes());
 
-    // Close the input file as it is no longer needed
-    sf_close(inFile);
+    // Total number of frames the output should contain, used to cut the
+    // flushed resampler tail to length and to preallocate the output
+    const sf_count_t outTotal = engine.isPassthrough() ? srcFrames : static_cast<sf_count_t>(
+        std::ceil(srcFrames * static_cast<double>(profile.sampleRate) / srcRate));
 
-    // Set the format to WAV_PCM_16 for writing
-    sfinfo.samplerate = 48000;
-    sfinfo.channels = 2;
-    sfinfo.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+    // Describe the output profile to libsndfile
+    SF_INFO outInfo = sfinfo;
+    outInfo.samplerate = profile.sampleRate;
+    outInfo.channels = outChannels;
+    outInfo.format = getSndfileFormat(profile);
 
     //Open the outfile
-    SNDFILE *outFile = sf_open(outPath, SFM_WRITE, &sfinfo);
+    AudioWriter* writer;
+    bool outInMemory;
+    {
+        ScopedTimer timer(Stage::Open);
+        outInMemory = asyncIO && outTotal * quantizer.getFrameBytes() <= static_cast<sf_count_t>(AsyncFileIO::maxFileBytes);
+        writer = openWriter(tempPath.c_str(), outInfo, outTotal, outInMemory);
+    }
+
+    if (!writer) {
+        std::cerr << "Error opening the output file." << std::endl;
+        reader->close();
+        discardTempFile(outPath);
+        return false;
+    }
+
+    // Normalizing measures the converted frames first. Outputs that fit the
+    // look-ahead are kept and written from memory, longer ones are
+    // converted a second time from the start of the source.
+    bool held = false;
+    bool ok = true;
+    if (settings.normalize.mode != NormalizeMode::None) {
+        held = outTotal <= static_cast<sf_count_t>(settings.normalize.lookaheadSeconds * profile.sampleRate);
+        measureLevel(*reader, channels, outChannels, outTotal, held);
+        if (!held) {
+            engine.reset();
+            if (!reader->seek(0)) {
+                std::cerr << "Error rewinding the input file for the second pass." << std::endl;
+                ok = false;
+            }
+        }
+    }
+
+    // Sliced files are resampled on every worker, other large files overlap
+    // reading, resampling and writing on three threads
+    if (ok && held) {
+        ok = writeHeld(*writer, outChannels, outTotal);
+    } else if (ok && settings.slice && scheduler && reader == &mappedReader &&
+               slicer.plan(engine, srcFrames, scheduler->getThreadCount())) {
+        ok = slicer.run(mappedReader, *writer, engine, quantizer, *scheduler, blockFrames, outTotal, rFrames, wFrames);
+    } else if (ok && settings.pipeline && srcFrames >= pipelineMinFrames) {
+        if (!pipeline) {
+            pipeline.reset(new Pipeline());
+        }
+        ok = pipeline->run(*reader, *writer, engine, quantizer, channels, blockFrames, outTotal, rFrames, wFrames);
+    } else if (ok) {
+        ok = streamSerial(*reader, *writer, channels, outTotal);
+    }
+
+    // Close both files, closing the output flushes what is left to disk
+    reader->close();
+    memorySource = MemoryFile();
+    {
+        ScopedTimer timer(Stage::Write);
+        if (!writer->close()) {
+            std::cerr << "Error closing the output file." << std::endl;
+            ok = false;
+        }
+    }
+
+    // An output built in memory is written behind, while the next file converts
+    if (ok && outInMemory) {
+        asyncIO->write(outPath, std::move(writer == &mappedWriter ? outputBytes : memoryOutput.getBytes()),
+                       getRecorder(inPath, outPath));
+    } else if (ok) {
+        ok = commitTempFile(outPath);
+        if (ok) {
+            recordOutput(inPath, outPath);
+        }
+    } else if (!outInMemory) {
+        discardTempFile(outPath);
+    }
+    return ok;
+}
+
+/**
+ * @brief Adds a finished output to the journal, if there is one, and
+ * reports it to the onOutput callback.
+ * @param inPath Path of the source.
+ * @param outPath Final path of the output.
+ */
+void Converter::recordOutput(const char* inPath, const char* outPath)
+{
+    if (journal) {
+        journal->record(inPath, getParams(), outPath);
+    }
+    if (onOutput) {
+        onOutput();
+    }
+}
+
+/**
+ * @brief Makes the callback that records an output written behind.
+ * @param inPath Path of the source.
+ * @param outPath Final path of the output.
+ * @return Callback for AsyncFileIO::write, empty without a journal or onOutput.
+ */
+std::function<void()> Converter::getRecorder(const char* inPath, const char* outPath)
+{
+    if (!journal && !onOutput) {
+        return nullptr;
+    }
+    return [journal = journal, onOutput = onOutput, source = std::string(inPath), params = getParams(),
+            output = std::string(outPath)]() {
+        if (journal) {
+            journal->record(source, params, output);
+        }
+        if (onOutput) {
+            onOutput();
+        }
+    };
+}
+
+/**
+ * @brief Streams a file through the engine and quantizer on the calling thread.
+ * @param reader Source file.
+ * @param writer Output file.
+ * @param channels Number of interleaved channels.
+ * @param outTotal Number of frames the output should contain.
+ * @return bool indicating whether the whole output was written.
+ */
+bool Converter::streamSerial(AudioReader& reader, AudioWriter& writer, int channels, sf_count_t outTotal)
+{
+    using instrument::ScopedTimer;
+    using instrument::Stage;
+
+    rFrames = 0;
+    wFrames = 0;
+    bool endOfInput = false;
+    bool ok = true;
+
+    while (wFrames < outTotal) {
+        // Read the next block, once the input runs dry keep feeding silence
+        // to flush the samples still held inside the resamplers
+        sf_count_t got = 0;
+        if (!endOfInput) {
+            ScopedTimer timer(Stage::Read);
+            got = reader.read(inBlock.data(), blockFrames);
+        }
+        if (got < blockFrames) {
+            std::fill(inBlock.begin() + got * channels, inBlock.end(), 0.0);
+            endOfInput = true;
+        }
+        rFrames += got;
+
+        const double* outBlock;
+        int outFrames;
+        {
+            ScopedTimer timer(Stage::Resample);
+            outFrames = engine.process(inBlock.data(), blockFrames, outBlock);
+        }
+
+        // Quantize and write the converted frames, trimming anything past the expected length
+        sf_count_t toWrite = std::min<sf_count_t>(outFrames, outTotal - wFrames);
+        if (toWrite > 0) {
+            {
+                ScopedTimer timer(Stage::Quantize);
+                quantizer.process(outBlock, pcmBlock.data(), static_cast<int>(toWrite));
+            }
+
+            sf_count_t written;
+            {
+                ScopedTimer timer(Stage::Write);
+                written = writer.write(pcmBlock.data(), toWrite);
+            }
+            wFrames += written;
+            if (written < toWrite) {
+                std::cerr << "Error writing the output file." << std::endl;
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    return ok;
+}
+
+/**
+ * @brief Converts the whole source to measure its level, without writing anything.
+ * The meter reads the engine's output blocks in place, and sets the
+ * quantizer's gain at the end.
+ * @param reader Source file, at its first frame.
+ * @param channels Number of interleaved source channels.
+ * @param outChannels Number of interleaved output channels.
+ * @param outTotal Number of frames the output should contain.
+ * @param hold Whether to keep the converted frames for writeHeld().
+ */
+void Converter::measureLevel(AudioReader& reader, int channels, int outChannels, sf_count_t outTotal, bool hold)
+{
+    using instrument::ScopedTimer;
+    using instrument::Stage;
 
-    // Resample with r8brain 
-    r8b::CDSPResampler16 resampler(sfinfo.samplerate, sfinfo.samplerate, fArray.size());
-    resampler.process(fData, fArray.size(), fData);
+    meter.setup(settings.output.sampleRate, outChannels, settings.normalize.mode == NormalizeMode::Loudness);
+    if (hold) {
+        held.resize(static_cast<size_t>(outTotal) * outChannels);
+    }
+
+    sf_count_t produced = 0;
+    bool endOfInput = false;
+    while (produced < outTotal) {
+        sf_count_t got = 0;
+        if (!endOfInput) {
+            ScopedTimer timer(Stage::Read);
+            got = reader.read(inBlock.data(), blockFrames);
+        }
+        if (got < blockFrames) {
+            std::fill(inBlock.begin() + got * channels, inBlock.end(), 0.0);
+            endOfInput = true;
+        }
+
+        const double* outBlock;
+        int outFrames;
+        {
+            ScopedTimer timer(Stage::Resample);
+            outFrames = engine.process(inBlock.data(), blockFrames, outBlock);
+        }
+
+        const sf_count_t kept = std::min<sf_count_t>(outFrames, outTotal - produced);
+        if (kept > 0) {
+            ScopedTimer timer(Stage::Measure);
+            meter.process(outBlock, static_cast<int>(kept));
+            if (hold) {
+                std::copy(outBlock, outBlock + kept * outChannels, held.begin() + produced * outChannels);
+            }
+            produced += kept;
+        }
+    }
+
+    quantizer.setGain(meter.getGain(settings.normalize));
+}
+
+/**
+ * @brief Quantizes and writes the frames kept by measureLevel().
+ * @param writer Output file.
+ * @param outChannels Number of interleaved output channels.
+ * @param outTotal Number of frames the output should contain.
+ * @return bool indicating whether the whole output was written.
+ */
+bool Converter::writeHeld(AudioWriter& writer, int outChannels, sf_count_t outTotal)
+{
+    using instrument::ScopedTimer;
+    using instrument::Stage;
 
-    // Write the converter frames to 
-    wFrames = sf_write_double(outFile, &fArray[0], fArray.size());
+    const int chunkFrames = engine.getMaxOutFrames();
+    for (wFrames = 0; wFrames < outTotal;) {
+        const int frames = static_cast<int>(std::min<sf_count_t>(chunkFrames, outTotal - wFrames));
+        {
+            ScopedTimer timer(Stage::Quantize);
+            quantizer.process(held.data() + static_cast<size_t>(wFrames) * outChannels, pcmBlock.data(), frames);
+        }
 
-    // Free the allocated memory and close the outfile
-    sf_close(outFile);
-    fArray.clear();
+        sf_count_t written;
+        {
+            ScopedTimer timer(Stage::Write);
+            written = writer.write(pcmBlock.data(), frames);
+        }
+        wFrames += written;
+        if (written < frames) {
+            std::cerr << "Error writing the output file." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Describes the parameters of a conversion.
+ * Outputs written with equal parameter strings are interchangeable.
+ * @param settings Settings of the conversion.
+ * @return std::string containing the parameters.
+ */
+std::string getConversionParams(const ConversionSettings& settings)
+{
+    std::string params = describeProfile(settings.output) + "/" +
+                         getDitherModeName(settings.dither) + "/" + getNoiseShapeName(settings.noiseShape);
+    if (settings.trim.enabled) {
+        params += "/" + describeTrim(settings.trim);
+    }
+    if (settings.normalize.mode != NormalizeMode::None) {
+        params += "/" + describeNormalize(settings.normalize);
+    }
+    return params;
+}
+
+/**
+ * @brief Describes the conversion parameters of this converter.
+ * @return std::string containing the parameters.
+ */
+std::string Converter::getParams() const
+{
+    return getConversionParams(settings);
 }
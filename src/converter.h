@@ -8,21 +8,124 @@
   ==============================================================================
 */
 
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <sndfile.h>
 #include <vector>
+#include "arena.h"
+#include "asyncfile.h"
+#include "audioio.h"
+#include "engine.h"
+#include "journal.h"
+#include "loudness.h"
+#include "mappedfile.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "quantizer.h"
+#include "slicer.h"
+#include "trim.h"
 
 #ifndef CONVERTER_H
 #define CONVERTER_H
 
+/**
+ * @brief Parameters shared by every Converter of a run.
+ */
+struct ConversionSettings {
+    OutputProfile output;
+    DitherMode dither = DitherMode::TPDF;
+    NoiseShape noiseShape = NoiseShape::None;
+    bool pipeline = true;
+    bool mappedIO = true;
+    // Directory runs read small sources ahead and write small outputs behind
+    bool asyncIO = false;
+    // Single long files are resampled as slices on every worker
+    bool slice = false;
+    TrimSettings trim;
+    NormalizeSettings normalize;
+};
+
+bool canFastCopy(const SF_INFO& sfinfo, const OutputProfile& profile);
+bool tryFastCopy(const char* inPath, const char* outPath, const SF_INFO& sfinfo, const OutputProfile& profile);
+int getSndfileFormat(const OutputProfile& profile);
+std::string getConversionParams(const ConversionSettings& settings);
+
 class Converter
 {
 public:
-    void convert(const char* inPath, const char* outPath);
+    Converter() = default;
+    explicit Converter(const ConversionSettings& settings) : settings(settings) {}
+
+    void setScheduler(TaskScheduler* scheduler)
+    {
+        this->scheduler = scheduler;
+        engine.setScheduler(scheduler);
+    }
+    void setSettings(const ConversionSettings& newSettings) { settings = newSettings; }
+    void setAsyncIO(AsyncFileIO* io) { asyncIO = io; }
+    void setJournal(Journal* journal) { this->journal = journal; }
+    void setOnOutput(std::function<void()> callback) { onOutput = std::move(callback); }
+
+    bool convert(const char* inPath, const char* outPath);
+    std::string getParams() const;
 
 private:
+    AudioReader* openReader(const char* path, SF_INFO& info, bool inMemory);
+    AudioWriter* openWriter(const char* path, SF_INFO& info, sf_count_t frames, bool inMemory);
+    bool streamSerial(AudioReader& reader, AudioWriter& writer, int channels, sf_count_t outTotal);
+    void measureLevel(AudioReader& reader, int channels, int outChannels, sf_count_t outTotal, bool hold);
+    bool writeHeld(AudioWriter& writer, int outChannels, sf_count_t outTotal);
+    void recordOutput(const char* inPath, const char* outPath);
+    std::function<void()> getRecorder(const char* inPath, const char* outPath);
+
+    // Number of frames read from the input file per block
+    static const int blockFrames = 8192;
+
+    // Files at least this long are converted by the three stage pipeline
+    static const sf_count_t pipelineMinFrames = 1 << 21;
+
+    ConversionSettings settings;
     int subformat;
     sf_count_t rFrames, wFrames;
+
+    // Streaming buffers, sized once per file and reused for every block,
+    // drawn from the worker's arena
+    arena::Vector<double> inBlock;
+    arena::Vector<unsigned char> pcmBlock;
+    ConversionEngine engine;
+    Quantizer quantizer;
+    std::unique_ptr<Pipeline> pipeline;
+    Slicer slicer;
+    TaskScheduler* scheduler = nullptr;
+
+    // Native readers and writers for plain PCM, libsndfile for the rest
+    MappedReader mappedReader;
+    SndfileReader sndfileReader;
+    MappedWriter mappedWriter;
+    SndfileWriter sndfileWriter;
+
+    // Source read ahead and output built in memory, for files small
+    // enough to go through asyncIO
+    AsyncFileIO* asyncIO = nullptr;
+    MemoryFile memorySource;
+    MemoryFile memoryOutput;
+    std::vector<unsigned char> outputBytes;
+
+    // Finished outputs are logged here during directory runs
+    Journal* journal = nullptr;
+    // Called once the output of the next convert() is in place, on the
+    // I/O thread if it is written behind, and not at all if it fails
+    std::function<void()> onOutput;
+
+    // Wraps whichever reader is open when silence is trimmed
+    TrimmedReader trimmedReader;
+
+    // Level of the converted frames, and the frames themselves while
+    // they fit the look-ahead, when normalizing
+    LevelMeter meter;
+    arena::Vector<double> held;
 };
 
 #endif /* CONVERTER_H */
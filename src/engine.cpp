@@ -0,0 +1,201 @@
+/*
+  ==============================================================================
+
+    engine.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "engine.h"
+#include <algorithm>
+
+/**
+ * @brief Prepares the engine for a new stream.
+ * Takes one resampler per source channel from the pool and sizes the
+ * scratch buffers. Resamplers from the previous stream go back to the pool.
+ * @param srcRate Sample rate of the source.
+ * @param dstRate Sample rate the output should have.
+ * @param channels Number of interleaved source channels.
+ * @param outChannels Number of interleaved output channels.
+ * @param maxInFrames Largest number of frames passed to a single process call.
+ * @param spec Filter parameters of the resamplers.
+ */
+void ConversionEngine::setup(int srcRate, int dstRate, int channels, int outChannels, int maxInFrames,
+                             const ResamplerSpec& spec)
+{
+    releaseResamplers();
+
+    this->srcRate = srcRate;
+    this->dstRate = dstRate;
+    this->channels = channels;
+    this->outChannels = outChannels;
+    this->maxInFrames = maxInFrames;
+    this->spec = spec;
+    passthrough = (srcRate == dstRate);
+    resampledChannels = std::min(channels, outChannels);
+
+    if (outChannels != channels) {
+        buildMixMatrix(channels, outChannels, mix);
+    } else {
+        mix.clear();
+    }
+
+    if (passthrough) {
+        maxOutFrames = maxInFrames;
+        if (!mix.empty()) {
+            outBlock.resize(static_cast<size_t>(maxOutFrames) * outChannels);
+        }
+        return;
+    }
+
+    for (int c = 0; c < resampledChannels; c++) {
+        resamplers.push_back(pool.acquire(srcRate, dstRate, maxInFrames, spec));
+    }
+
+    maxOutFrames = resamplers[0]->getMaxOutLen(maxInFrames);
+    chanBlocks.resize(resampledChannels);
+    for (auto& block : chanBlocks) {
+        block.resize(maxInFrames);
+    }
+    chanOut.assign(resampledChannels, nullptr);
+    chanOutFrames.assign(resampledChannels, 0);
+    outBlock.resize(static_cast<size_t>(maxOutFrames) * outChannels);
+}
+
+/**
+ * @brief Prepares the engine to convert exactly as another one does.
+ * @param other Engine already set up for the stream.
+ */
+void ConversionEngine::setupLike(const ConversionEngine& other)
+{
+    setup(other.srcRate, other.dstRate, other.channels, other.outChannels, other.maxInFrames, other.spec);
+}
+
+/**
+ * @brief Hands the resamplers of the current stream back to the pool.
+ */
+void ConversionEngine::releaseResamplers()
+{
+    for (auto& resampler : resamplers) {
+        pool.release(srcRate, dstRate, maxInFrames, std::move(resampler), spec);
+    }
+    resamplers.clear();
+}
+
+/**
+ * @brief Returns the engine to the start of a stream without rebuilding it.
+ * Clears what the resamplers hold of the current stream, so the next
+ * block is converted as the first block of a new stream.
+ */
+void ConversionEngine::reset()
+{
+    for (auto& resampler : resamplers) {
+        resampler->clear();
+    }
+}
+
+/**
+ * @brief Gets the number of source frames consumed before the first output frame.
+ * r8brain removes its filter delay itself by holding back output until it
+ * has seen this many frames, so it is the latency the resamplers add.
+ * @return Number of source frames, zero in passthrough mode.
+ */
+int ConversionEngine::getPrimingFrames() const
+{
+    return resamplers.empty() ? 0 : resamplers[0]->getInLenBeforeOutPos(0);
+}
+
+/**
+ * @brief Gets the fractional delay r8brain leaves in the output.
+ * @return Delay in output frames, usually zero with linear-phase filters.
+ */
+double ConversionEngine::getLatencyFrac() const
+{
+    return resamplers.empty() ? 0.0 : resamplers[0]->getLatencyFrac();
+}
+
+/**
+ * @brief Gets the period after which the resamplers repeat their processing.
+ * A stream started a whole number of periods later, on a cleared engine,
+ * converts to the very same output frames once the memory frames before the
+ * kept output have been fed, which lets a long stream be converted in slices.
+ * @param inFrames Receives the period in source frames.
+ * @param outFrames Receives the number of output frames per period.
+ * @param memoryFrames Receives the most source frames an output frame depends on.
+ * @return bool indicating whether the resamplers are periodic, false in
+ * passthrough mode and where r8brain keeps non-integer positions.
+ */
+bool ConversionEngine::getStatePeriod(int& inFrames, int& outFrames, int& memoryFrames) const
+{
+    return !resamplers.empty() && resamplers[0]->getStatePeriod(inFrames, outFrames, memoryFrames);
+}
+
+/**
+ * @brief Deinterleaves (or mixes down) and resamples a single channel of a block.
+ * Touches only the state of that channel, so channels can run concurrently.
+ * @param channel Index of the channel to resample.
+ */
+void ConversionEngine::resampleChannel(int channel)
+{
+    double* block = chanBlocks[channel].data();
+    if (outChannels < channels) {
+        mixChannel(blockIn, channels, &mix[static_cast<size_t>(channel) * channels], blockInFrames, block);
+    } else {
+        deinterleave(blockIn, channels, channel, blockInFrames, block);
+    }
+    chanOutFrames[channel] = resamplers[channel]->process(block, blockInFrames, chanOut[channel]);
+}
+
+/**
+ * @brief Resamples a block of interleaved frames.
+ * @param in Interleaved input frames.
+ * @param frames Number of frames in the input block.
+ * @param out Receives a pointer to the interleaved output frames. The buffer
+ * is owned by the engine (or is the input block in passthrough mode) and
+ * stays valid until the next call.
+ * @return Number of frames available in out.
+ */
+int ConversionEngine::process(const double* in, int frames, const double*& out)
+{
+    if (passthrough) {
+        if (mix.empty()) {
+            out = in;
+            return frames;
+        }
+        mixFrames(in, channels, mix.data(), outChannels, frames, outBlock.data());
+        out = outBlock.data();
+        return frames;
+    }
+
+    blockIn = in;
+    blockInFrames = frames;
+
+    if (scheduler && scheduler->getThreadCount() > 1 && resampledChannels > 1) {
+        // Every channel after the first becomes a task idle workers can
+        // steal, the calling worker resamples the first one itself. The
+        // block is passed through members so the captures stay small
+        // enough not to allocate.
+        TaskGroup group(*scheduler);
+        for (int c = 1; c < resampledChannels; c++) {
+            group.run([this, c]() { resampleChannel(c); });
+        }
+        resampleChannel(0);
+        group.wait();
+    } else {
+        for (int c = 0; c < resampledChannels; c++) {
+            resampleChannel(c);
+        }
+    }
+
+    // Reinterleave (or mix up) on the calling thread, channels share cache lines here
+    if (outChannels > channels) {
+        mixPlanar(chanOut.data(), channels, mix.data(), outChannels, chanOutFrames[0], outBlock.data());
+    } else {
+        interleavePlanar(chanOut.data(), outChannels, chanOutFrames[0], outBlock.data());
+    }
+
+    out = outBlock.data();
+    return chanOutFrames[0];
+}
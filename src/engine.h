@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    engine.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <memory>
+#include <vector>
+#include "arena.h"
+#include "channelops.h"
+#include "resamplerpool.h"
+#include "scheduler.h"
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+/**
+ * @brief Per-channel sample rate conversion engine.
+ * Splits interleaved frames into per-channel scratch buffers, runs each
+ * channel through its own r8brain resampler and interleaves the result
+ * again. When the source and target rates match no resampler is created
+ * and frames are passed straight through. Resamplers are taken from and
+ * returned to the engine's own pool, so consecutive files at the same
+ * rates reuse them. With a scheduler attached, the channels of a block
+ * are resampled as parallel tasks on the shared worker pool. When the
+ * output has a different channel count, fewer channels are mixed down
+ * before resampling and more are mixed up afterwards, so only
+ * min(source, output) channels are ever resampled.
+ */
+class ConversionEngine
+{
+public:
+    void setup(int srcRate, int dstRate, int channels, int outChannels, int maxInFrames,
+               const ResamplerSpec& spec = ResamplerSpec());
+    int process(const double* in, int frames, const double*& out);
+    void reset();
+    void setupLike(const ConversionEngine& other);
+
+    void setScheduler(TaskScheduler* scheduler) { this->scheduler = scheduler; }
+
+    bool isPassthrough() const { return passthrough; }
+    int getOutChannels() const { return outChannels; }
+    int getMaxOutFrames() const { return maxOutFrames; }
+    int getPrimingFrames() const;
+    double getLatencyFrac() const;
+    bool getStatePeriod(int& inFrames, int& outFrames, int& memoryFrames) const;
+
+private:
+    void releaseResamplers();
+    void resampleChannel(int channel);
+
+    int srcRate = 0;
+    int dstRate = 0;
+    int channels = 0;
+    int outChannels = 0;
+    int maxInFrames = 0;
+    int maxOutFrames = 0;
+    bool passthrough = true;
+    ResamplerSpec spec;
+
+    // Number of channels that go through a resampler
+    int resampledChannels = 0;
+
+    // Output channels x source channels gains, empty when the counts match
+    std::vector<double> mix;
+
+    ResamplerPool pool;
+    TaskScheduler* scheduler = nullptr;
+    std::vector<std::unique_ptr<r8b::CDSPResampler>> resamplers;
+
+    // Per-channel scratch so channels can be resampled concurrently
+    const double* blockIn = nullptr;
+    int blockInFrames = 0;
+    std::vector<arena::Vector<double>> chanBlocks;
+    std::vector<double*> chanOut;
+    std::vector<int> chanOutFrames;
+    arena::Vector<double> outBlock;
+};
+
+#endif /* ENGINE_H */
@@ -0,0 +1,364 @@
+/*
+  ==============================================================================
+
+    fanout.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "fanout.h"
+#include <algorithm>
+#include <cmath>
+#include "filecopy.h"
+#include "instrument.h"
+
+/**
+ * @brief Opens the source with the native reader, or libsndfile for formats it does not handle.
+ * @param path Path of the file.
+ * @param info Receives the format of the file.
+ * @return The open reader, or nullptr if neither could open the file.
+ */
+AudioReader* FanOutConverter::openReader(const char* path, SF_INFO& info)
+{
+    if (settings.mappedIO && mappedReader.open(path, info)) {
+        return &mappedReader;
+    }
+    if (sndfileReader.open(path, info)) {
+        return &sndfileReader;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Prepares the mix, quantizer and output file of a branch.
+ * The branch's group must already be set up for the source.
+ * @param branch Branch to prepare.
+ * @param sfinfo Format of the source.
+ * @return bool indicating whether the output file could be created, under
+ * its temporary name.
+ */
+bool FanOutConverter::openBranch(Branch& branch, const SF_INFO& sfinfo)
+{
+    using instrument::ScopedTimer;
+    using instrument::Stage;
+
+    const OutputProfile& profile = branch.output->profile;
+    const Group& group = *branch.group;
+    const int maxOutFrames = group.engine.getMaxOutFrames();
+
+    if (branch.channels != group.channels) {
+        buildMixMatrix(group.channels, branch.channels, branch.mix);
+        branch.mixed.resize(static_cast<size_t>(maxOutFrames) * branch.channels);
+    } else {
+        branch.mix.clear();
+    }
+
+    branch.quantizer.setup(branch.channels, profile.format, profile.container == Container::AIFF,
+                           settings.dither, settings.noiseShape);
+    branch.pcmBlock.resize(static_cast<size_t>(maxOutFrames) * branch.quantizer.getFrameBytes());
+    branch.written = 0;
+
+    SF_INFO outInfo = sfinfo;
+    outInfo.samplerate = profile.sampleRate;
+    outInfo.channels = branch.channels;
+    outInfo.format = getSndfileFormat(profile);
+
+    ScopedTimer timer(Stage::Open);
+    const std::string tempPath = getTempPath(branch.output->path);
+    const char* path = tempPath.c_str();
+    if (settings.mappedIO && branch.mappedWriter.open(path, profile.container, profile.format,
+                                                      outInfo.samplerate, outInfo.channels, group.outTotal)) {
+        branch.writer = &branch.mappedWriter;
+    } else if (branch.sndfileWriter.open(path, outInfo, branch.quantizer.getFrameBytes())) {
+        branch.writer = &branch.sndfileWriter;
+    } else {
+        branch.writer = nullptr;
+    }
+    return branch.writer != nullptr;
+}
+
+/**
+ * @brief Streams the source through every group and branch once.
+ * @param reader Source file, at its first frame.
+ * @param channels Number of interleaved source channels.
+ * @param groupCount Number of groups in use.
+ * @param branchCount Number of branches in use.
+ * @param measure Feeds each branch's meter instead of quantizing and writing.
+ * @return bool indicating whether every output was written.
+ */
+bool FanOutConverter::runPass(AudioReader& reader, int channels, size_t groupCount, size_t branchCount, bool measure)
+{
+    using instrument::ScopedTimer;
+    using instrument::Stage;
+
+    bool ok = true;
+    if (measure) {
+        for (size_t b = 0; b < branchCount; b++) {
+            Branch& branch = *branches[b];
+            branch.meter.setup(branch.output->profile.sampleRate, branch.channels,
+                               settings.normalize.mode == NormalizeMode::Loudness);
+        }
+    }
+
+    bool endOfInput = false;
+
+    while (true) {
+        bool pending = false;
+        for (size_t g = 0; g < groupCount; g++) {
+            pending = pending || groups[g]->produced < groups[g]->outTotal;
+        }
+        if (!pending) {
+            break;
+        }
+
+        // Read the next block once for every output, then keep feeding
+        // silence to flush the resamplers
+        sf_count_t got = 0;
+        if (!endOfInput) {
+            ScopedTimer timer(Stage::Read);
+            got = reader.read(inBlock.data(), blockFrames);
+        }
+        if (got < blockFrames) {
+            std::fill(inBlock.begin() + got * channels, inBlock.end(), 0.0);
+            endOfInput = true;
+        }
+
+        for (size_t g = 0; g < groupCount; g++) {
+            Group& group = *groups[g];
+            if (group.produced >= group.outTotal) {
+                continue;
+            }
+
+            const double* outBlock;
+            int outFrames;
+            {
+                ScopedTimer timer(Stage::Resample);
+                outFrames = group.engine.process(inBlock.data(), blockFrames, outBlock);
+            }
+
+            const sf_count_t toWrite = std::min<sf_count_t>(outFrames, group.outTotal - group.produced);
+            group.produced += std::max<sf_count_t>(toWrite, 0);
+            if (toWrite <= 0) {
+                continue;
+            }
+
+            for (size_t b = 0; b < branchCount; b++) {
+                Branch& branch = *branches[b];
+                if (branch.group != &group || !branch.ok) {
+                    continue;
+                }
+
+                const double* src = outBlock;
+                if (!branch.mix.empty()) {
+                    ScopedTimer timer(Stage::Quantize);
+                    mixFrames(outBlock, group.channels, branch.mix.data(), branch.channels,
+                              static_cast<int>(toWrite), branch.mixed.data());
+                    src = branch.mixed.data();
+                }
+                if (measure) {
+                    ScopedTimer timer(Stage::Measure);
+                    branch.meter.process(src, static_cast<int>(toWrite));
+                    continue;
+                }
+                {
+                    ScopedTimer timer(Stage::Quantize);
+                    branch.quantizer.process(src, branch.pcmBlock.data(), static_cast<int>(toWrite));
+                }
+
+                sf_count_t written;
+                {
+                    ScopedTimer timer(Stage::Write);
+                    written = branch.writer->write(branch.pcmBlock.data(), toWrite);
+                }
+                branch.written += written;
+                if (written < toWrite) {
+                    std::cerr << "Error writing the output file " << branch.output->path << "." << std::endl;
+                    branch.ok = false;
+                    ok = false;
+                }
+            }
+        }
+    }
+
+    return ok;
+}
+
+/**
+ * @brief Converts a file into every requested output.
+ * Outputs that are a plain copy of the source are copied; the others are
+ * streamed from a single decode of the source. Each output is built under
+ * a temporary name and renamed into place once it is complete.
+ * @param inPath Path of the file to check/process.
+ * @param outputs Profiles and paths of the outputs.
+ * @return bool indicating whether every output was written successfully.
+ */
+bool FanOutConverter::convert(const char* inPath, const std::vector<FanOutOutput>& outputs)
+{
+    using instrument::ScopedTimer;
+    using instrument::Stage;
+
+    SF_INFO sfinfo;
+    AudioReader* reader;
+    {
+        ScopedTimer timer(Stage::Open);
+        reader = openReader(inPath, sfinfo);
+    }
+
+    if (!reader) {
+        std::cerr << "Error opening the input file." << std::endl;
+        return false;
+    }
+
+    const int channels = sfinfo.channels;
+    const int srcRate = sfinfo.samplerate;
+    sf_count_t srcFrames = sfinfo.frames;
+    bool ok = true;
+
+    // Every output is cut to the same audible part of the source
+    bool trimmed = false;
+    if (settings.trim.enabled) {
+        ScopedTimer timer(Stage::Read);
+        if (!trimmedReader.open(*reader, channels, srcRate, srcFrames, settings.trim)) {
+            std::cerr << "Error scanning the input file for silence." << std::endl;
+            reader->close();
+            return false;
+        }
+        trimmed = trimmedReader.isTrimmed();
+        if (trimmed) {
+            reader = &trimmedReader;
+            srcFrames = trimmedReader.getFrames();
+        }
+    }
+
+    // Give every output that needs DSP a branch, and every distinct rate
+    // pair and filter spec a group
+    size_t branchCount = 0;
+    size_t groupCount = 0;
+    for (const FanOutOutput& output : outputs) {
+        if (!trimmed && settings.normalize.mode == NormalizeMode::None) {
+            ScopedTimer timer(Stage::Copy);
+            if (tryFastCopy(inPath, getTempPath(output.path).c_str(), sfinfo, output.profile)) {
+                if (commitTempFile(output.path)) {
+                    recordOutput(inPath, output);
+                } else {
+                    ok = false;
+                }
+                continue;
+            }
+        }
+
+        if (branches.size() <= branchCount) {
+            branches.emplace_back(new Branch());
+        }
+        Branch& branch = *branches[branchCount++];
+        branch.output = &output;
+        branch.channels = output.profile.channels > 0 ? output.profile.channels : channels;
+        branch.group = nullptr;
+
+        const ResamplerSpec& spec = output.profile.resampler;
+        for (size_t g = 0; g < groupCount && !branch.group; g++) {
+            Group& group = *groups[g];
+            if (group.rate == output.profile.sampleRate && group.spec == spec) {
+                branch.group = &group;
+                group.channels = group.channels == branch.channels ? group.channels : channels;
+            }
+        }
+        if (!branch.group) {
+            if (groups.size() <= groupCount) {
+                groups.emplace_back(new Group());
+            }
+            branch.group = groups[groupCount++].get();
+            branch.group->rate = output.profile.sampleRate;
+            branch.group->spec = spec;
+            branch.group->channels = branch.channels;
+        }
+    }
+
+    // A group whose outputs disagree on channels resamples every source
+    // channel and lets each branch mix its own; otherwise the engine mixes
+    for (size_t g = 0; g < groupCount; g++) {
+        Group& group = *groups[g];
+        group.engine.setScheduler(scheduler);
+        group.engine.setup(srcRate, group.rate, channels, group.channels, blockFrames, group.spec);
+        group.outTotal = group.engine.isPassthrough() ? srcFrames : static_cast<sf_count_t>(
+            std::ceil(srcFrames * static_cast<double>(group.rate) / srcRate));
+        group.produced = 0;
+    }
+
+    for (size_t b = 0; b < branchCount; b++) {
+        Branch& branch = *branches[b];
+        branch.ok = openBranch(branch, sfinfo);
+        if (!branch.ok) {
+            std::cerr << "Error opening the output file " << branch.output->path << "." << std::endl;
+            ok = false;
+        }
+    }
+
+    inBlock.resize(static_cast<size_t>(blockFrames) * channels);
+
+    // Normalizing measures every output in a first pass, then converts
+    // again from the start of the source with each output's gain
+    bool rewound = true;
+    if (settings.normalize.mode != NormalizeMode::None) {
+        runPass(*reader, channels, groupCount, branchCount, true);
+        for (size_t b = 0; b < branchCount; b++) {
+            Branch& branch = *branches[b];
+            branch.quantizer.setGain(branch.meter.getGain(settings.normalize));
+        }
+        for (size_t g = 0; g < groupCount; g++) {
+            groups[g]->engine.reset();
+            groups[g]->produced = 0;
+        }
+        if (!reader->seek(0)) {
+            std::cerr << "Error rewinding the input file for the second pass." << std::endl;
+            rewound = false;
+            ok = false;
+        }
+    }
+    if (rewound) {
+        ok = runPass(*reader, channels, groupCount, branchCount, false) && ok;
+    }
+
+    // Close the source and every output, closing flushes what is left to
+    // disk, then move the complete outputs into place
+    reader->close();
+    for (size_t b = 0; b < branchCount; b++) {
+        Branch& branch = *branches[b];
+        if (!branch.writer) {
+            discardTempFile(branch.output->path);
+            continue;
+        }
+        ScopedTimer timer(Stage::Write);
+        if (!branch.writer->close()) {
+            std::cerr << "Error closing the output file " << branch.output->path << "." << std::endl;
+            branch.ok = false;
+        }
+        branch.writer = nullptr;
+
+        if (!branch.ok || !rewound) {
+            discardTempFile(branch.output->path);
+            ok = false;
+        } else if (commitTempFile(branch.output->path)) {
+            recordOutput(inPath, *branch.output);
+        } else {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief Adds a finished output to the journal, if there is one.
+ * @param inPath Path of the source.
+ * @param output Output now at its final path.
+ */
+void FanOutConverter::recordOutput(const char* inPath, const FanOutOutput& output)
+{
+    if (journal) {
+        ConversionSettings outputSettings = settings;
+        outputSettings.output = output.profile;
+        journal->record(inPath, getConversionParams(outputSettings), output.path);
+    }
+}
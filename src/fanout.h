@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    fanout.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "converter.h"
+
+#ifndef FANOUT_H
+#define FANOUT_H
+
+/**
+ * @brief An output file requested from a FanOutConverter.
+ */
+struct FanOutOutput {
+    OutputProfile profile;
+    std::string path;
+};
+
+/**
+ * @brief Converts one source into several output profiles in a single pass.
+ * The source is decoded once and every block feeds all outputs. Outputs
+ * with the same target rate and filter spec share one ConversionEngine,
+ * so each rate pair is resampled once; every output has its own channel
+ * mix, quantizer and writer. Engines and branches are kept between files,
+ * so a worker converting the same set of profiles reuses its resamplers.
+ * Normalized outputs are measured in a first pass over the source and
+ * written in a second one.
+ */
+class FanOutConverter
+{
+public:
+    explicit FanOutConverter(const ConversionSettings& settings) : settings(settings) {}
+
+    void setScheduler(TaskScheduler* scheduler) { this->scheduler = scheduler; }
+    void setJournal(Journal* journal) { this->journal = journal; }
+
+    bool convert(const char* inPath, const std::vector<FanOutOutput>& outputs);
+
+private:
+    /**
+     * @brief Resampling shared by the outputs at one target rate.
+     */
+    struct Group {
+        ConversionEngine engine;
+        int rate = 0;
+        ResamplerSpec spec;
+        // Channels the engine outputs, shared by the group's branches unless they mix further
+        int channels = 0;
+        sf_count_t outTotal = 0;
+        sf_count_t produced = 0;
+    };
+
+    /**
+     * @brief Mixing, quantizing and writing of a single output.
+     */
+    struct Branch {
+        const FanOutOutput* output = nullptr;
+        Group* group = nullptr;
+        int channels = 0;
+        std::vector<double> mix;
+        arena::Vector<double> mixed;
+        Quantizer quantizer;
+        arena::Vector<unsigned char> pcmBlock;
+        MappedWriter mappedWriter;
+        SndfileWriter sndfileWriter;
+        AudioWriter* writer = nullptr;
+        LevelMeter meter;
+        sf_count_t written = 0;
+        bool ok = true;
+    };
+
+    AudioReader* openReader(const char* path, SF_INFO& info);
+    bool openBranch(Branch& branch, const SF_INFO& sfinfo);
+    bool runPass(AudioReader& reader, int channels, size_t groupCount, size_t branchCount, bool measure);
+    void recordOutput(const char* inPath, const FanOutOutput& output);
+
+    // Number of frames read from the input file per block
+    static const int blockFrames = 8192;
+
+    ConversionSettings settings;
+    TaskScheduler* scheduler = nullptr;
+    // Finished outputs are logged here during directory runs
+    Journal* journal = nullptr;
+
+    arena::Vector<double> inBlock;
+    std::vector<std::unique_ptr<Group>> groups;
+    std::vector<std::unique_ptr<Branch>> branches;
+
+    MappedReader mappedReader;
+    SndfileReader sndfileReader;
+    TrimmedReader trimmedReader;
+};
+
+#endif /* FANOUT_H */
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    fftbackend.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "fftbackend.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "includes/r8brain/CDSPRealFFT.h"
+
+// Largest round trip error accepted from the FFT, single precision
+// backends land around -130 dB and double precision around -300 dB
+static const double maxErrorDb = -100.0;
+
+/**
+ * @brief Gets the name of the FFT backend r8brain was built with.
+ * The backend is chosen at build time, see FFT in the Makefile.
+ * @return const char* containing the backend name.
+ */
+const char* getFFTBackendName()
+{
+#if R8B_IPP
+    return "ipp";
+#elif R8B_PFFFT_DOUBLE
+    return "pffft-double";
+#elif R8B_PFFFT
+    return "pffft";
+#else
+    return "ooura";
+#endif
+}
+
+/**
+ * @brief Checks the FFT backend with a forward/inverse round trip.
+ * Transforms a deterministic pseudo random block and compares the result
+ * of the inverse transform with the original.
+ * @param errorDb Receives the peak round trip error relative to full scale.
+ * @return bool indicating whether the error is within bounds.
+ */
+bool runFFTSelfTest(double& errorDb)
+{
+    const int lenBits = 12;
+    r8b::CDSPRealFFTKeeper fft(lenBits);
+    const int len = fft->getLen();
+
+    std::vector<double> original(len);
+    uint32_t seed = 1;
+    for (int i = 0; i < len; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        original[i] = static_cast<double>(seed >> 8) / 8388608.0 - 1.0;
+    }
+
+    std::vector<double> block(original);
+    fft->forward(block.data());
+    fft->inverse(block.data());
+
+    double maxError = 0.0;
+    for (int i = 0; i < len; i++) {
+        maxError = std::max(maxError, std::fabs(block[i] * fft->getInvMulConst() - original[i]));
+    }
+
+    errorDb = 20.0 * std::log10(std::max(maxError, 1e-30));
+    return errorDb <= maxErrorDb;
+}
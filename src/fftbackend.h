@@ -0,0 +1,17 @@
+/*
+  ==============================================================================
+
+    fftbackend.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#ifndef FFTBACKEND_H
+#define FFTBACKEND_H
+
+const char* getFFTBackendName();
+bool runFFTSelfTest(double& errorDb);
+
+#endif /* FFTBACKEND_H */
@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+    filecopy.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "filecopy.h"
+#include "wavfile.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+
+/**
+ * @brief Owns a file descriptor and closes it when going out of scope.
+ */
+struct FileHandle {
+    int fd;
+    explicit FileHandle(int fd) : fd(fd) {}
+    ~FileHandle() { if (fd >= 0) close(fd); }
+};
+
+/**
+ * @brief Copies a byte range between two file descriptors.
+ * Uses copy_file_range so the data never enters userspace, falling back to
+ * sendfile and finally to a plain read/write loop when the kernel or
+ * filesystem refuses the faster calls.
+ * @param inFd Descriptor to copy from.
+ * @param offset Offset of the range in the source.
+ * @param length Number of bytes to copy.
+ * @param outFd Descriptor to copy to, at its current position.
+ * @return bool indicating whether the whole range was copied.
+ */
+static bool copyRange(int inFd, uint64_t offset, uint64_t length, int outFd)
+{
+    off_t inOffset = static_cast<off_t>(offset);
+
+#if defined(__linux__)
+    while (length > 0) {
+        ssize_t n = copy_file_range(inFd, &inOffset, outFd, nullptr, length, 0);
+        if (n <= 0) {
+            break;
+        }
+        length -= n;
+    }
+
+    while (length > 0) {
+        ssize_t n = sendfile(outFd, inFd, &inOffset, length);
+        if (n <= 0) {
+            break;
+        }
+        length -= n;
+    }
+#endif
+
+    char buffer[1 << 16];
+    while (length > 0) {
+        size_t chunk = length < sizeof(buffer) ? length : sizeof(buffer);
+        ssize_t n = pread(inFd, buffer, chunk, inOffset);
+        if (n <= 0) {
+            return false;
+        }
+        if (write(outFd, buffer, n) != n) {
+            return false;
+        }
+        inOffset += n;
+        length -= n;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Copies a file from a source path to destination path.
+ * Tries a reflink clone first (FICLONE, e.g. btrfs/XFS) so the copy shares
+ * the source's extents, then falls back to an in-kernel copy.
+ * @param sourcePath Source path of the file.
+ * @param destinationPath Destination path for the copied file.
+ * @return bool indicating whether the copy succeeded.
+ */
+bool copyFile(const std::string& sourcePath, const std::string& destinationPath)
+{
+    FileHandle in(open(sourcePath.c_str(), O_RDONLY));
+    if (in.fd < 0) {
+        std::cerr << "Error copying file: Failed to open source file" << std::endl;
+        return false;
+    }
+
+    FileHandle out(open(destinationPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (out.fd < 0) {
+        std::cerr << "Error copying file: Failed to open destination file" << std::endl;
+        return false;
+    }
+
+#if defined(FICLONE)
+    if (ioctl(out.fd, FICLONE, in.fd) == 0) {
+        return true;
+    }
+#endif
+
+    struct stat st;
+    if (fstat(in.fd, &st) != 0 || !copyRange(in.fd, 0, st.st_size, out.fd)) {
+        std::cerr << "Error copying file: " << sourcePath << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Copies a PCM payload into a new file behind a canonical WAV header.
+ * Used when only the container differs from the target, so the samples
+ * themselves are left untouched.
+ * @param sourcePath Source path of the file.
+ * @param destinationPath Destination path for the rewritten file.
+ * @param payloadOffset Offset of the PCM payload in the source.
+ * @param payloadLength Length of the PCM payload in bytes.
+ * @param sampleRate Sample rate of the payload.
+ * @param channels Number of interleaved channels in the payload.
+ * @param bitsPerSample Bits per sample of the payload.
+ * @return bool indicating whether the file was written.
+ */
+bool copyWithNewHeader(const std::string& sourcePath, const std::string& destinationPath,
+                       uint64_t payloadOffset, uint64_t payloadLength,
+                       int sampleRate, int channels, int bitsPerSample)
+{
+    FileHandle in(open(sourcePath.c_str(), O_RDONLY));
+    if (in.fd < 0) {
+        return false;
+    }
+
+    FileHandle out(open(destinationPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (out.fd < 0) {
+        return false;
+    }
+
+    return writeWavHeader(out.fd, sampleRate, channels, bitsPerSample, payloadLength) &&
+           copyRange(in.fd, payloadOffset, payloadLength, out.fd);
+}
+
+/**
+ * @brief Gets the path an output is written to before it is complete.
+ * Outputs are built next to their final path, on the same filesystem, so
+ * the rename that completes them is atomic and an interrupted run never
+ * leaves a partial file under the final name.
+ * @param path Final path of the output.
+ * @return std::string containing the temporary path.
+ */
+std::string getTempPath(const std::string& path)
+{
+    return path + ".tmp";
+}
+
+/**
+ * @brief Moves a complete output from its temporary path into place.
+ * Replaces any older output at the final path in one step. If the rename
+ * fails the temporary file is removed.
+ * @param path Final path of the output.
+ * @return bool indicating whether the output is now at its final path.
+ */
+bool commitTempFile(const std::string& path)
+{
+    const std::string tempPath = getTempPath(path);
+    if (rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error moving the output into place: " << path << std::endl;
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Removes the temporary file of an output that failed.
+ * @param path Final path of the output.
+ */
+void discardTempFile(const std::string& path)
+{
+    unlink(getTempPath(path).c_str());
+}
@@ -0,0 +1,26 @@
+/*
+  ==============================================================================
+
+    filecopy.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <cstdint>
+#include <string>
+
+#ifndef FILECOPY_H
+#define FILECOPY_H
+
+bool copyFile(const std::string& sourcePath, const std::string& destinationPath);
+bool copyWithNewHeader(const std::string& sourcePath, const std::string& destinationPath,
+                       uint64_t payloadOffset, uint64_t payloadLength,
+                       int sampleRate, int channels, int bitsPerSample);
+
+std::string getTempPath(const std::string& path);
+bool commitTempFile(const std::string& path);
+void discardTempFile(const std::string& path);
+
+#endif /* FILECOPY_H */
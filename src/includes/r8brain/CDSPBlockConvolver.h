@@ -212,6 +212,43 @@ public:
 		return(( MaxInLen * UpFactor + DownFactor - 1 ) / DownFactor );
 	}
 
+	virtual bool getStatePeriod( int& InPeriod, int& OutPeriod,
+		int& InMemory ) const
+	{
+		// Blocks of InputLen upsampled samples, which also have to keep
+		// the downsampling phase.
+
+		int a = InputLen;
+		int b = DownFactor;
+
+		while( b != 0 )
+		{
+			const int t = a % b;
+			a = b;
+			b = t;
+		}
+
+		const int p = InputLen / a * DownFactor;
+		int g = p;
+		b = UpFactor;
+
+		while( b != 0 )
+		{
+			const int t = g % b;
+			g = b;
+			b = t;
+		}
+
+		InPeriod = p / g;
+		OutPeriod = InPeriod * UpFactor / DownFactor;
+
+		// A block and the previous input it is convolved with, output
+		// up to a block later.
+
+		InMemory = ( BlockLen2 * 2 + UpFactor - 1 ) / UpFactor + 1;
+		return( true );
+	}
+
 	virtual void clear()
 	{
 		memset( &PrevInput[ 0 ], 0, PrevInputLen * sizeof( PrevInput[ 0 ]));
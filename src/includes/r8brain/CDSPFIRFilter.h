@@ -184,6 +184,7 @@ private:
 		///< by the user (positive value).
 	EDSPFilterPhaseResponse ReqPhase; ///< Required filter's phase response.
 	double ReqGain; ///< Required overall filter's gain.
+	int CacheNode; ///< Cache node (R8B_CACHENODE) *this filter was built on.
 	CDSPFIRFilter* Next; ///< Next FIR filter in cache's list.
 	int RefCount; ///< The number of references made to *this FIR filter.
 	bool IsZeroPhase; ///< "True" if kernel block of *this filter has
@@ -204,6 +205,42 @@ private:
 	{
 	}
 
+	#if R8B_KERNELCACHE
+
+	/**
+	 * Function copies a previously designed kernel out of the on-disk
+	 * kernel cache.
+	 *
+	 * @param CacheKey Design parameters of the filter.
+	 * @return "True" if the kernel was found.
+	 */
+
+	bool loadCachedFilter( const kernelcache :: FIRKey& CacheKey )
+	{
+		kernelcache :: FIRInfo Info;
+		size_t Count;
+		const double* const Data = kernelcache :: findFIR( CacheKey, Info,
+			Count );
+
+		if( Data == NULL || Count != (size_t) 2 << Info.blockLenBits )
+		{
+			return( false );
+		}
+
+		KernelLen = Info.kernelLen;
+		BlockLenBits = Info.blockLenBits;
+		Latency = Info.latency;
+		LatencyFrac = Info.latencyFrac;
+		IsZeroPhase = Info.zeroPhase;
+
+		KernelBlock.alloc( (int) Count );
+		memcpy( &KernelBlock[ 0 ], Data, Count * sizeof( KernelBlock[ 0 ]));
+
+		return( true );
+	}
+
+	#endif // R8B_KERNELCACHE
+
 	/**
 	 * Function builds filter kernel based on the "Req" parameters.
 	 *
@@ -213,6 +250,18 @@ private:
 
 	void buildLPFilter( const double* const ExtAttenCorrs )
 	{
+		#if R8B_KERNELCACHE
+
+		const kernelcache :: FIRKey CacheKey = { ReqNormFreq, ReqTransBand,
+			ReqAtten, ReqGain, (int) ReqPhase };
+
+		if( ExtAttenCorrs == NULL && loadCachedFilter( CacheKey ))
+		{
+			return;
+		}
+
+		#endif // R8B_KERNELCACHE
+
 		const double tb = ReqTransBand * 0.01;
 		double pwr;
 		double fo1;
@@ -523,6 +572,19 @@ private:
 			ffto -> forward( KernelBlock );
 		}
 
+		#if R8B_KERNELCACHE
+
+		if( ExtAttenCorrs == NULL )
+		{
+			const kernelcache :: FIRInfo Info = { KernelLen, BlockLenBits,
+				Latency, LatencyFrac, IsZeroPhase };
+
+			kernelcache :: storeFIR( CacheKey, Info, &KernelBlock[ 0 ],
+				(size_t) BlockLen * 2 );
+		}
+
+		#endif // R8B_KERNELCACHE
+
 		R8BCONSOLE( "CDSPFIRFilter: flt_len=%i latency=%i nfreq=%.4f "
 			"tb=%.1f att=%.1f gain=%.3f\n", KernelLen, Latency,
 			ReqNormFreq, ReqTransBand, ReqAtten, ReqGain );
@@ -597,6 +659,8 @@ public:
 		R8BASSERT( ReqAtten <= CDSPFIRFilter :: getLPMaxAtten() );
 		R8BASSERT( ReqGain > 0.0 );
 
+		const int CacheNode = R8B_CACHENODE;
+
 		R8BSYNC( StateSync );
 
 		CDSPFIRFilter* PrevObj = NULL;
@@ -608,7 +672,8 @@ public:
 				CurObj -> ReqTransBand == ReqTransBand &&
 				CurObj -> ReqGain == ReqGain &&
 				CurObj -> ReqAtten == ReqAtten &&
-				CurObj -> ReqPhase == ReqPhase )
+				CurObj -> ReqPhase == ReqPhase &&
+				CurObj -> CacheNode == CacheNode )
 			{
 				break;
 			}
@@ -665,6 +730,7 @@ public:
 			CurObj -> ReqAtten = ReqAtten;
 			CurObj -> ReqPhase = ReqPhase;
 			CurObj -> ReqGain = ReqGain;
+			CurObj -> CacheNode = CacheNode;
 			ObjCount++;
 
 			CurObj -> buildLPFilter( AttenCorrs );
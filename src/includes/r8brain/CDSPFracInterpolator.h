@@ -64,6 +64,7 @@ public:
 		, InterpPoints( aInterpPoints )
 		, ReqAtten( aReqAtten )
 		, IsThird( aIsThird )
+		, CacheNode( R8B_CACHENODE )
 		, Next( NULL )
 		, RefCount( 1 )
 	{
@@ -94,7 +95,27 @@ public:
 			FilterFracs = InitFilterFracs;
 		}
 
-		Table.alloc( FilterSize * ( FilterFracs + InterpPoints ));
+		const int TableSize = FilterSize * ( FilterFracs + InterpPoints );
+		Table.alloc( TableSize );
+
+		#if R8B_KERNELCACHE
+
+		const kernelcache :: FracKey CacheKey = { InitFilterFracs,
+			ElementSize, InterpPoints, ReqAtten, IsThird };
+
+		int CachedFracs;
+		size_t CachedCount;
+		const double* const CachedTable = kernelcache :: findFrac( CacheKey,
+			CachedFracs, CachedCount );
+
+		if( CachedTable != NULL && CachedFracs == FilterFracs &&
+			CachedCount == (size_t) TableSize )
+		{
+			memcpy( &Table[ 0 ], CachedTable, CachedCount * sizeof( double ));
+			return;
+		}
+
+		#endif // R8B_KERNELCACHE
 
 		CDSPSincFilterGen sinc;
 		sinc.Len2 = FilterLen / 2;
@@ -182,6 +203,13 @@ public:
 			}
 		}
 
+		#if R8B_KERNELCACHE
+
+		kernelcache :: storeFrac( CacheKey, FilterFracs, &Table[ 0 ],
+			(size_t) TableSize );
+
+		#endif // R8B_KERNELCACHE
+
 		R8BCONSOLE( "CDSPFracDelayFilterBank: fracs=%i order=%i taps=%i "
 			"att=%.1f third=%i\n", FilterFracs, ElementSize - 1, FilterLen,
 			ReqAtten, (int) IsThird );
@@ -254,6 +282,7 @@ private:
 	int InterpPoints; ///< Interpolation points to use.
 	double ReqAtten; ///< Filter's attentuation.
 	bool IsThird; ///< "True" if one-third filter is in use.
+	int CacheNode; ///< Cache node (R8B_CACHENODE) *this bank was built on.
 	int FilterSize; ///< This constant specifies the "size" of a single filter
 		///< in "double" elements.
 	CFixedBuffer< double > Table; ///< The table of fractional delay filters
@@ -455,6 +484,7 @@ public:
 		double ReqAtten, const bool IsThird, const bool IsStatic )
 	{
 		CDSPFracDelayFilterBank :: roundReqAtten( ReqAtten, IsThird );
+		const int CacheNode = R8B_CACHENODE;
 
 		R8BSYNC( StateSync );
 
@@ -469,7 +499,8 @@ public:
 					CurObj -> IsThird == IsThird &&
 					CurObj -> ElementSize == aElementSize &&
 					CurObj -> InterpPoints == aInterpPoints &&
-					CurObj -> ReqAtten == ReqAtten )
+					CurObj -> ReqAtten == ReqAtten &&
+					CurObj -> CacheNode == CacheNode )
 				{
 					if( PrevObj != NULL )
 					{
@@ -509,7 +540,8 @@ public:
 				CurObj -> IsThird == IsThird &&
 				CurObj -> ElementSize == aElementSize &&
 				CurObj -> InterpPoints == aInterpPoints &&
-				CurObj -> ReqAtten == ReqAtten )
+				CurObj -> ReqAtten == ReqAtten &&
+				CurObj -> CacheNode == CacheNode )
 			{
 				break;
 			}
@@ -829,6 +861,20 @@ public:
 		return( (int) ceil( MaxInLen * DstSampleRate / SrcSampleRate ) + 1 );
 	}
 
+	virtual bool getStatePeriod( int& InPeriod, int& OutPeriod,
+		int& InMemory ) const
+	{
+		if( !IsWhole )
+		{
+			return( false );
+		}
+
+		InPeriod = InStep;
+		OutPeriod = OutStep;
+		InMemory = BufLen;
+		return( true );
+	}
+
 	virtual void clear()
 	{
 		LatencyLeft = Latency;
@@ -118,6 +118,15 @@ public:
 		return(( MaxInLen + 1 ) >> 1 );
 	}
 
+	virtual bool getStatePeriod( int& InPeriod, int& OutPeriod,
+		int& InMemory ) const
+	{
+		InPeriod = 2;
+		OutPeriod = 1;
+		InMemory = BufLen * 2;
+		return( true );
+	}
+
 	virtual void clear()
 	{
 		LatencyLeft = Latency;
@@ -650,6 +650,15 @@ public:
 		return( MaxInLen * 2 );
 	}
 
+	virtual bool getStatePeriod( int& InPeriod, int& OutPeriod,
+		int& InMemory ) const
+	{
+		InPeriod = 1;
+		OutPeriod = 2;
+		InMemory = BufLen;
+		return( true );
+	}
+
 	virtual void clear()
 	{
 		if( DoConsumeLatency )
@@ -86,6 +86,31 @@ public:
 
 	virtual int getMaxOutLen( const int MaxInLen ) const = 0;
 
+	/**
+	 * SPConverter: function reports whether the processing repeats itself
+	 * every few input samples, so that a long stream can be split into
+	 * slices processed by separate objects and joined again bit-exactly.
+	 * If it does, starting the input "InPeriod" samples later, from the
+	 * cleared state, produces the same output samples, "OutPeriod" samples
+	 * later, as soon as the input skipped is no longer remembered: an
+	 * output sample never depends on input samples more than "InMemory"
+	 * samples older than the latest input sample passed when it was
+	 * output.
+	 *
+	 * @param[out] InPeriod Input period, in samples.
+	 * @param[out] OutPeriod Number of output samples per input period.
+	 * @param[out] InMemory Upper bound of the input history, in samples.
+	 * @return "True" if the processing is periodic. "False" if, as by
+	 * default, the object may track positions in floating point, which
+	 * never repeat exactly.
+	 */
+
+	virtual bool getStatePeriod( int& InPeriod, int& OutPeriod,
+		int& InMemory ) const
+	{
+		return( false );
+	}
+
 	/**
 	 * Function clears (resets) the state of *this object and returns it to
 	 * the state after construction. All input data accumulated in the
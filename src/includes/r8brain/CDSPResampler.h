@@ -491,6 +491,61 @@ public:
 		return( LatencyFrac );
 	}
 
+	/**
+	 * SPConverter: combines the periods of the processing steps, expressed
+	 * in source samples. Fails if a step is not periodic or the combined
+	 * period does not fit an int.
+	 */
+
+	virtual bool getStatePeriod( int& InPeriod, int& OutPeriod,
+		int& InMemory ) const
+	{
+		int64_t inp = 1;
+		int64_t outp = 1;
+		double mem = 0.0;
+		int i;
+
+		for( i = 0; i < StepCount; i++ )
+		{
+			int sip;
+			int sop;
+			int sim;
+
+			if( !Steps[ i ] -> getStatePeriod( sip, sop, sim ))
+			{
+				return( false );
+			}
+
+			mem += (double) sim * inp / outp;
+
+			// Extend the period until it spans whole step periods.
+
+			int64_t a = outp;
+			int64_t b = sip;
+
+			while( b != 0 )
+			{
+				const int64_t t = a % b;
+				a = b;
+				b = t;
+			}
+
+			const int64_t m = sip / a;
+			inp *= m;
+			outp = outp * m / sip * sop;
+
+			if( inp > 0x7FFFFFFF || outp > 0x7FFFFFFF )
+			{
+				return( false );
+			}
+		}
+
+		InPeriod = (int) inp;
+		OutPeriod = (int) outp;
+		InMemory = (int) ceil( mem );
+		return( true );
+	}
+
 	/**
 	 * @return This function ignores the supplied parameter and returns the
 	 * maximal output buffer length that depends on the MaxInLen supplied to
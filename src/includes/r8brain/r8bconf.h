@@ -40,6 +40,41 @@
 	#define R8BCONSOLE( ... )
 #endif // !defined( R8BCONSOLE )
 
+#if !defined( R8B_BASECLASS ) && !defined( R8B_MEMALLOCCLASS )
+	/**
+	 * SPConverter: objects and buffers are allocated from the per-thread
+	 * arena, so rebuilding resamplers for file after file reuses memory
+	 * instead of going through malloc each time.
+	 */
+
+	#include "../../arena.h"
+	#define R8B_BASECLASS :: ArenaClassAllocator
+	#define R8B_MEMALLOCCLASS :: ArenaMemAllocator
+#endif // !defined( R8B_BASECLASS ) && !defined( R8B_MEMALLOCCLASS )
+
+#if !defined( R8B_KERNELCACHE )
+	/**
+	 * SPConverter: designed low-pass kernels and fractional delay filter
+	 * banks are looked up in, and added to, the on-disk kernel cache. Set
+	 * to 0 to always design them.
+	 */
+
+	#include "../../kernelcache.h"
+	#define R8B_KERNELCACHE 1
+#endif // !defined( R8B_KERNELCACHE )
+
+#if !defined( R8B_CACHENODE )
+	/**
+	 * SPConverter: filters and filter banks are cached per NUMA node, keyed
+	 * by the node the calling worker is pinned to, so pinned workers only
+	 * use kernels built in their own node's memory. Define as 0 to share
+	 * one cache across nodes.
+	 */
+
+	#include "../../topology.h"
+	#define R8B_CACHENODE :: topology :: getCurrentNode()
+#endif // !defined( R8B_CACHENODE )
+
 #if !defined( R8B_BASECLASS )
 	/**
 	 * Macro defines the name of the class from which all classes that are
@@ -0,0 +1,240 @@
+/*
+  ==============================================================================
+
+    instrument.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "instrument.h"
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "json.h"
+
+namespace instrument {
+
+std::atomic<bool> enabled(false);
+
+static const int stageCount = static_cast<int>(Stage::Count);
+
+static const char* stageNames[stageCount] = {
+    "open", "read", "resample", "quantize", "write", "copy", "filesystem", "probe", "measure"
+};
+
+/**
+ * @brief Stage times of one file.
+ */
+struct FileRecord {
+    std::string path;
+    int64_t nanos[stageCount];
+};
+
+/**
+ * @brief Counters owned by a single thread.
+ * Only the owning thread writes to it; it is read once the threads joined.
+ */
+struct ThreadStats {
+    int64_t totalNanos[stageCount] = {};
+    int64_t calls[stageCount] = {};
+    int64_t fileNanos[stageCount] = {};
+    std::vector<FileRecord> files;
+};
+
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<ThreadStats>> registry;
+
+/**
+ * @brief Gets the calling thread's counters, registering them on first use.
+ * @return ThreadStats& owned by the calling thread.
+ */
+static ThreadStats& getThreadStats()
+{
+    thread_local ThreadStats* stats = nullptr;
+    if (!stats) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.emplace_back(new ThreadStats());
+        stats = registry.back().get();
+    }
+    return *stats;
+}
+
+/**
+ * @brief Turns instrumentation on. Should be called before any work starts.
+ */
+void enable()
+{
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Adds time to a stage of the calling thread.
+ * @param stage Stage the time was spent in.
+ * @param nanos Time spent, in nanoseconds.
+ */
+void add(Stage stage, int64_t nanos)
+{
+    if (!isEnabled()) {
+        return;
+    }
+    ThreadStats& stats = getThreadStats();
+    int s = static_cast<int>(stage);
+    stats.totalNanos[s] += nanos;
+    stats.calls[s]++;
+    stats.fileNanos[s] += nanos;
+}
+
+/**
+ * @brief Starts a new per-file record on the calling thread.
+ */
+void beginFile()
+{
+    if (!isEnabled()) {
+        return;
+    }
+    ThreadStats& stats = getThreadStats();
+    std::fill(stats.fileNanos, stats.fileNanos + stageCount, 0);
+}
+
+/**
+ * @brief Closes the calling thread's current per-file record.
+ * @param path Path of the file the record belongs to.
+ */
+void endFile(const std::string& path)
+{
+    if (!isEnabled()) {
+        return;
+    }
+    ThreadStats& stats = getThreadStats();
+    FileRecord record;
+    record.path = path;
+    std::copy(stats.fileNanos, stats.fileNanos + stageCount, record.nanos);
+    stats.files.push_back(record);
+}
+
+/**
+ * @brief Parses a report format name given on the command line.
+ * @param name Name of the format.
+ * @param format Receives the format.
+ * @return bool indicating whether the name was recognised.
+ */
+bool parseFormat(const std::string& name, Format& format)
+{
+    if (name == "table") {
+        format = Format::Table;
+    } else if (name == "jsonl") {
+        format = Format::JSONL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Picks a percentile from sorted values (nearest rank).
+ * @param sorted Values in ascending order.
+ * @param p Percentile between 0 and 100.
+ * @return The percentile, or 0 if there are no values.
+ */
+static int64_t percentile(const std::vector<int64_t>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+/**
+ * @brief Writes the collected statistics.
+ * Must only be called once every instrumented thread has finished.
+ * The table lists each stage's total, call count and per-file percentiles;
+ * JSONL writes one line per file followed by a summary line.
+ * @param out Stream to write to.
+ * @param format Table or JSONL.
+ */
+void report(std::ostream& out, Format format)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    int64_t totalNanos[stageCount] = {};
+    int64_t calls[stageCount] = {};
+    std::vector<const FileRecord*> files;
+    for (const auto& stats : registry) {
+        for (int s = 0; s < stageCount; s++) {
+            totalNanos[s] += stats->totalNanos[s];
+            calls[s] += stats->calls[s];
+        }
+        for (const FileRecord& record : stats->files) {
+            files.push_back(&record);
+        }
+    }
+
+    // Per-file times of every stage, sorted for the percentiles
+    std::vector<int64_t> perFile[stageCount];
+    for (const FileRecord* record : files) {
+        for (int s = 0; s < stageCount; s++) {
+            perFile[s].push_back(record->nanos[s]);
+        }
+    }
+    for (int s = 0; s < stageCount; s++) {
+        std::sort(perFile[s].begin(), perFile[s].end());
+    }
+
+    const double usec = 1e-3;
+
+    if (format == Format::JSONL) {
+        for (const FileRecord* record : files) {
+            out << "{\"file\": \"" << escapeJson(record->path) << "\"";
+            for (int s = 0; s < stageCount; s++) {
+                out << ", \"" << stageNames[s] << "_us\": " << record->nanos[s] * usec;
+            }
+            out << "}\n";
+        }
+
+        out << "{\"summary\": {\"files\": " << files.size();
+        for (int s = 0; s < stageCount; s++) {
+            out << ", \"" << stageNames[s] << "\": {\"total_us\": " << totalNanos[s] * usec
+                << ", \"calls\": " << calls[s]
+                << ", \"p50_us\": " << percentile(perFile[s], 50) * usec
+                << ", \"p90_us\": " << percentile(perFile[s], 90) * usec
+                << ", \"p99_us\": " << percentile(perFile[s], 99) * usec
+                << ", \"max_us\": " << percentile(perFile[s], 100) * usec << "}";
+        }
+        out << "}}" << std::endl;
+        return;
+    }
+
+    int64_t allNanos = 0;
+    for (int s = 0; s < stageCount; s++) {
+        allNanos += totalNanos[s];
+    }
+
+    out << "Stage timings over " << files.size() << " files (per-file percentiles in ms)" << std::endl;
+    out << std::left << std::setw(12) << "stage" << std::right
+        << std::setw(12) << "total ms" << std::setw(8) << "share"
+        << std::setw(10) << "calls" << std::setw(10) << "p50"
+        << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+
+    const double msec = 1e-6;
+    out << std::fixed << std::setprecision(3);
+    for (int s = 0; s < stageCount; s++) {
+        double share = allNanos > 0 ? 100.0 * totalNanos[s] / allNanos : 0.0;
+        out << std::left << std::setw(12) << stageNames[s] << std::right
+            << std::setw(12) << totalNanos[s] * msec
+            << std::setw(7) << std::setprecision(1) << share << "%" << std::setprecision(3)
+            << std::setw(10) << calls[s]
+            << std::setw(10) << percentile(perFile[s], 50) * msec
+            << std::setw(10) << percentile(perFile[s], 90) * msec
+            << std::setw(10) << percentile(perFile[s], 99) * msec
+            << std::setw(10) << percentile(perFile[s], 100) * msec << std::endl;
+    }
+    out << std::defaultfloat;
+}
+
+} // namespace instrument
@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    instrument.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+/**
+ * @brief Lightweight per-thread timing of the conversion stages.
+ * Timers add to counters owned by the calling thread, and each file's
+ * stage times are kept as a record between beginFile and endFile. When
+ * disabled a timer costs a single relaxed atomic load.
+ */
+namespace instrument {
+
+enum class Stage {
+    Open,
+    Read,
+    Resample,
+    Quantize,
+    Write,
+    Copy,
+    Filesystem,
+    Probe,
+    Measure,
+    Count
+};
+
+enum class Format {
+    Table,
+    JSONL
+};
+
+using Clock = std::chrono::steady_clock;
+
+extern std::atomic<bool> enabled;
+
+inline bool isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void enable();
+void add(Stage stage, int64_t nanos);
+void beginFile();
+void endFile(const std::string& path);
+void report(std::ostream& out, Format format);
+bool parseFormat(const std::string& name, Format& format);
+
+/**
+ * @brief Times its own lifetime and adds it to a stage.
+ */
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Stage stage) : stage(stage), active(isEnabled())
+    {
+        if (active) {
+            start = Clock::now();
+        }
+    }
+
+    ~ScopedTimer()
+    {
+        if (active) {
+            add(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Stage stage;
+    bool active;
+    Clock::time_point start;
+};
+
+} // namespace instrument
+
+#endif /* INSTRUMENT_H */
@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    journal.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "journal.h"
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+#include "manifest.h"
+
+namespace fs = std::filesystem;
+
+const char* Journal::fileName = ".spconverter-journal";
+
+Journal::~Journal()
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+/**
+ * @brief Loads the journal left behind by an interrupted run.
+ * A line cut short by the crash, or damaged otherwise, is ignored and
+ * only costs a reconversion of that output.
+ * @param path Path of the journal file.
+ * @return Number of outputs the journal lists.
+ */
+size_t Journal::load(const fs::path& path)
+{
+    std::ifstream file(path);
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string line;
+    while (std::getline(file, line)) {
+        // size, mtime, params, source, output path
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, '\t')) {
+            fields.push_back(field);
+        }
+        // A last line without its newline was cut short
+        if (fields.size() != 5 || file.eof()) {
+            continue;
+        }
+
+        try {
+            JournalEntry entry;
+            entry.size = std::stoull(fields[0]);
+            entry.mtime = std::stoll(fields[1]);
+            entry.params = fields[2];
+            entry.source = fields[3];
+            entries[fields[4]] = entry;
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+    return entries.size();
+}
+
+/**
+ * @brief Opens the journal for appending, creating it if needed.
+ * @param path Path of the journal file.
+ * @return bool indicating whether outputs will be recorded.
+ */
+bool Journal::open(const fs::path& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->path = path;
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    return fd >= 0;
+}
+
+/**
+ * @brief Closes and deletes the journal once the run is complete.
+ */
+void Journal::remove()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    if (!path.empty()) {
+        std::error_code ec;
+        fs::remove(path, ec);
+    }
+}
+
+/**
+ * @brief Checks whether an interrupted run already finished an output.
+ * @param source Path of the source file.
+ * @param params Conversion parameters the output has to match.
+ * @param outPath Path of the output.
+ * @return bool indicating whether the output can be skipped.
+ */
+bool Journal::isDone(const fs::path& source, const std::string& params, const fs::path& outPath)
+{
+    JournalEntry entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(outPath.string());
+        if (it == entries.end()) {
+            return false;
+        }
+        entry = it->second;
+    }
+
+    std::error_code ec;
+    const uintmax_t size = fs::file_size(source, ec);
+    return !ec && size == entry.size && entry.mtime == Manifest::getMTime(source) && entry.params == params &&
+           entry.source == source.string() && fs::exists(outPath, ec);
+}
+
+/**
+ * @brief Appends a finished output to the journal.
+ * Call once the output is at its final path. The line goes out in a single
+ * write to a file opened for appending, so concurrent records never mix.
+ * @param source Path of the source file.
+ * @param params Conversion parameters used.
+ * @param outPath Path the output was written to.
+ */
+void Journal::record(const fs::path& source, const std::string& params, const fs::path& outPath)
+{
+    std::error_code ec;
+    std::ostringstream line;
+    line << fs::file_size(source, ec) << '\t' << Manifest::getMTime(source) << '\t' << params << '\t'
+         << source.string() << '\t' << outPath.string() << '\n';
+    const std::string text = line.str();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd >= 0 && ::write(fd, text.data(), text.size()) != static_cast<ssize_t>(text.size())) {
+        // A journal that cannot be written only makes a restart redo more
+        ::close(fd);
+        fd = -1;
+    }
+}
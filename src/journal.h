@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    journal.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+/**
+ * @brief What the journal remembers about one finished output.
+ */
+struct JournalEntry {
+    uintmax_t size;
+    int64_t mtime;
+    std::string params;
+    std::string source;
+};
+
+/**
+ * @brief Log of the outputs a directory run has finished, kept while it runs.
+ * Every output is appended as one line the moment it reaches its final
+ * path, so a run that is killed leaves the list of what it got done. The
+ * next run over the same directory loads it and skips those outputs while
+ * their source is unchanged, then keeps appending to the same journal.
+ * A run that gets to the end removes it. Thread safe.
+ */
+class Journal
+{
+public:
+    static const char* fileName;
+
+    ~Journal();
+
+    size_t load(const std::filesystem::path& path);
+    bool open(const std::filesystem::path& path);
+    void remove();
+
+    bool isDone(const std::filesystem::path& source, const std::string& params,
+                const std::filesystem::path& outPath);
+    void record(const std::filesystem::path& source, const std::string& params,
+                const std::filesystem::path& outPath);
+
+private:
+    std::mutex mutex;
+    // Entries of the interrupted run, by output path
+    std::unordered_map<std::string, JournalEntry> entries;
+    std::filesystem::path path;
+    int fd = -1;
+};
+
+#endif /* JOURNAL_H */
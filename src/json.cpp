@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    json.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "json.h"
+#include <cstdio>
+
+/**
+ * @brief Escapes a string for use inside a JSON string literal.
+ * @param str String to escape.
+ * @return std::string containing the escaped string.
+ */
+std::string escapeJson(const std::string& str)
+{
+    std::string out;
+    for (char ch : str) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
+            out += buf;
+        } else {
+            out += ch;
+        }
+    }
+    return out;
+}
+
+static void skipSpace(const std::string& text, size_t& pos)
+{
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+        pos++;
+    }
+}
+
+static void appendUtf8(std::string& out, unsigned long code)
+{
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+/**
+ * @brief Reads the four hex digits of a \u escape.
+ * @param text Text being parsed.
+ * @param pos Position of the 'u', moved to the last digit.
+ * @param code Receives the UTF-16 code unit.
+ * @return bool indicating whether four hex digits were present.
+ */
+static bool parseHex4(const std::string& text, size_t& pos, unsigned long& code)
+{
+    if (pos + 4 >= text.size()) {
+        return false;
+    }
+
+    code = 0;
+    for (size_t i = 1; i <= 4; i++) {
+        char ch = text[pos + i];
+        code <<= 4;
+        if (ch >= '0' && ch <= '9') {
+            code |= ch - '0';
+        } else if (ch >= 'a' && ch <= 'f') {
+            code |= ch - 'a' + 10;
+        } else if (ch >= 'A' && ch <= 'F') {
+            code |= ch - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    pos += 4;
+    return true;
+}
+
+/**
+ * @brief Parses a JSON string literal.
+ * @param text Text being parsed.
+ * @param pos Position of the opening quote, moved past the closing one.
+ * @param out Receives the unescaped string.
+ * @return bool indicating whether a well formed string was found.
+ */
+static bool parseString(const std::string& text, size_t& pos, std::string& out)
+{
+    if (pos >= text.size() || text[pos] != '"') {
+        return false;
+    }
+
+    out.clear();
+    for (pos++; pos < text.size(); pos++) {
+        char ch = text[pos];
+        if (ch == '"') {
+            pos++;
+            return true;
+        }
+        if (ch != '\\') {
+            out += ch;
+            continue;
+        }
+
+        if (++pos >= text.size()) {
+            return false;
+        }
+        switch (text[pos]) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                unsigned long code;
+                if (!parseHex4(text, pos, code) || (code >= 0xDC00 && code <= 0xDFFF)) {
+                    return false;
+                }
+                // Characters outside the BMP arrive as a high then low surrogate
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    unsigned long low;
+                    if (pos + 2 >= text.size() || text[pos + 1] != '\\' || text[pos + 2] != 'u') {
+                        return false;
+                    }
+                    pos += 2;
+                    if (!parseHex4(text, pos, low) || low < 0xDC00 || low > 0xDFFF) {
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default: out += text[pos]; break;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Parses a flat JSON object, as used for job descriptions.
+ * Values must be strings, numbers, booleans or null; numbers and literals
+ * are returned as their text. Nested objects and arrays are rejected.
+ * @param text Text of the object.
+ * @param fields Receives the members, keyed by name.
+ * @return bool indicating whether the text was a well formed flat object.
+ */
+bool parseJsonObject(const std::string& text, std::map<std::string, std::string>& fields)
+{
+    fields.clear();
+    size_t pos = 0;
+
+    skipSpace(text, pos);
+    if (pos >= text.size() || text[pos++] != '{') {
+        return false;
+    }
+
+    skipSpace(text, pos);
+    if (pos < text.size() && text[pos] == '}') {
+        pos++;
+    } else {
+        while (true) {
+            std::string key, value;
+            skipSpace(text, pos);
+            if (!parseString(text, pos, key)) {
+                return false;
+            }
+            skipSpace(text, pos);
+            if (pos >= text.size() || text[pos++] != ':') {
+                return false;
+            }
+            skipSpace(text, pos);
+
+            if (pos < text.size() && text[pos] == '"') {
+                if (!parseString(text, pos, value)) {
+                    return false;
+                }
+            } else {
+                size_t end = pos;
+                while (end < text.size() && text[end] != ',' && text[end] != '}' &&
+                       text[end] != ' ' && text[end] != '\t') {
+                    end++;
+                }
+                value = text.substr(pos, end - pos);
+                if (value.empty() || value[0] == '{' || value[0] == '[') {
+                    return false;
+                }
+                pos = end;
+            }
+            fields[key] = value;
+
+            skipSpace(text, pos);
+            if (pos < text.size() && text[pos] == ',') {
+                pos++;
+                continue;
+            }
+            if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                break;
+            }
+            return false;
+        }
+    }
+
+    skipSpace(text, pos);
+    return pos == text.size();
+}
@@ -0,0 +1,20 @@
+/*
+  ==============================================================================
+
+    json.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <map>
+#include <string>
+
+#ifndef JSON_H
+#define JSON_H
+
+std::string escapeJson(const std::string& str);
+bool parseJsonObject(const std::string& text, std::map<std::string, std::string>& fields);
+
+#endif /* JSON_H */
@@ -0,0 +1,459 @@
+/*
+  ==============================================================================
+
+    kernelcache.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "kernelcache.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "fftbackend.h"
+#include "includes/r8brain/r8bbase.h"
+
+namespace fs = std::filesystem;
+
+namespace kernelcache {
+
+static const char fileMagic[8] = { 'S', 'P', 'C', 'K', 'R', 'N', 'L', '1' };
+
+enum RecordType : uint32_t {
+    FIRRecord = 1,
+    FracRecord = 2
+};
+
+struct FileHeader {
+    char magic[8];
+    char tag[56];
+    uint64_t recordCount;
+};
+
+// Keys and properties are packed into the same fixed slots for both types
+struct Record {
+    uint32_t type;
+    int32_t ints[5];
+    double reals[5];
+    uint64_t count;
+    uint64_t offset;
+};
+
+struct PendingRecord {
+    Record record;
+    std::vector<double> data;
+};
+
+static std::mutex mutex;
+static std::string storePath;
+static bool isOpen = false;
+
+static const unsigned char* mapped = nullptr;
+static size_t mappedSize = 0;
+static const Record* mappedRecords = nullptr;
+static uint64_t mappedCount = 0;
+
+static std::vector<PendingRecord> pending;
+
+// Set when pending holds records the file on disk does not have yet
+static bool dirty = false;
+
+/**
+ * @brief Describes the build the kernels are valid for.
+ * Kernel blocks are stored in the FFT backend's own spectrum layout and
+ * fractional banks may be shuffled for SIMD, so both are part of the tag.
+ * @return Tag string.
+ */
+static std::string getBuildTag()
+{
+    std::string tag = std::string("r8b") + R8B_VERSION + "-" + getFFTBackendName() +
+                      "-ext" + std::to_string(R8B_EXTFFT);
+#if defined(R8B_SIMD_ISH)
+    tag += "-simd";
+#endif
+    return tag;
+}
+
+static Record makeFIRRecord(const FIRKey& key, const FIRInfo& info, size_t count)
+{
+    Record r = {};
+    r.type = FIRRecord;
+    r.ints[0] = key.phase;
+    r.ints[1] = info.kernelLen;
+    r.ints[2] = info.blockLenBits;
+    r.ints[3] = info.latency;
+    r.ints[4] = info.zeroPhase ? 1 : 0;
+    r.reals[0] = key.normFreq;
+    r.reals[1] = key.transBand;
+    r.reals[2] = key.atten;
+    r.reals[3] = key.gain;
+    r.reals[4] = info.latencyFrac;
+    r.count = count;
+    return r;
+}
+
+static bool matchesFIR(const Record& r, const FIRKey& key)
+{
+    return r.type == FIRRecord && r.ints[0] == key.phase && r.reals[0] == key.normFreq &&
+           r.reals[1] == key.transBand && r.reals[2] == key.atten && r.reals[3] == key.gain;
+}
+
+static Record makeFracRecord(const FracKey& key, int filterFracs, size_t count)
+{
+    Record r = {};
+    r.type = FracRecord;
+    r.ints[0] = key.initFracs;
+    r.ints[1] = key.elementSize;
+    r.ints[2] = key.interpPoints;
+    r.ints[3] = key.third ? 1 : 0;
+    r.ints[4] = filterFracs;
+    r.reals[0] = key.atten;
+    r.count = count;
+    return r;
+}
+
+static bool matchesFrac(const Record& r, const FracKey& key)
+{
+    return r.type == FracRecord && r.ints[0] == key.initFracs && r.ints[1] == key.elementSize &&
+           r.ints[2] == key.interpPoints && r.ints[3] == (key.third ? 1 : 0) && r.reals[0] == key.atten;
+}
+
+/**
+ * @brief Checks whether two records hold the kernel of the same design.
+ * @param a First record.
+ * @param b Second record.
+ * @return bool indicating whether either can stand in for the other.
+ */
+static bool sameKey(const Record& a, const Record& b)
+{
+    if (a.type == FIRRecord) {
+        return b.type == FIRRecord && a.ints[0] == b.ints[0] && a.reals[0] == b.reals[0] &&
+               a.reals[1] == b.reals[1] && a.reals[2] == b.reals[2] && a.reals[3] == b.reals[3];
+    }
+    return a.type == b.type && a.ints[0] == b.ints[0] && a.ints[1] == b.ints[1] && a.ints[2] == b.ints[2] &&
+           a.ints[3] == b.ints[3] && a.reals[0] == b.reals[0];
+}
+
+/**
+ * @brief Finds a stored record, mapped or designed earlier in this run.
+ * @param matches Predicate selecting the record.
+ * @param record Receives the record.
+ * @return Pointer to the record's samples, nullptr if there is none.
+ */
+template <typename Predicate>
+static const double* find(Predicate matches, Record& record)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!isOpen) {
+        return nullptr;
+    }
+
+    for (uint64_t i = 0; i < mappedCount; i++) {
+        if (matches(mappedRecords[i])) {
+            record = mappedRecords[i];
+            return reinterpret_cast<const double*>(mapped + record.offset);
+        }
+    }
+    for (const PendingRecord& p : pending) {
+        if (matches(p.record)) {
+            record = p.record;
+            return p.data.data();
+        }
+    }
+    return nullptr;
+}
+
+static void store(const Record& record, const double* data, size_t count)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (isOpen) {
+        pending.push_back({record, std::vector<double>(data, data + count)});
+        dirty = true;
+    }
+}
+
+/**
+ * @brief Looks up a designed low-pass kernel block.
+ * @param key Design parameters.
+ * @param info Receives the kernel's properties.
+ * @param count Receives the number of doubles in the block.
+ * @return Pointer to the block, nullptr if it was never stored.
+ */
+const double* findFIR(const FIRKey& key, FIRInfo& info, size_t& count)
+{
+    Record r;
+    const double* data = find([&key](const Record& c) { return matchesFIR(c, key); }, r);
+    if (data) {
+        info.kernelLen = r.ints[1];
+        info.blockLenBits = r.ints[2];
+        info.latency = r.ints[3];
+        info.zeroPhase = r.ints[4] != 0;
+        info.latencyFrac = r.reals[4];
+        count = r.count;
+    }
+    return data;
+}
+
+/**
+ * @brief Adds a freshly designed low-pass kernel block to the store.
+ * @param key Design parameters.
+ * @param info Properties of the kernel.
+ * @param data Kernel block.
+ * @param count Number of doubles in the block.
+ */
+void storeFIR(const FIRKey& key, const FIRInfo& info, const double* data, size_t count)
+{
+    store(makeFIRRecord(key, info, count), data, count);
+}
+
+/**
+ * @brief Looks up a built fractional delay filter table.
+ * @param key Build parameters.
+ * @param filterFracs Receives the number of fractional positions.
+ * @param count Receives the number of doubles in the table.
+ * @return Pointer to the table, nullptr if it was never stored.
+ */
+const double* findFrac(const FracKey& key, int& filterFracs, size_t& count)
+{
+    Record r;
+    const double* data = find([&key](const Record& c) { return matchesFrac(c, key); }, r);
+    if (data) {
+        filterFracs = r.ints[4];
+        count = r.count;
+    }
+    return data;
+}
+
+/**
+ * @brief Adds a freshly built fractional delay filter table to the store.
+ * @param key Build parameters.
+ * @param filterFracs Number of fractional positions.
+ * @param data Filter table.
+ * @param count Number of doubles in the table.
+ */
+void storeFrac(const FracKey& key, int filterFracs, const double* data, size_t count)
+{
+    store(makeFracRecord(key, filterFracs, count), data, count);
+}
+
+/**
+ * @brief Gets the store location used when none is given.
+ * SPCONVERTER_KERNEL_CACHE overrides it, otherwise the store lives in the
+ * XDG cache directory.
+ * @return Path of the store file, empty if no location is known.
+ */
+std::string getDefaultPath()
+{
+    if (const char* path = std::getenv("SPCONVERTER_KERNEL_CACHE")) {
+        return path;
+    }
+
+    fs::path dir;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+        dir = xdg;
+    } else if (const char* home = std::getenv("HOME")) {
+        dir = fs::path(home) / ".cache";
+    } else {
+        return std::string();
+    }
+    return (dir / "spconverter" / ("kernels-" + getBuildTag() + ".bin")).string();
+}
+
+/**
+ * @brief Maps a store file and checks that it is whole and of this build.
+ * @param path Path of the store file.
+ * @param bytes Receives the mapping, to be released with munmap.
+ * @param size Receives the size of the mapping.
+ * @return bool indicating whether the file could be used.
+ */
+static bool mapStore(const std::string& path, const unsigned char*& bytes, size_t& size)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    void* m = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(FileHeader)) {
+        m = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        return false;
+    }
+
+    bytes = static_cast<const unsigned char*>(m);
+    size = static_cast<size_t>(st.st_size);
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(bytes);
+
+    char tag[sizeof(header->tag)] = {};
+    std::strncpy(tag, getBuildTag().c_str(), sizeof(tag) - 1);
+
+    // Every record and its samples must lie inside the file
+    bool valid = std::memcmp(header->magic, fileMagic, sizeof(fileMagic)) == 0 &&
+                 std::memcmp(header->tag, tag, sizeof(tag)) == 0 &&
+                 header->recordCount <= (size - sizeof(FileHeader)) / sizeof(Record);
+    const Record* records = reinterpret_cast<const Record*>(bytes + sizeof(FileHeader));
+    for (uint64_t i = 0; valid && i < header->recordCount; i++) {
+        valid = records[i].offset % sizeof(double) == 0 && records[i].offset <= size &&
+                records[i].count <= (size - records[i].offset) / sizeof(double);
+    }
+
+    if (!valid) {
+        munmap(m, size);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Maps the store and enables lookups.
+ * A missing, foreign or damaged file just starts an empty store.
+ * @param path Path of the store file.
+ * @return bool indicating whether kernels were loaded from the file.
+ */
+bool open(const std::string& path)
+{
+    close();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    storePath = path;
+    isOpen = true;
+
+    if (!mapStore(path, mapped, mappedSize)) {
+        return false;
+    }
+    mappedRecords = reinterpret_cast<const Record*>(mapped + sizeof(FileHeader));
+    mappedCount = reinterpret_cast<const FileHeader*>(mapped)->recordCount;
+    return true;
+}
+
+/**
+ * @brief Writes the store back if anything was designed since the last save.
+ * Runs that save at the same time take turns through a lock file, and
+ * each merges its kernels into whatever the file holds by then, so none
+ * are lost. The file is replaced atomically, so readers never see a torn
+ * store. Safe to call repeatedly; a long-running process saves after
+ * each batch.
+ * @return bool indicating whether the store is up to date on disk.
+ */
+bool save()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!isOpen || !dirty) {
+        return true;
+    }
+
+    std::error_code ec;
+    const fs::path path(storePath);
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), ec);
+    }
+
+    const std::string lockPath = storePath + ".lock";
+    int lockFd = ::open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lockFd < 0 || flock(lockFd, LOCK_EX) != 0) {
+        if (lockFd >= 0) {
+            ::close(lockFd);
+        }
+        return false;
+    }
+
+    // What other runs saved since this one mapped the store comes first,
+    // then the kernels only this run has
+    const unsigned char* disk = nullptr;
+    size_t diskSize = 0;
+    const bool hasDisk = mapStore(storePath, disk, diskSize);
+    std::vector<Record> records;
+    std::vector<const double*> samples;
+    auto add = [&](const Record& r, const double* data) {
+        for (const Record& known : records) {
+            if (sameKey(known, r)) {
+                return;
+            }
+        }
+        records.push_back(r);
+        samples.push_back(data);
+    };
+    if (hasDisk) {
+        const Record* diskRecords = reinterpret_cast<const Record*>(disk + sizeof(FileHeader));
+        const uint64_t diskCount = reinterpret_cast<const FileHeader*>(disk)->recordCount;
+        for (uint64_t i = 0; i < diskCount; i++) {
+            add(diskRecords[i], reinterpret_cast<const double*>(disk + diskRecords[i].offset));
+        }
+    }
+    for (uint64_t i = 0; i < mappedCount; i++) {
+        add(mappedRecords[i], reinterpret_cast<const double*>(mapped + mappedRecords[i].offset));
+    }
+    for (const PendingRecord& p : pending) {
+        add(p.record, p.data.data());
+    }
+
+    // Samples follow the record table, in the same order
+    uint64_t offset = sizeof(FileHeader) + records.size() * sizeof(Record);
+    for (Record& r : records) {
+        r.offset = offset;
+        offset += r.count * sizeof(double);
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    std::strncpy(header.tag, getBuildTag().c_str(), sizeof(header.tag) - 1);
+    header.recordCount = records.size();
+
+    const std::string tmpPath = storePath + ".tmp" + std::to_string(getpid());
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+    for (size_t i = 0; i < records.size(); i++) {
+        file.write(reinterpret_cast<const char*>(samples[i]), records[i].count * sizeof(double));
+    }
+    file.close();
+
+    const bool saved = file && std::rename(tmpPath.c_str(), storePath.c_str()) == 0;
+    if (!saved) {
+        std::remove(tmpPath.c_str());
+    }
+    if (hasDisk) {
+        munmap(const_cast<unsigned char*>(disk), diskSize);
+    }
+    flock(lockFd, LOCK_UN);
+    ::close(lockFd);
+
+    dirty = !saved;
+    return saved;
+}
+
+/**
+ * @brief Unmaps the store and disables lookups.
+ * Must not be called while resamplers are still being built.
+ */
+void close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (mapped) {
+        munmap(const_cast<unsigned char*>(mapped), mappedSize);
+    }
+    mapped = nullptr;
+    mappedSize = 0;
+    mappedRecords = nullptr;
+    mappedCount = 0;
+    pending.clear();
+    dirty = false;
+    isOpen = false;
+}
+
+} // namespace kernelcache
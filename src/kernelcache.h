@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    kernelcache.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <cstddef>
+#include <string>
+
+#ifndef KERNELCACHE_H
+#define KERNELCACHE_H
+
+/**
+ * @brief On-disk store of designed r8brain filter kernels.
+ * Designing the low-pass and fractional delay filters of a resampler costs
+ * more than converting a short file, and r8brain only keeps them for the
+ * life of the process. The store file is mapped at startup; r8brain copies
+ * kernels out of it instead of designing them, and anything designed
+ * during the run is added when the store is saved. Files are tagged with
+ * the r8brain version and FFT build, so variants never share kernels.
+ * Lookups are no-ops until open() succeeds.
+ */
+namespace kernelcache {
+
+/**
+ * @brief Parameters a low-pass kernel is designed from.
+ */
+struct FIRKey {
+    double normFreq;
+    double transBand;
+    double atten;
+    double gain;
+    int phase;
+};
+
+/**
+ * @brief Properties of a designed low-pass kernel.
+ */
+struct FIRInfo {
+    int kernelLen;
+    int blockLenBits;
+    int latency;
+    double latencyFrac;
+    bool zeroPhase;
+};
+
+/**
+ * @brief Parameters a fractional delay filter bank is built from.
+ */
+struct FracKey {
+    int initFracs;
+    int elementSize;
+    int interpPoints;
+    double atten;
+    bool third;
+};
+
+const double* findFIR(const FIRKey& key, FIRInfo& info, size_t& count);
+void storeFIR(const FIRKey& key, const FIRInfo& info, const double* data, size_t count);
+const double* findFrac(const FracKey& key, int& filterFracs, size_t& count);
+void storeFrac(const FracKey& key, int filterFracs, const double* data, size_t count);
+
+std::string getDefaultPath();
+bool open(const std::string& path);
+bool save();
+void close();
+
+} // namespace kernelcache
+
+#endif /* KERNELCACHE_H */
@@ -0,0 +1,270 @@
+/*
+  ==============================================================================
+
+    loudness.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "loudness.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "includes/r8brain/r8bbase.h"
+
+// Gates of BS.1770 integrated loudness
+static const double absoluteGateLufs = -70.0;
+static const double relativeGateLu = -10.0;
+
+/**
+ * @brief Applies a normalization option given by name, as on the command line or in a job.
+ * "normalize" takes peak or lufs, optionally followed by ":TARGET" in
+ * dBFS or LUFS, or none. "lookahead" sets how long an output may be to
+ * be held in memory, in seconds.
+ * @param name Option name: normalize or lookahead.
+ * @param value Value of the option.
+ * @param settings Settings to adjust.
+ * @param error Receives the reason the value was rejected.
+ * @return bool indicating whether the option was applied.
+ */
+bool applyNormalizeOption(const std::string& name, const std::string& value, NormalizeSettings& settings,
+                          std::string& error)
+{
+    if (name == "lookahead") {
+        char* end;
+        const double seconds = std::strtod(value.c_str(), &end);
+        if (end == value.c_str() || *end || !(seconds >= 0.0 && seconds <= 3600.0)) {
+            error = "Look-ahead must be between 0 and 3600 seconds: " + value;
+            return false;
+        }
+        settings.lookaheadSeconds = seconds;
+        return true;
+    }
+    if (name != "normalize") {
+        error = "Unknown normalization option: " + name;
+        return false;
+    }
+
+    if (value == "none") {
+        settings.mode = NormalizeMode::None;
+        return true;
+    }
+
+    const size_t colon = value.find(':');
+    const std::string mode = value.substr(0, colon);
+    if (mode == "peak") {
+        settings.mode = NormalizeMode::Peak;
+        settings.target = -1.0;
+    } else if (mode == "lufs") {
+        settings.mode = NormalizeMode::Loudness;
+        settings.target = -23.0;
+    } else {
+        error = "Unknown normalization: " + value;
+        return false;
+    }
+
+    if (colon != std::string::npos) {
+        const std::string target = value.substr(colon + 1);
+        char* end;
+        settings.target = std::strtod(target.c_str(), &end);
+        if (end == target.c_str() || *end || !(settings.target >= -70.0 && settings.target <= 0.0)) {
+            error = "Normalization target must be between -70 and 0: " + value;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Describes normalization settings in a compact, stable form.
+ * The look-ahead only changes how the output is produced, not the output,
+ * so it is left out.
+ * @param settings Settings to describe.
+ * @return std::string such as "lufs-23", empty if normalization is off.
+ */
+std::string describeNormalize(const NormalizeSettings& settings)
+{
+    if (settings.mode == NormalizeMode::None) {
+        return std::string();
+    }
+
+    char text[64];
+    std::snprintf(text, sizeof(text), "%s%g", settings.mode == NormalizeMode::Peak ? "peak" : "lufs",
+                  settings.target);
+    return text;
+}
+
+/**
+ * @brief Prepares the meter for a new stream.
+ * Designs the K-weighting filters for the rate with the bilinear
+ * transform, which gives the BS.1770 coefficients exactly at 48 kHz.
+ * @param rate Sample rate of the measured frames.
+ * @param channels Number of interleaved channels.
+ * @param loudness Whether to measure loudness as well as the peak.
+ */
+void LevelMeter::setup(int rate, int channels, bool loudness)
+{
+    this->channels = channels;
+    this->loudness = loudness;
+    peak = 0.0;
+    blocks.clear();
+    stepPos = 0;
+    stepEnergy = 0.0;
+    stepCount = 0;
+    if (!loudness) {
+        return;
+    }
+
+    // Stage 1, a high shelf modelling the acoustic effect of the head
+    double k = std::tan(R8B_PI * 1681.974450955533 / rate);
+    double q = 0.7071752369554196;
+    const double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    shelf.b0 = (vh + vb * k / q + k * k) / a0;
+    shelf.b1 = 2.0 * (k * k - vh) / a0;
+    shelf.b2 = (vh - vb * k / q + k * k) / a0;
+    shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+    shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+    // Stage 2, the RLB high pass
+    k = std::tan(R8B_PI * 38.13547087602444 / rate);
+    q = 0.5003270373238773;
+    a0 = 1.0 + k / q + k * k;
+    highPass.b0 = 1.0;
+    highPass.b1 = -2.0;
+    highPass.b2 = 1.0;
+    highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+    highPass.a2 = (1.0 - k / q + k * k) / a0;
+
+    state.assign(static_cast<size_t>(channels) * 4, 0.0);
+
+    // 5.1 in WAV order: the LFE is not counted and the surrounds weigh +1.5 dB
+    weights.assign(channels, 1.0);
+    if (channels == 6) {
+        weights[3] = 0.0;
+        weights[4] = 1.41;
+        weights[5] = 1.41;
+    }
+
+    stepFrames = std::max(1, static_cast<int>(std::lround(rate * 0.1)));
+}
+
+/**
+ * @brief Measures a block of interleaved frames.
+ * @param in Interleaved normalized frames.
+ * @param frames Number of frames.
+ */
+void LevelMeter::process(const double* in, int frames)
+{
+    const size_t count = static_cast<size_t>(frames) * channels;
+    double blockPeak = peak;
+    for (size_t i = 0; i < count; i++) {
+        blockPeak = std::max(blockPeak, std::fabs(in[i]));
+    }
+    peak = blockPeak;
+
+    if (!loudness) {
+        return;
+    }
+
+    for (int f = 0; f < frames; f++) {
+        const double* frame = in + static_cast<size_t>(f) * channels;
+        double energy = 0.0;
+        for (int c = 0; c < channels; c++) {
+            double* z = &state[static_cast<size_t>(c) * 4];
+            const double x = frame[c];
+            const double s = shelf.b0 * x + z[0];
+            z[0] = shelf.b1 * x - shelf.a1 * s + z[1];
+            z[1] = shelf.b2 * x - shelf.a2 * s;
+            const double y = highPass.b0 * s + z[2];
+            z[2] = highPass.b1 * s - highPass.a1 * y + z[3];
+            z[3] = highPass.b2 * s - highPass.a2 * y;
+            energy += weights[c] * y * y;
+        }
+        stepEnergy += energy;
+        if (++stepPos == stepFrames) {
+            endStep();
+        }
+    }
+}
+
+/**
+ * @brief Closes a 100 ms step and the 400 ms block it completes.
+ */
+void LevelMeter::endStep()
+{
+    steps[stepCount % stepsPerBlock] = stepEnergy;
+    stepCount++;
+    stepEnergy = 0.0;
+    stepPos = 0;
+
+    if (stepCount >= stepsPerBlock) {
+        double sum = 0.0;
+        for (double step : steps) {
+            sum += step;
+        }
+        blocks.push_back(sum / (static_cast<double>(stepsPerBlock) * stepFrames));
+    }
+}
+
+/**
+ * @brief Gets the integrated loudness of everything measured so far.
+ * @return Loudness in LUFS, -HUGE_VAL if the stream is shorter than a
+ * block or entirely below the absolute gate.
+ */
+double LevelMeter::getLoudness() const
+{
+    const double absoluteGate = std::pow(10.0, (absoluteGateLufs + 0.691) / 10.0);
+    double sum = 0.0;
+    size_t count = 0;
+    for (double block : blocks) {
+        if (block > absoluteGate) {
+            sum += block;
+            count++;
+        }
+    }
+    if (count == 0) {
+        return -HUGE_VAL;
+    }
+
+    const double relativeGate = sum / count * std::pow(10.0, relativeGateLu / 10.0);
+    sum = 0.0;
+    count = 0;
+    for (double block : blocks) {
+        if (block > absoluteGate && block > relativeGate) {
+            sum += block;
+            count++;
+        }
+    }
+    return -0.691 + 10.0 * std::log10(sum / count);
+}
+
+/**
+ * @brief Gets the gain that brings the measured stream to the target.
+ * Loudness normalization is held back so the sample peak stays at or below
+ * loudnessCeilingDb. Silent streams, and streams too short to measure, keep
+ * their level.
+ * @param settings Mode and target.
+ * @return Linear gain.
+ */
+double LevelMeter::getGain(const NormalizeSettings& settings) const
+{
+    if (peak <= 0.0) {
+        return 1.0;
+    }
+
+    if (settings.mode == NormalizeMode::Peak) {
+        return std::pow(10.0, settings.target / 20.0) / peak;
+    }
+
+    const double measured = getLoudness();
+    if (settings.mode != NormalizeMode::Loudness || !std::isfinite(measured)) {
+        return 1.0;
+    }
+    const double gain = std::pow(10.0, (settings.target - measured) / 20.0);
+    return std::min(gain, std::pow(10.0, loudnessCeilingDb / 20.0) / peak);
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    loudness.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <string>
+#include <vector>
+#include "arena.h"
+
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+/**
+ * @brief Level every output is normalized to.
+ */
+enum class NormalizeMode {
+    None,
+    Peak,
+    Loudness
+};
+
+/**
+ * @brief How the outputs are normalized.
+ */
+struct NormalizeSettings {
+    NormalizeMode mode = NormalizeMode::None;
+    // Sample peak in dBFS, or integrated loudness in LUFS
+    double target = -1.0;
+    // Outputs up to this long are held in memory and the source is read
+    // once, longer ones are read and converted twice
+    double lookaheadSeconds = 30.0;
+};
+
+// Highest sample peak loudness normalization may raise an output to, in dBFS
+static const double loudnessCeilingDb = -1.0;
+
+bool applyNormalizeOption(const std::string& name, const std::string& value, NormalizeSettings& settings,
+                          std::string& error);
+std::string describeNormalize(const NormalizeSettings& settings);
+
+/**
+ * @brief Measures the sample peak and EBU R128 integrated loudness of a stream.
+ * Loudness follows ITU-R BS.1770: K-weighting by a high shelf and a high
+ * pass biquad per channel, mean square over 400 ms blocks overlapping by
+ * 75%, and an absolute gate at -70 LUFS followed by a relative gate 10 LU
+ * below the mean of the blocks that passed it. The blocks are built from
+ * 100 ms steps, so memory grows by one value per 100 ms of audio.
+ */
+class LevelMeter
+{
+public:
+    void setup(int rate, int channels, bool loudness);
+    void process(const double* in, int frames);
+
+    double getPeak() const { return peak; }
+    double getLoudness() const;
+    double getGain(const NormalizeSettings& settings) const;
+
+private:
+    /**
+     * @brief Biquad coefficients, normalized so a0 is 1.
+     */
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    // Number of 100 ms steps in a 400 ms gating block
+    static const int stepsPerBlock = 4;
+
+    void endStep();
+
+    int channels = 0;
+    bool loudness = false;
+    double peak = 0.0;
+
+    Biquad shelf = {};
+    Biquad highPass = {};
+    // Transposed direct form II state per channel: shelf then high pass
+    arena::Vector<double> state;
+    std::vector<double> weights;
+
+    int stepFrames = 0;
+    int stepPos = 0;
+    double stepEnergy = 0.0;
+    double steps[stepsPerBlock] = {};
+    int stepCount = 0;
+
+    // Weighted mean square of every gating block
+    std::vector<double> blocks;
+};
+
+#endif /* LOUDNESS_H */
@@ -9,36 +9,77 @@
 */
 
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
 #include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include "arena.h"
 #include "converter.h"
+#include "fanout.h"
+#include "fftbackend.h"
+#include "instrument.h"
+#include "kernelcache.h"
+#include "journal.h"
+#include "manifest.h"
+#include "plan.h"
+#include "profile.h"
+#include "resamplerpool.h"
+#include "scheduler.h"
+#include "server.h"
 
 namespace fs = std::filesystem;
 
 // Set the allowed file extensions that SPconverter can process
-std::vector<std::string> allowedExtensions = {".wav", ".flac", ".ogg", ".mp3"};
+std::vector<std::string> allowedExtensions = {".wav", ".aif", ".aiff", ".flac", ".ogg", ".mp3"};
 
 /**
  * @brief Gets the output path for a given input path.
  * Takes the input path and applies "-SPC" to the file name
  * to differentiate between the original file and the 
- * converted file.
+ * converted file. A source extension other than the container's
+ * is kept, so kick.flac and kick.wav never share an output.
  * 
  * @param inPath std::string containing the input path.
+ * @param container Container of the output, which sets the extension.
+ * @param label Fan-out target label appended after "-SPC", if any.
  * @return std::string containing the output path.
  */
-std::string getOutPath(std::string inPath)
+std::string getOutPath(std::string inPath, Container container, const std::string& label = "")
 {
     /*
     Takes the input path and creates an output path with -SPC added to the filename
     */
     fs::path iPath(inPath);
     fs::path dir    = iPath.parent_path().string();
-    fs::path fName  = iPath.stem().string() + "-SPC" + iPath.extension().string();
+    fs::path name   = iPath.extension() == getContainerExtension(container) ? iPath.stem() : iPath.filename();
+    fs::path fName  = name.string() + "-SPC" + (label.empty() ? "" : "-" + label) +
+                      getContainerExtension(container);
     fs::path oPath  = dir / fName;
     return oPath;
 }
 
+/**
+ * @brief Gives a path the extension of an output container.
+ * A source extension other than the container's is kept in front of it,
+ * so kick.flac becomes kick.flac.wav and never meets kick.wav's output.
+ * @param path Path with the source's extension.
+ * @param container Container of the output.
+ * @return fs::path of the output.
+ */
+fs::path withContainerExtension(fs::path path, Container container)
+{
+    const char* extension = getContainerExtension(container);
+    if (path.extension() != extension) {
+        path += extension;
+    }
+    return path;
+}
+
 /**
  * @brief Confirms a file has an allowed extension.
  * @param filePath Path of the file to check/process.
@@ -58,15 +99,25 @@ bool hasAllowedExtension(const std::string& filePath) {
 }
 
 /**
- * @brief Gets a list of all files in a directory.
+ * @brief Walks a directory, reporting every convertible file as it is found.
+ * Uses the file type cached in each directory entry (d_type on POSIX) so
+ * entries are not stat'ed just to tell files from directories.
  * @param dirIterator std::filesystem directory iterator type
- * @param filePaths The vector in which retrieved file paths will be stored
+ * @param onFile Called with each regular file that has an allowed extension
  */
-template <typename Iterator>
-void getFilePaths(const Iterator& dirIterator, std::vector<std::string>& filePaths) {
-    for (const auto& entry : dirIterator) {
-        if (fs::is_regular_file(entry) && hasAllowedExtension(entry.path().string())) {
-            filePaths.push_back(entry.path().string());
+template <typename Iterator, typename Callback>
+void scanFiles(Iterator dirIterator, Callback onFile) {
+    std::error_code ec;
+    for (; dirIterator != Iterator(); dirIterator.increment(ec)) {
+        if (ec) {
+            std::cerr << "Error scanning the directory: " << ec.message() << std::endl;
+            return;
+        }
+
+        const fs::directory_entry& entry = *dirIterator;
+        std::error_code typeEc;
+        if (entry.is_regular_file(typeEc) && hasAllowedExtension(entry.path().string())) {
+            onFile(entry);
         }
     }
 }
@@ -75,12 +126,13 @@ void getFilePaths(const Iterator& dirIterator, std::vector<std::string>& filePat
  * @brief Generates a progress string for output to the terminal.
  * @param inPath Path of the file to check/process.
  * @param currentPos Current index position.
- * @param listSize Size of the file list.
+ * @param listSize Number of files found so far.
+ * @param status What happened to the file.
  * @return std::string containing the formatted progress string.
  */
-std::string getProgressStr(std::string inPath, int currentPos, int listSize)
+std::string getProgressStr(std::string inPath, int currentPos, int listSize, std::string status = "Converted")
 {
-    return "Converting.. [" + std::to_string(currentPos)+ "/" + std::to_string(listSize) + "].. " + inPath;
+    return status + ".. [" + std::to_string(currentPos)+ "/" + std::to_string(listSize) + "].. " + inPath;
 }
 
 /**
@@ -88,10 +140,12 @@ std::string getProgressStr(std::string inPath, int currentPos, int listSize)
  * Converts the file with SPconverter.
  * @param filePath Path of the file to check/process.
  * @param conv The SPconverter object used for conversion.
+ * @param container Container of the output.
+ * @return bool indicating whether the conversion succeeded.
  */
-void processFile(const std::string& filePath, Converter& conv) {
-    std::string outPath = getOutPath(filePath);
-    conv.convert(filePath.c_str(), outPath.c_str());
+bool processFile(const std::string& filePath, Converter& conv, Container container) {
+    std::string outPath = getOutPath(filePath, container);
+    return conv.convert(filePath.c_str(), outPath.c_str());
 }
 
 /**
@@ -100,59 +154,502 @@ void processFile(const std::string& filePath, Converter& conv) {
  * @param filePath Path of the file to check/process.
  * @param outFilePath Path that the processed file will be written to.
  * @param conv The SPconverter object used for conversion.
+ * @return bool indicating whether the conversion succeeded.
+ */
+bool processFile(const std::string& filePath, const std::string outFilePath, Converter& conv) {
+    return conv.convert(filePath.c_str(), outFilePath.c_str());
+}
+
+/**
+ * @brief A file queued for conversion by processDirectory.
+ */
+struct ConversionJob {
+    std::string inPath;
+    std::string relativePath;
+    fs::path outPath;
+    // One output per target in fan-out mode, outPath is unused then
+    std::vector<FanOutOutput> outputs;
+    size_t order;
+
+    // Header of the source and the planned action of each output, filled in by the probe
+    SF_INFO source = SF_INFO();
+    bool probed = false;
+    std::vector<PlanAction> actions;
+    double work = 0.0;
+};
+
+/**
+ * @brief Jobs planned by processDirectory but not yet picked up by a worker.
+ * Workers always take the job with the most estimated work, ties in the
+ * order found.
+ */
+class JobQueue
+{
+public:
+    void push(ConversionJob job)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+        std::push_heap(jobs.begin(), jobs.end(), smaller);
+    }
+
+    ConversionJob pop()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::pop_heap(jobs.begin(), jobs.end(), smaller);
+        ConversionJob job = std::move(jobs.back());
+        jobs.pop_back();
+        return job;
+    }
+
+private:
+    static bool smaller(const ConversionJob& a, const ConversionJob& b)
+    {
+        return a.work != b.work ? a.work < b.work : a.order > b.order;
+    }
+
+    std::mutex mutex;
+    std::vector<ConversionJob> jobs;
+};
+
+/**
+ * @brief Gets the share of a run done so far and an estimate of the time left.
+ * @param done Work finished so far.
+ * @param total Work of the whole plan.
+ * @param elapsed Seconds since the conversions started.
+ * @return std::string such as " (42%, 0:01:10 left)", empty without any planned work.
  */
-void processFile(const std::string& filePath, const std::string outFilePath, Converter& conv) {
-    conv.convert(filePath.c_str(), outFilePath.c_str());
+std::string getEtaStr(double done, double total, double elapsed)
+{
+    if (total <= 0.0) {
+        return "";
+    }
+    const double fraction = std::min(1.0, done / total);
+    const std::string left = done > 0.0 ? formatDuration(elapsed * (total - done) / done) : "?";
+    return " (" + std::to_string(static_cast<int>(fraction * 100.0)) + "%, " + left + " left)";
 }
 
 /**
  * @brief Processes a directory.
- * This method does a scan of all files (deep/recursive mode can be set
- * with the boolean recurseMode parameter) and converts all valid file paths with SPconverter
+ * This method scans for all files (deep/recursive mode can be set
+ * with the boolean recurseMode parameter) and converts all valid file paths with SPconverter.
+ * The scan runs on the calling thread and hands each source to the shared
+ * scheduler as soon as it is found. A worker reads only its header and
+ * plans each output: skip it as up to date, copy the source, rewrite its
+ * header or convert it. It then converts whichever planned job has the
+ * most estimated work left, using its own Converter, and the channels of
+ * a file are resampled on the same workers once there are fewer files
+ * than workers. Progress and the time left are reported against the work
+ * planned so far, which grows as probes complete; the plan's totals are
+ * printed at the end. A dry run instead scans the whole tree, probes every
+ * header in parallel and writes the plan out in full before anything is
+ * created, as only it needs the full plan first. With
+ * fan-out targets, each target gets its own subdirectory of the output
+ * directory and every source is decoded once for all of them.
  * @param inPath Path of the file to check/process.
- * @param conv The SPconverter object used for conversion.
  * @param recurseMode Sets recursive mode on/off.
+ * @param scheduler Worker pool to convert on.
+ * @param settings Conversion settings every worker's Converter is created with.
+ * @param targets Fan-out targets, empty to convert to settings.output only.
+ * @param incremental Skips files whose output in the manifest is still current.
+ * @param planPath File to write the plan to instead of converting, empty to convert.
+ * @return bool indicating whether the plan could be written, always true when converting.
  */
-void processDirectory(const fs::path& inPath, Converter& conv, bool recurseMode) {
-    // Initialize fileList 
-    std::vector<std::string> fileList;
+bool processDirectory(const fs::path& inPath, bool recurseMode, TaskScheduler& scheduler,
+                      const ConversionSettings& settings, const std::vector<OutputTarget>& targets,
+                      bool incremental, const fs::path& planPath) {
+    // Outputs go to a new directory with "-SPC" appended to the original directory name
+    fs::path convertedDir = inPath.parent_path() / (inPath.filename().string() + "-SPC");
 
-    // Set std::filesystem iterator type based on recurse mode
-    if (recurseMode) {
-        getFilePaths(fs::recursive_directory_iterator(inPath), fileList);
-    } else {
-        getFilePaths(fs::directory_iterator(inPath), fileList);
+    // Load the record of earlier runs when converting incrementally
+    Manifest manifest;
+    fs::path manifestPath = convertedDir / Manifest::fileName;
+    if (incremental) {
+        manifest.load(manifestPath);
     }
 
-    // Set the file counter to initial state
-    int fileCounter = 1;
+    // A run that was interrupted left the outputs it finished in its journal
+    Journal journal;
+    fs::path journalPath = convertedDir / Journal::fileName;
+    const size_t resumed = journal.load(journalPath);
+    if (resumed > 0) {
+        std::cout << "Resuming an interrupted run: " << resumed << " outputs already done" << std::endl;
+    }
+
+    // Profiles and manifest parameters of each output, a single one
+    // without fan-out targets
+    std::vector<const OutputProfile*> profiles;
+    std::vector<std::string> targetParams;
+    if (targets.empty()) {
+        profiles.push_back(&settings.output);
+        targetParams.push_back(getConversionParams(settings));
+    }
+    for (const OutputTarget& target : targets) {
+        ConversionSettings targetSettings = settings;
+        targetSettings.output = target.profile;
+        profiles.push_back(&target.profile);
+        targetParams.push_back(getConversionParams(targetSettings));
+    }
+
+    // Describes a source and where its outputs go, creating nothing yet
+    size_t scanned = 0;
+    auto makeJob = [&](const fs::directory_entry& entry) {
+        instrument::ScopedTimer timer(instrument::Stage::Filesystem);
+
+        ConversionJob job;
+        job.inPath = entry.path().string();
+        job.order = scanned++;
+
+        // Entries come from walking inPath, so the relative path needs no syscalls
+        job.relativePath = entry.path().lexically_relative(inPath).string();
+        job.outPath = withContainerExtension(convertedDir / job.relativePath, settings.output.container);
+
+        for (const OutputTarget& target : targets) {
+            const fs::path outPath = withContainerExtension(convertedDir / target.label / job.relativePath,
+                                                            target.profile.container);
+            job.outputs.push_back({ target.profile, outPath.string() });
+        }
+        return job;
+    };
+
+    // Outputs of the jobs scanned so far, only touched by the scanning
+    // thread. Names could still meet (a.flac.wav next to a.flac), and two
+    // jobs must never write one file, so the later source is left out
+    std::unordered_set<std::string> claimedOutputs;
+    auto claimOutputs = [&](const ConversionJob& job) {
+        std::vector<std::string> paths;
+        if (targets.empty()) {
+            paths.push_back(job.outPath.string());
+        }
+        for (const FanOutOutput& output : job.outputs) {
+            paths.push_back(output.path);
+        }
+        for (const std::string& path : paths) {
+            if (claimedOutputs.count(path) > 0) {
+                std::cerr << "[!] Skipping " << job.inPath << ", another source already writes " << path
+                          << std::endl;
+                return false;
+            }
+        }
+        claimedOutputs.insert(paths.begin(), paths.end());
+        return true;
+    };
+
+    // Set std::filesystem iterator type based on recurse mode
+    auto scan = [&](auto onFile) {
+        const auto options = fs::directory_options::skip_permission_denied;
+        std::error_code ec;
+        if (recurseMode) {
+            scanFiles(fs::recursive_directory_iterator(inPath, options, ec), onFile);
+        } else {
+            scanFiles(fs::directory_iterator(inPath, options, ec), onFile);
+        }
+        if (ec) {
+            std::cerr << "Error scanning the directory: " << ec.message() << std::endl;
+        }
+    };
+
+    // Reads the header of a source and plans each of its outputs
+    auto probeJob = [&](ConversionJob& job) {
+        instrument::ScopedTimer timer(instrument::Stage::Probe);
+        job.probed = probeSource(job.inPath, job.source);
+        for (size_t t = 0; t < profiles.size(); t++) {
+            const std::string key = targets.empty() ? job.relativePath : targets[t].label + "/" + job.relativePath;
+            const fs::path outPath = targets.empty() ? job.outPath : fs::path(job.outputs[t].path);
+
+            PlanAction action = PlanAction::Convert;
+            if (incremental && manifest.isUpToDate(job.inPath, key, targetParams[t], outPath)) {
+                action = PlanAction::Skip;
+            } else if (journal.isDone(job.inPath, targetParams[t], outPath)) {
+                // Finished before the interruption, the manifest still has to learn of it
+                action = PlanAction::Skip;
+                if (incremental) {
+                    manifest.record(job.inPath, key, targetParams[t], outPath);
+                }
+            } else if (job.probed) {
+                action = planOutput(job.source, settings, *profiles[t]);
+            }
+            job.actions.push_back(action);
+            job.work += estimateWork(job.source, action);
+        }
+    };
+
+    // A dry run needs every header before it can write the plan, so it
+    // collects the whole tree, then probes a few files per task to keep
+    // the scheduling overhead small next to a header read
+    if (!planPath.empty()) {
+        std::vector<ConversionJob> jobs;
+        scan([&](const fs::directory_entry& entry) {
+            ConversionJob job = makeJob(entry);
+            if (claimOutputs(job)) {
+                jobs.push_back(std::move(job));
+            }
+        });
+
+        static const size_t probeBatch = 16;
+        {
+            TaskGroup probes(scheduler);
+            for (size_t first = 0; first < jobs.size(); first += probeBatch) {
+                const size_t last = std::min(jobs.size(), first + probeBatch);
+                probes.run([&probeJob, &jobs, first, last]() {
+                    for (size_t i = first; i < last; i++) {
+                        probeJob(jobs[i]);
+                    }
+                });
+            }
+            probes.wait();
+        }
+
+        PlanSummary plan;
+        for (const ConversionJob& job : jobs) {
+            plan.addFile(job.probed);
+            for (PlanAction action : job.actions) {
+                plan.addOutput(job.source, action);
+            }
+        }
+        plan.print(std::cout);
+
+        std::ofstream file(planPath, std::ios::trunc);
+        for (const ConversionJob& job : jobs) {
+            for (size_t t = 0; t < job.actions.size(); t++) {
+                const std::string outPath = targets.empty() ? job.outPath.string() : job.outputs[t].path;
+                writePlanEntry(file, job.actions[t], job.source, job.inPath, outPath);
+            }
+        }
+        if (!file.good()) {
+            std::cerr << "Error writing the plan." << std::endl;
+            return false;
+        }
+        std::cout << "Plan written to " << planPath.string() << std::endl;
+        return true;
+    }
 
-    // Create a new directory with "-SPC" appended to the original directory name
-    fs::path convertedDir = inPath.parent_path() / (inPath.filename().string() + "-SPC");
     fs::create_directory(convertedDir);
+    if (!journal.open(journalPath)) {
+        std::cerr << "Error opening the journal, an interrupted run will start over." << std::endl;
+    }
 
-    // Process all file paths in fileList
-    for (const auto& filePath : fileList) {
-        std::cout << getProgressStr(filePath, fileCounter, fileList.size()) << std::endl;
+    JobQueue queue;
+    std::atomic<int> found(0);
+    std::atomic<int> completed(0);
+    std::mutex outputMutex;
+    PlanSummary plan;
+    double workDone = 0.0;
+    const auto convertStart = std::chrono::steady_clock::now();
 
-        // Construct the output path for the converted file in the new directory
-        std::string fileName = fs::path(filePath).filename().string();
+    // Small sources are read ahead once probed, largest first among those
+    // waiting, so a worker tends to find its next file in memory
+    std::unique_ptr<AsyncFileIO> asyncIO;
+    if (settings.asyncIO && targets.empty()) {
+        asyncIO.reset(new AsyncFileIO());
+        std::cout << "Async I/O: " << (asyncIO->isAsync() ? "io_uring" : "blocking fallback") << std::endl;
+    }
 
-        // Construct the output path in the new directory
-        std::string relativePath = fs::relative(filePath, inPath).string();
-        fs::path outFilePath = convertedDir / relativePath;
+    // One Converter per worker, created by the worker on its first file
+    std::vector<std::unique_ptr<Converter>> converters(scheduler.getThreadCount());
+    std::vector<std::unique_ptr<FanOutConverter>> fanOuts(scheduler.getThreadCount());
 
-        // Ensure the parent directory exists for the output file
-        fs::create_directories(outFilePath.parent_path());
+    auto convertSingle = [&](const ConversionJob& job) -> std::string {
+        if (job.actions[0] == PlanAction::Skip) {
+            return "Up to date";
+        }
+
+        std::unique_ptr<Converter>& conv = converters[scheduler.getCurrentWorker()];
+        if (!conv) {
+            conv.reset(new Converter(settings));
+            conv->setScheduler(&scheduler);
+            conv->setAsyncIO(asyncIO.get());
+            conv->setJournal(&journal);
+        }
+
+        // The manifest learns of the output only once it is in place, which
+        // for an output written behind is after convert() returns
+        if (incremental) {
+            conv->setOnOutput([&manifest, &targetParams, inPath = job.inPath, key = job.relativePath,
+                               outPath = job.outPath]() {
+                manifest.record(inPath, key, targetParams[0], outPath);
+            });
+        }
 
         // Process the file using the old file path for input and the new directory for output
-        processFile(filePath, outFilePath, conv);
-    
-        // Iterate fileCounter
-        fileCounter++;
+        return processFile(job.inPath, job.outPath.string(), *conv) ? "Converted" : "Failed";
+    };
+
+    auto convertFanOut = [&](const ConversionJob& job) -> std::string {
+        // Only targets whose output is out of date are converted, keyed by target and file
+        std::vector<FanOutOutput> outputs;
+        std::vector<size_t> indices;
+        for (size_t t = 0; t < targets.size(); t++) {
+            if (job.actions[t] != PlanAction::Skip) {
+                outputs.push_back(job.outputs[t]);
+                indices.push_back(t);
+            }
+        }
+
+        if (outputs.empty()) {
+            return "Up to date";
+        }
+
+        std::unique_ptr<FanOutConverter>& conv = fanOuts[scheduler.getCurrentWorker()];
+        if (!conv) {
+            conv.reset(new FanOutConverter(settings));
+            conv->setScheduler(&scheduler);
+            conv->setJournal(&journal);
+        }
+
+        if (!conv->convert(job.inPath.c_str(), outputs)) {
+            return "Failed";
+        }
+        if (incremental) {
+            for (size_t t : indices) {
+                manifest.record(job.inPath, targets[t].label + "/" + job.relativePath, targetParams[t],
+                                job.outputs[t].path);
+            }
+        }
+        return "Converted";
+    };
+
+    // Output directories already created
+    std::mutex dirMutex;
+    std::unordered_set<std::string> createdDirs;
+    createdDirs.insert(convertedDir.string());
+
+    // Probes a job and plans it, then converts whichever probed job has
+    // the most work left, so largest-first holds among the files known
+    auto probeAndConvert = [&](ConversionJob& job) {
+        probeJob(job);
+
+        {
+            instrument::ScopedTimer timer(instrument::Stage::Filesystem);
+
+            // Ensure the parent directories exist for the output files
+            for (size_t t = 0; t < job.actions.size(); t++) {
+                if (job.actions[t] == PlanAction::Skip) {
+                    continue;
+                }
+                fs::path outDir = (targets.empty() ? job.outPath : fs::path(job.outputs[t].path)).parent_path();
+                std::lock_guard<std::mutex> lock(dirMutex);
+                if (createdDirs.insert(outDir.string()).second) {
+                    std::error_code dirEc;
+                    fs::create_directories(outDir, dirEc);
+                }
+            }
+        }
+
+        {
+            // The time left is estimated against the work planned so far
+            std::lock_guard<std::mutex> lock(outputMutex);
+            plan.addFile(job.probed);
+            for (PlanAction action : job.actions) {
+                plan.addOutput(job.source, action);
+            }
+        }
+        if (asyncIO && (job.actions[0] == PlanAction::Convert || job.actions[0] == PlanAction::Copy)) {
+            asyncIO->prefetch(job.inPath);
+        }
+        queue.push(std::move(job));
+
+        const ConversionJob next = queue.pop();
+        instrument::beginFile();
+        const std::string status = targets.empty() ? convertSingle(next) : convertFanOut(next);
+        instrument::endFile(next.inPath);
+
+        int done = ++completed;
+        std::lock_guard<std::mutex> lock(outputMutex);
+        workDone += next.work;
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - convertStart).count();
+        std::cout << getProgressStr(next.inPath, done, found, status)
+                  << getEtaStr(workDone, plan.getWork(), elapsed) << std::endl;
+    };
+
+    // The scan runs on the calling thread and hands each file to the
+    // workers as soon as it is found, so conversion starts right away
+    TaskGroup group(scheduler);
+    scan([&](const fs::directory_entry& entry) {
+        std::shared_ptr<ConversionJob> job = std::make_shared<ConversionJob>(makeJob(entry));
+        if (!claimOutputs(*job)) {
+            return;
+        }
+        found++;
+        group.run([&probeAndConvert, job]() { probeAndConvert(*job); });
+    });
+
+    // Wait for the workers to get through the files, and their outputs to reach the disk
+    group.wait();
+    if (asyncIO) {
+        const size_t failed = asyncIO->drain();
+        if (failed > 0) {
+            std::cerr << "Error writing " << failed << " outputs." << std::endl;
+        }
+    }
+    plan.print(std::cout);
+
+    if (incremental && !manifest.save(manifestPath)) {
+        std::cerr << "Error writing the manifest." << std::endl;
+    }
+
+    // The run got to the end, so there is nothing left to resume
+    journal.remove();
+    return true;
+}
+
+/**
+ * @brief Designs the resampler filters for common source rates.
+ * The kernels end up in the kernel cache, so later runs converting from
+ * these rates skip filter design entirely.
+ * @param profile Output profile giving the target rate and filter spec.
+ */
+void primeKernelCache(const OutputProfile& profile)
+{
+    static const int commonRates[] = { 8000, 11025, 16000, 22050, 32000, 44100, 48000, 88200, 96000, 176400, 192000 };
+
+    // Kernels do not depend on the block length the resampler is built for
+    ResamplerPool pool;
+    for (int rate : commonRates) {
+        if (rate != profile.sampleRate) {
+            pool.acquire(rate, profile.sampleRate, 8192, profile.resampler);
+        }
     }
 }
 
+/**
+ * @brief Prints the command line usage.
+ * @param program Name the program was invoked with.
+ */
+void printUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [-j N] [--pin] [--preset NAME] [-r RATE] [-c CH] [-f FORMAT] [--container C] [-q QUALITY] [--trans-band PCT] [-t TARGET]... [-d DITHER] [-n SHAPE] [--trim DB] [--fade MS] [--normalize MODE] [--lookahead SEC] [-i] [--plan FILE] [--no-pipeline] [--slice] [--no-mmap] [--async-io] [--no-kernel-cache] [--prime-kernels] [--stats F] <file|directory|--serve|--socket PATH>" << std::endl;
+    std::cout << "  -j N       Number of worker threads for files and channels (default: all cores)" << std::endl;
+    std::cout << "  --pin      Pin each worker to a core, spread over the NUMA nodes" << std::endl;
+    std::cout << "  --preset NAME  Start from a device preset, see --list-presets (default: sp404)" << std::endl;
+    std::cout << "  -r RATE    Target sample rate in Hz (default: 48000)" << std::endl;
+    std::cout << "  -c CH      Output channels, 0 keeps the source's (default: 0)" << std::endl;
+    std::cout << "  -f FORMAT  Output samples: pcm16, pcm24, pcm12, ulaw (default: pcm16)" << std::endl;
+    std::cout << "  --container C  Output file format: wav, aiff (default: wav)" << std::endl;
+    std::cout << "  -q QUALITY Resampler tier, see --list-qualities, or 16|24 for the stop-band only (default: standard)" << std::endl;
+    std::cout << "  --trans-band PCT  Resampler transition band in percent (default: 2)" << std::endl;
+    std::cout << "  -t TARGET  Also write LABEL[:name=value,...], a preset or options over the profile; repeatable" << std::endl;
+    std::cout << "  -d DITHER  Dither before rounding to the output bit depth: none, tpdf (default: tpdf)" << std::endl;
+    std::cout << "  -n SHAPE   Noise shaping: none, first, fweighted, eweighted (default: none)" << std::endl;
+    std::cout << "  --trim DB  Cut leading and trailing silence at or below DB dBFS, e.g. -60" << std::endl;
+    std::cout << "  --fade MS  Fade in and out over MS milliseconds at the trimmed ends (default: 0)" << std::endl;
+    std::cout << "  --normalize MODE  Normalize each output: peak[:DBFS] (default -1) or lufs[:LUFS] (default -23)" << std::endl;
+    std::cout << "  --lookahead SEC   Hold outputs up to SEC seconds in memory while normalizing (default: 30)" << std::endl;
+    std::cout << "  -i         Incremental: skip files unchanged since the last run" << std::endl;
+    std::cout << "  --plan FILE  Dry run: write the plan for a directory to FILE and exit" << std::endl;
+    std::cout << "  --no-pipeline  Convert large files on a single thread" << std::endl;
+    std::cout << "  --slice    Resample long files as slices on all workers, same output as one pass" << std::endl;
+    std::cout << "  --no-mmap  Read and write every file through libsndfile" << std::endl;
+    std::cout << "  --async-io Read small sources ahead and write small outputs behind in batches (directories)" << std::endl;
+    std::cout << "  --no-kernel-cache  Design every filter instead of loading it from disk" << std::endl;
+    std::cout << "  --prime-kernels    Store the filters for common source rates and exit" << std::endl;
+    std::cout << "  --list-presets  Print the device presets and exit" << std::endl;
+    std::cout << "  --list-qualities  Print the resampler quality tiers and exit" << std::endl;
+    std::cout << "  --stats F  Print per-stage timings at the end: table or jsonl" << std::endl;
+    std::cout << "  --serve    Run JSONL jobs read from stdin, one response line per job on stdout" << std::endl;
+    std::cout << "  --socket PATH  Run JSONL jobs sent to a Unix socket at PATH" << std::endl;
+}
+
 int main(int argc, char* argv[]) {
 
     // Record the start time
@@ -160,18 +657,234 @@ int main(int argc, char* argv[]) {
 
     // Setup required params 
     std::string inPath, outPath;
-    inPath = argv[1];
     bool recurseMode = true;
+    unsigned int jobCount = std::max(1u, std::thread::hardware_concurrency());
+    ConversionSettings settings;
+    bool incremental = false;
+    bool printStats = false;
+    bool pinWorkers = false;
+    bool useKernelCache = true;
+    bool primeKernels = false;
+    bool serveStdio = false;
+    std::string socketPath;
+    std::vector<std::string> targetSpecs;
+    std::string planPath;
+    instrument::Format statsFormat = instrument::Format::Table;
+
+    // Parse the command line options
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string profileOption;
+        if (arg == "--preset") {
+            profileOption = "preset";
+        } else if (arg == "-r") {
+            profileOption = "rate";
+        } else if (arg == "-c") {
+            profileOption = "channels";
+        } else if (arg == "-f") {
+            profileOption = "format";
+        } else if (arg == "--container") {
+            profileOption = "container";
+        } else if (arg == "-q") {
+            profileOption = "quality";
+        } else if (arg == "--trans-band") {
+            profileOption = "transband";
+        }
+
+        if (!profileOption.empty() && i + 1 < argc) {
+            std::string error;
+            if (!applyProfileOption(profileOption, argv[++i], settings.output, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+        } else if (arg == "-t" && i + 1 < argc) {
+            targetSpecs.push_back(argv[++i]);
+        } else if (arg == "-j" && i + 1 < argc) {
+            jobCount = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--pin") {
+            pinWorkers = true;
+        } else if (arg == "-d" && i + 1 < argc) {
+            if (!parseDitherMode(argv[++i], settings.dither)) {
+                std::cerr << "Unknown dither mode: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "-n" && i + 1 < argc) {
+            if (!parseNoiseShape(argv[++i], settings.noiseShape)) {
+                std::cerr << "Unknown noise shaping filter: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if ((arg == "--trim" || arg == "--fade") && i + 1 < argc) {
+            std::string error;
+            if (!applyTrimOption(arg.substr(2), argv[++i], settings.trim, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+        } else if ((arg == "--normalize" || arg == "--lookahead") && i + 1 < argc) {
+            std::string error;
+            if (!applyNormalizeOption(arg.substr(2), argv[++i], settings.normalize, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+        } else if (arg == "--plan" && i + 1 < argc) {
+            planPath = argv[++i];
+        } else if (arg == "-i") {
+            incremental = true;
+        } else if (arg == "--no-pipeline") {
+            settings.pipeline = false;
+        } else if (arg == "--slice") {
+            settings.slice = true;
+        } else if (arg == "--no-mmap") {
+            settings.mappedIO = false;
+        } else if (arg == "--async-io") {
+            settings.asyncIO = true;
+        } else if (arg == "--no-kernel-cache") {
+            useKernelCache = false;
+        } else if (arg == "--prime-kernels") {
+            primeKernels = true;
+        } else if (arg == "--serve") {
+            serveStdio = true;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--stats" && i + 1 < argc) {
+            if (!instrument::parseFormat(argv[++i], statsFormat)) {
+                std::cerr << "Unknown stats format: " << argv[i] << std::endl;
+                return 1;
+            }
+            printStats = true;
+        } else if (arg == "--list-presets") {
+            listPresets(std::cout);
+            return 0;
+        } else if (arg == "--list-qualities") {
+            listQualities(std::cout);
+            return 0;
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            inPath = arg;
+        }
+    }
+
+    // Targets start from the profile the other options built; a single one
+    // simply replaces it
+    std::vector<OutputTarget> targets;
+    for (const std::string& spec : targetSpecs) {
+        OutputTarget target;
+        std::string error;
+        if (!parseTarget(spec, settings.output, target, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        for (const OutputTarget& other : targets) {
+            if (other.label == target.label) {
+                std::cerr << "Duplicate target label: " << target.label << std::endl;
+                return 1;
+            }
+        }
+        targets.push_back(target);
+    }
+    if (targets.size() == 1) {
+        settings.output = targets[0].profile;
+        targets.clear();
+    }
+
+    const bool serverMode = serveStdio || !socketPath.empty();
+    if (inPath.empty() && !primeKernels && !serverMode) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Standard output carries the job responses when serving stdin, so
+    // everything else printed goes to stderr instead
+    if (serveStdio) {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
+    if (printStats) {
+        instrument::enable();
+    }
 
-    // Initialise the converter
-    Converter spconverter;
+    // Check the FFT backend r8brain was built with before trusting it
+    double fftErrorDb;
+    if (!runFFTSelfTest(fftErrorDb)) {
+        std::cerr << "FFT self-test failed for backend " << getFFTBackendName()
+                  << " (error " << fftErrorDb << " dB)." << std::endl;
+        return 1;
+    }
+    std::cout << "FFT backend: " << getFFTBackendName() << std::endl;
+
+    // Map the filters designed by earlier runs
+    const std::string kernelCachePath = useKernelCache ? kernelcache::getDefaultPath() : std::string();
+    if (!kernelCachePath.empty()) {
+        kernelcache::open(kernelCachePath);
+    }
+
+    if (primeKernels) {
+        primeKernelCache(settings.output);
+        for (const OutputTarget& target : targets) {
+            primeKernelCache(target.profile);
+        }
+        if (kernelCachePath.empty() || !kernelcache::save()) {
+            std::cerr << "Error writing the kernel cache." << std::endl;
+            return 1;
+        }
+        std::cout << "Kernel cache: " << kernelCachePath << std::endl;
+        return 0;
+    }
+
+    // Files and the channels within them share one pool of workers, and
+    // the memory their arenas may keep idle
+    arena::setThreadCount(jobCount);
+    TaskScheduler scheduler(jobCount, pinWorkers);
+    if (pinWorkers) {
+        std::cout << "Pinned " << scheduler.getThreadCount() << " workers over " << scheduler.getNodeCount()
+                  << " NUMA node" << (scheduler.getNodeCount() == 1 ? "" : "s") << std::endl;
+    }
+
+    // Serve jobs until told to stop, keeping the workers' resamplers warm
+    if (serverMode) {
+        bool served;
+        {
+            JobServer server(scheduler, settings, !kernelCachePath.empty());
+            served = socketPath.empty() ? server.serveStdio() : server.serveSocket(socketPath);
+        }
+        if (!kernelCachePath.empty() && !kernelcache::save()) {
+            std::cerr << "Error writing the kernel cache." << std::endl;
+        }
+        if (printStats) {
+            instrument::report(std::cerr, statsFormat);
+        }
+        return served ? 0 : 1;
+    }
 
     // Validate all neccessary paths and convert
     if (fs::exists(inPath)) {
         if (fs::is_regular_file(inPath) && hasAllowedExtension(inPath)) {
-            processFile(inPath, spconverter);
+            // Convert on a worker so the channels can be spread over the pool
+            TaskGroup group(scheduler);
+            group.run([&]() {
+                instrument::beginFile();
+                if (targets.empty()) {
+                    Converter spconverter(settings);
+                    spconverter.setScheduler(&scheduler);
+                    processFile(inPath, spconverter, settings.output.container);
+                } else {
+                    // Every target is written next to the input, tagged with its label
+                    std::vector<FanOutOutput> outputs;
+                    for (const OutputTarget& target : targets) {
+                        outputs.push_back({ target.profile, getOutPath(inPath, target.profile.container, target.label) });
+                    }
+                    FanOutConverter fanOut(settings);
+                    fanOut.setScheduler(&scheduler);
+                    fanOut.convert(inPath.c_str(), outputs);
+                }
+                instrument::endFile(inPath);
+            });
+            group.wait();
         } else if (fs::is_directory(inPath)) {
-            processDirectory(inPath, spconverter, recurseMode);
+            if (!processDirectory(inPath, recurseMode, scheduler, settings, targets, incremental, planPath)) {
+                return 1;
+            }
         } else {
             std::cout << inPath << " is neither a regular file nor a directory." << std::endl;
         }
@@ -179,6 +892,11 @@ int main(int argc, char* argv[]) {
         std::cout << inPath << " does not exist." << std::endl;
     }
 
+    // Keep the filters designed during this run for the next one
+    if (!kernelCachePath.empty() && !kernelcache::save()) {
+        std::cerr << "Error writing the kernel cache." << std::endl;
+    }
+
     // Record the end time
     auto end = std::chrono::high_resolution_clock::now();
 
@@ -188,5 +906,9 @@ int main(int argc, char* argv[]) {
     // Print the duration in microseconds
     std::cout << "Execution Time: " << duration.count() << " microseconds" << std::endl;
 
+    if (printStats) {
+        instrument::report(std::cout, statsFormat);
+    }
+
     return 0;
 }
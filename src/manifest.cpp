@@ -0,0 +1,257 @@
+/*
+  ==============================================================================
+
+    manifest.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "manifest.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+const char* Manifest::fileName = ".spconverter-manifest";
+
+/**
+ * @brief Gets the modification time of a file as a plain integer.
+ * @param path Path of the file.
+ * @return The modification time in file clock ticks, or 0 on error.
+ */
+int64_t Manifest::getMTime(const fs::path& path)
+{
+    std::error_code ec;
+    auto time = fs::last_write_time(path, ec);
+    return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+/**
+ * @brief Loads the manifest from disk.
+ * Lines that cannot be parsed are ignored, so a damaged manifest only
+ * costs a reconversion of the affected files.
+ * @param path Path of the manifest file.
+ * @return bool indicating whether a manifest was read.
+ */
+bool Manifest::load(const fs::path& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string line;
+    while (std::getline(file, line)) {
+        // size, mtime, hash, params, source key, output path
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, '\t')) {
+            fields.push_back(field);
+        }
+        if (fields.size() != 6) {
+            continue;
+        }
+
+        try {
+            ManifestEntry entry;
+            entry.size = std::stoull(fields[0]);
+            entry.mtime = std::stoll(fields[1]);
+            entry.hash = std::stoull(fields[2], nullptr, 16);
+            entry.params = fields[3];
+            entry.outPath = fields[5];
+            entries[fields[4]] = entry;
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Writes the manifest to disk.
+ * The manifest is written next to its final location and renamed into
+ * place, so an interrupted run never leaves a truncated manifest behind.
+ * @param path Path of the manifest file.
+ * @return bool indicating whether the manifest was written.
+ */
+bool Manifest::save(const fs::path& path)
+{
+    fs::path tmpPath = path;
+    tmpPath += ".tmp";
+
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& it : entries) {
+            const ManifestEntry& e = it.second;
+            file << e.size << '\t' << e.mtime << '\t' << std::hex << e.hash << std::dec << '\t'
+                 << e.params << '\t' << it.first << '\t' << e.outPath << '\n';
+        }
+
+        if (!file.good()) {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    return !ec;
+}
+
+/**
+ * @brief Checks whether a source still matches its manifest entry.
+ * Size, modification time and parameters are compared first. When only the
+ * modification time differs the content hash decides, and a matching hash
+ * refreshes the stored time so the next run takes the cheap path again.
+ * @param source Path of the source file.
+ * @param key Key of the source in the manifest.
+ * @param params Conversion parameters the output has to match.
+ * @param outPath Path the output is expected at.
+ * @return bool indicating whether the conversion can be skipped.
+ */
+bool Manifest::isUpToDate(const fs::path& source, const std::string& key,
+                          const std::string& params, const fs::path& outPath)
+{
+    ManifestEntry entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            return false;
+        }
+        entry = it->second;
+    }
+
+    std::error_code ec;
+    uintmax_t size = fs::file_size(source, ec);
+    if (ec || size != entry.size || entry.params != params || entry.outPath != outPath.string() ||
+        !fs::exists(outPath, ec)) {
+        return false;
+    }
+
+    int64_t mtime = getMTime(source);
+    if (mtime == entry.mtime) {
+        return true;
+    }
+
+    if (getHash(source, size, mtime) != entry.hash) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[key].mtime = mtime;
+    return true;
+}
+
+/**
+ * @brief Gets the content hash of a source, reading it only if needed.
+ * A hash already taken this run, or stored for the same size and
+ * modification time, is reused.
+ * @param source Path of the source file.
+ * @param size Current size of the source.
+ * @param mtime Current modification time of the source.
+ * @return The hash.
+ */
+uint64_t Manifest::getHash(const fs::path& source, uintmax_t size, int64_t mtime)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = hashes.find(source.string());
+        if (it != hashes.end() && it->second.size == size && it->second.mtime == mtime) {
+            return it->second.hash;
+        }
+    }
+
+    ManifestEntry known;
+    known.size = size;
+    known.mtime = mtime;
+    known.hash = hashFile(source);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    hashes[source.string()] = known;
+    return known.hash;
+}
+
+/**
+ * @brief Records a successful conversion.
+ * The source is only hashed if neither this run nor its previous entry
+ * already knows the hash of its current content.
+ * @param source Path of the source file.
+ * @param key Key of the source in the manifest.
+ * @param params Conversion parameters used.
+ * @param outPath Path the output was written to.
+ */
+void Manifest::record(const fs::path& source, const std::string& key,
+                      const std::string& params, const fs::path& outPath)
+{
+    std::error_code ec;
+    ManifestEntry entry;
+    entry.size = fs::file_size(source, ec);
+    entry.mtime = getMTime(source);
+    entry.params = params;
+    entry.outPath = outPath.string();
+
+    bool known = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second.size == entry.size && it->second.mtime == entry.mtime) {
+            entry.hash = it->second.hash;
+            known = true;
+        }
+    }
+    if (!known) {
+        entry.hash = getHash(source, entry.size, entry.mtime);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[key] = entry;
+}
+
+/**
+ * @brief Computes a fast 64 bit content hash of a file.
+ * Not cryptographic; it only needs to notice that content changed.
+ * @param path Path of the file to hash.
+ * @return The hash, or 0 if the file could not be read.
+ */
+uint64_t Manifest::hashFile(const fs::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    const uint64_t prime = 0x100000001B3ull;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    std::vector<char> buffer(1 << 16);
+
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        size_t got = static_cast<size_t>(file.gcount());
+
+        // Mix a word at a time, then the remaining tail bytes
+        size_t i = 0;
+        for (; i + 8 <= got; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, buffer.data() + i, sizeof(word));
+            hash = (hash ^ word) * prime;
+            hash ^= hash >> 29;
+        }
+        for (; i < got; i++) {
+            hash = (hash ^ static_cast<unsigned char>(buffer[i])) * prime;
+        }
+    }
+
+    return hash;
+}
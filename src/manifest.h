@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    manifest.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+/**
+ * @brief What the manifest remembers about one converted source file.
+ */
+struct ManifestEntry {
+    uintmax_t size;
+    int64_t mtime;
+    uint64_t hash;
+    std::string params;
+    std::string outPath;
+};
+
+/**
+ * @brief Record of previous conversions kept in the output directory.
+ * Used by incremental runs to skip sources whose output is still current.
+ * Lookups and updates are thread safe so workers can use it directly.
+ */
+class Manifest
+{
+public:
+    static const char* fileName;
+
+    bool load(const std::filesystem::path& path);
+    bool save(const std::filesystem::path& path);
+
+    bool isUpToDate(const std::filesystem::path& source, const std::string& key,
+                    const std::string& params, const std::filesystem::path& outPath);
+    void record(const std::filesystem::path& source, const std::string& key,
+                const std::string& params, const std::filesystem::path& outPath);
+
+    static uint64_t hashFile(const std::filesystem::path& path);
+    static int64_t getMTime(const std::filesystem::path& path);
+
+private:
+    uint64_t getHash(const std::filesystem::path& source, uintmax_t size, int64_t mtime);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, ManifestEntry> entries;
+    // Hashes taken this run by source path, so each source is read once
+    // however many targets it is recorded for
+    std::unordered_map<std::string, ManifestEntry> hashes;
+};
+
+#endif /* MANIFEST_H */
@@ -0,0 +1,540 @@
+/*
+  ==============================================================================
+
+    mappedfile.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "mappedfile.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "includes/r8brain/r8bbase.h"
+
+// Normalization factors used by libsndfile's double reader
+static const double int8Norm = 1.0 / 0x80;
+static const double int16Norm = 1.0 / 0x8000;
+static const double int24Norm = 1.0 / 0x800000;
+static const double int32Norm = 1.0 / 0x80000000u;
+
+static const bool hostBigEndian = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+
+static int16_t loadInt16(const unsigned char* p, bool bigEndian)
+{
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return static_cast<int16_t>(bigEndian != hostBigEndian ? __builtin_bswap16(v) : v);
+}
+
+static int32_t loadInt32(const unsigned char* p, bool bigEndian)
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return static_cast<int32_t>(bigEndian != hostBigEndian ? __builtin_bswap32(v) : v);
+}
+
+static int32_t loadInt24(const unsigned char* p, bool bigEndian)
+{
+    // Assemble in the top bytes, then shift down to sign extend
+    uint32_t v = bigEndian ? (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8)
+                           : (static_cast<uint32_t>(p[2]) << 24) | (p[1] << 16) | (p[0] << 8);
+    return static_cast<int32_t>(v) >> 8;
+}
+
+/**
+ * @brief Decodes 16 bit samples.
+ * @param in Encoded samples.
+ * @param count Number of samples.
+ * @param bigEndian Byte order of the samples.
+ * @param out Receives the normalized samples.
+ */
+static void decodeInt16(const unsigned char* in, size_t count, bool bigEndian, double* out)
+{
+    size_t i = 0;
+
+    if (bigEndian == hostBigEndian) {
+#if defined(R8B_SSE2)
+        const __m128d norm = _mm_set1_pd(int16Norm);
+        for (; i + 8 <= count; i += 8) {
+            // Widen to 32 bit by interleaving with itself and shifting the sign down
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            _mm_storeu_pd(out + i, _mm_mul_pd(_mm_cvtepi32_pd(lo), norm));
+            _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(lo, 0x4E)), norm));
+            _mm_storeu_pd(out + i + 4, _mm_mul_pd(_mm_cvtepi32_pd(hi), norm));
+            _mm_storeu_pd(out + i + 6, _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(hi, 0x4E)), norm));
+        }
+#elif defined(R8B_NEON)
+        const float64x2_t norm = vdupq_n_f64(int16Norm);
+        for (; i + 4 <= count; i += 4) {
+            int32x4_t v = vmovl_s16(vld1_s16(reinterpret_cast<const int16_t*>(in + i * 2)));
+            vst1q_f64(out + i, vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(v))), norm));
+            vst1q_f64(out + i + 2, vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(v))), norm));
+        }
+#endif
+    }
+
+    for (; i < count; i++) {
+        out[i] = loadInt16(in + i * 2, bigEndian) * int16Norm;
+    }
+}
+
+/**
+ * @brief Decodes 24 bit samples.
+ * Three byte samples do not map onto SSE2 lanes without a byte shuffle,
+ * so this stays a scalar loop of plain loads and shifts.
+ * @param in Encoded samples.
+ * @param count Number of samples.
+ * @param bigEndian Byte order of the samples.
+ * @param out Receives the normalized samples.
+ */
+static void decodeInt24(const unsigned char* in, size_t count, bool bigEndian, double* out)
+{
+    for (size_t i = 0; i < count; i++) {
+        out[i] = loadInt24(in + i * 3, bigEndian) * int24Norm;
+    }
+}
+
+/**
+ * @brief Decodes 32 bit integer samples.
+ * @param in Encoded samples.
+ * @param count Number of samples.
+ * @param bigEndian Byte order of the samples.
+ * @param out Receives the normalized samples.
+ */
+static void decodeInt32(const unsigned char* in, size_t count, bool bigEndian, double* out)
+{
+    size_t i = 0;
+
+    if (bigEndian == hostBigEndian) {
+#if defined(R8B_SSE2)
+        const __m128d norm = _mm_set1_pd(int32Norm);
+        for (; i + 4 <= count; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4));
+            _mm_storeu_pd(out + i, _mm_mul_pd(_mm_cvtepi32_pd(v), norm));
+            _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(v, 0x4E)), norm));
+        }
+#elif defined(R8B_NEON)
+        const float64x2_t norm = vdupq_n_f64(int32Norm);
+        for (; i + 4 <= count; i += 4) {
+            int32x4_t v = vld1q_s32(reinterpret_cast<const int32_t*>(in + i * 4));
+            vst1q_f64(out + i, vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(v))), norm));
+            vst1q_f64(out + i + 2, vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(v))), norm));
+        }
+#endif
+    }
+
+    for (; i < count; i++) {
+        out[i] = loadInt32(in + i * 4, bigEndian) * int32Norm;
+    }
+}
+
+/**
+ * @brief Decodes 32 bit float samples, which are already normalized.
+ * @param in Encoded samples.
+ * @param count Number of samples.
+ * @param bigEndian Byte order of the samples.
+ * @param out Receives the samples.
+ */
+static void decodeFloat32(const unsigned char* in, size_t count, bool bigEndian, double* out)
+{
+    size_t i = 0;
+
+    if (bigEndian == hostBigEndian) {
+#if defined(R8B_SSE2)
+        for (; i + 4 <= count; i += 4) {
+            __m128 v = _mm_loadu_ps(reinterpret_cast<const float*>(in + i * 4));
+            _mm_storeu_pd(out + i, _mm_cvtps_pd(v));
+            _mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+        }
+#elif defined(R8B_NEON)
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t v = vld1q_f32(reinterpret_cast<const float*>(in + i * 4));
+            vst1q_f64(out + i, vcvt_f64_f32(vget_low_f32(v)));
+            vst1q_f64(out + i + 2, vcvt_high_f64_f32(v));
+        }
+#endif
+    }
+
+    for (; i < count; i++) {
+        int32_t bits = loadInt32(in + i * 4, bigEndian);
+        float v;
+        std::memcpy(&v, &bits, sizeof(v));
+        out[i] = v;
+    }
+}
+
+/**
+ * @brief Describes an uncompressed payload the way libsndfile would.
+ * @param layout Format and location of the payload.
+ * @param info Receives the frame count, rate, channels and format.
+ */
+void getLayoutInfo(const PcmLayout& layout, SF_INFO& info)
+{
+    int subformat;
+    switch (layout.encoding) {
+        case SampleEncoding::UInt8:
+            subformat = SF_FORMAT_PCM_U8;
+            break;
+        case SampleEncoding::Int8:
+            subformat = SF_FORMAT_PCM_S8;
+            break;
+        case SampleEncoding::Int16:
+            subformat = SF_FORMAT_PCM_16;
+            break;
+        case SampleEncoding::Int24:
+            subformat = SF_FORMAT_PCM_24;
+            break;
+        case SampleEncoding::Int32:
+            subformat = SF_FORMAT_PCM_32;
+            break;
+        default:
+            subformat = SF_FORMAT_FLOAT;
+            break;
+    }
+
+    info = SF_INFO();
+    info.frames = static_cast<sf_count_t>(layout.length / (layout.channels * getBytesPerSample(layout.encoding)));
+    info.samplerate = layout.sampleRate;
+    info.channels = layout.channels;
+    info.format = (layout.aiff ? SF_FORMAT_AIFF : SF_FORMAT_WAV) | subformat |
+                  (layout.bigEndian ? SF_ENDIAN_BIG : SF_ENDIAN_LITTLE);
+    info.sections = 1;
+    info.seekable = 1;
+}
+
+/**
+ * @brief Maps a file and parses its header.
+ * @param path Path of the file.
+ * @param info Receives the format in libsndfile's terms, so the rest of
+ * the converter cannot tell which reader is in use.
+ * @return bool indicating whether the file can be read natively. When it
+ * cannot, the caller falls back to libsndfile.
+ */
+bool MappedReader::open(const char* path, SF_INFO& info)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping keeps the file alive on its own
+    ::close(fd);
+
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    base = static_cast<const unsigned char*>(mapping);
+    mappedSize = static_cast<uint64_t>(st.st_size);
+    mapped = true;
+
+    if (!parse(info)) {
+        close();
+        return false;
+    }
+    madvise(const_cast<unsigned char*>(base), mappedSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+/**
+ * @brief Opens a WAV, RF64 or AIFF file already read into memory.
+ * @param data Contents of the file, kept alive until close().
+ * @param size Size of the file.
+ * @param info Receives the format of the file.
+ * @return bool indicating whether the file is plain PCM the reader can decode.
+ */
+bool MappedReader::open(const unsigned char* data, uint64_t size, SF_INFO& info)
+{
+    close();
+
+    base = data;
+    mappedSize = size;
+    mapped = false;
+    if (!parse(info)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the payload of the file at base and starts at its first frame.
+ * @param info Receives the format of the file.
+ * @return bool indicating whether the file is plain PCM the reader can decode.
+ */
+bool MappedReader::parse(SF_INFO& info)
+{
+    if (!parsePcmLayout(base, mappedSize, layout)) {
+        return false;
+    }
+
+    frameBytes = layout.channels * getBytesPerSample(layout.encoding);
+    totalFrames = static_cast<sf_count_t>(layout.length / frameBytes);
+    position = 0;
+    getLayoutInfo(layout, info);
+    return true;
+}
+
+/**
+ * @brief Decodes the next frames from the mapping.
+ * @param out Receives frames * channels normalized samples.
+ * @param frames Number of frames to read.
+ * @return Number of frames read.
+ */
+sf_count_t MappedReader::read(double* out, sf_count_t frames)
+{
+    frames = std::min(frames, totalFrames - position);
+    if (frames <= 0) {
+        return 0;
+    }
+
+    const unsigned char* in = base + layout.offset + static_cast<uint64_t>(position) * frameBytes;
+    const size_t count = static_cast<size_t>(frames) * layout.channels;
+
+    switch (layout.encoding) {
+        case SampleEncoding::UInt8:
+            for (size_t i = 0; i < count; i++) {
+                out[i] = (static_cast<int>(in[i]) - 128) * int8Norm;
+            }
+            break;
+        case SampleEncoding::Int8:
+            for (size_t i = 0; i < count; i++) {
+                out[i] = static_cast<signed char>(in[i]) * int8Norm;
+            }
+            break;
+        case SampleEncoding::Int16:
+            decodeInt16(in, count, layout.bigEndian, out);
+            break;
+        case SampleEncoding::Int24:
+            decodeInt24(in, count, layout.bigEndian, out);
+            break;
+        case SampleEncoding::Int32:
+            decodeInt32(in, count, layout.bigEndian, out);
+            break;
+        case SampleEncoding::Float32:
+            decodeFloat32(in, count, layout.bigEndian, out);
+            break;
+    }
+
+    position += frames;
+    return frames;
+}
+
+/**
+ * @brief Moves the read position within the mapping.
+ * @param frame Index of the frame.
+ * @return bool indicating whether the frame lies within the file.
+ */
+bool MappedReader::seek(sf_count_t frame)
+{
+    if (frame < 0 || frame > totalFrames) {
+        return false;
+    }
+    position = frame;
+    return true;
+}
+
+void MappedReader::close()
+{
+    if (base) {
+        if (mapped) {
+            munmap(const_cast<unsigned char*>(base), mappedSize);
+        }
+        base = nullptr;
+    }
+}
+
+/**
+ * @brief Fills in the header of the output for a given payload length.
+ * @param header Buffer of at least headerSize bytes.
+ * @param dataBytes Length of the payload.
+ * @return bool indicating whether the payload fits the container.
+ */
+bool MappedWriter::fillHeader(unsigned char* header, uint64_t dataBytes) const
+{
+    return container == Container::AIFF ? fillAiffHeader(header, sampleRate, channels, bitsPerSample, dataBytes)
+                                        : fillWavHeader(header, sampleRate, channels, bitsPerSample, dataBytes);
+}
+
+/**
+ * @brief Creates a PCM WAV or AIFF file with room for a known number of frames.
+ * @param path Path of the file.
+ * @param container Container of the output.
+ * @param format Encoding of the samples.
+ * @param sampleRate Sample rate of the output.
+ * @param channels Number of interleaved channels.
+ * @param frames Number of frames that will be written.
+ * @return bool indicating whether the file is ready. Mu-law, outputs too
+ * large for the container's header and filesystems without fallocate are
+ * left to libsndfile.
+ */
+bool MappedWriter::open(const char* path, Container container, SampleFormat format,
+                        int sampleRate, int channels, sf_count_t frames)
+{
+    close();
+
+    unsigned char header[aiffHeaderSize];
+    if (!setFormat(container, format, sampleRate, channels, frames, header)) {
+        return false;
+    }
+
+    fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    // Odd sized payloads are followed by a pad byte, which fallocate zeroes
+    void* mapped = MAP_FAILED;
+    if (fallocate(fd, 0, 0, static_cast<off_t>(mappedSize)) == 0) {
+        mapped = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+
+    if (mapped == MAP_FAILED) {
+        // Leave an empty file for the fallback writer to reuse
+        if (ftruncate(fd, 0) != 0) {
+            std::cerr << "Error truncating the output file." << std::endl;
+        }
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    base = static_cast<unsigned char*>(mapped);
+    madvise(base, mappedSize, MADV_SEQUENTIAL);
+    std::memcpy(base, header, headerSize);
+
+    capacity = frames;
+    position = 0;
+    return true;
+}
+
+/**
+ * @brief Starts a PCM WAV or AIFF file of known length in a buffer.
+ * The buffer holds the complete file, byte for byte what open() would
+ * have written to disk, once close() returns.
+ * @param buffer Receives the file.
+ * @param container Container of the output.
+ * @param format Encoding of the samples.
+ * @param sampleRate Sample rate of the output.
+ * @param channels Number of interleaved channels.
+ * @param frames Number of frames that will be written.
+ * @return bool indicating whether the writer is ready, false for the
+ * formats open() leaves to libsndfile.
+ */
+bool MappedWriter::open(std::vector<unsigned char>& buffer, Container container, SampleFormat format,
+                        int sampleRate, int channels, sf_count_t frames)
+{
+    close();
+
+    unsigned char header[aiffHeaderSize];
+    if (!setFormat(container, format, sampleRate, channels, frames, header)) {
+        return false;
+    }
+
+    buffer.assign(mappedSize, 0);
+    this->buffer = &buffer;
+    base = buffer.data();
+    std::memcpy(base, header, headerSize);
+
+    capacity = frames;
+    position = 0;
+    return true;
+}
+
+/**
+ * @brief Takes on the format of a new output and builds its header.
+ * @param container Container of the output.
+ * @param format Encoding of the samples.
+ * @param sampleRate Sample rate of the output.
+ * @param channels Number of interleaved channels.
+ * @param frames Number of frames that will be written.
+ * @param header Buffer of at least aiffHeaderSize bytes, receives the header.
+ * @return bool indicating whether the output can be written natively.
+ */
+bool MappedWriter::setFormat(Container container, SampleFormat format, int sampleRate, int channels,
+                             sf_count_t frames, unsigned char* header)
+{
+    if (format == SampleFormat::ULaw || frames <= 0) {
+        return false;
+    }
+
+    this->container = container;
+    this->sampleRate = sampleRate;
+    this->channels = channels;
+    bitsPerSample = getSampleBytes(format) * 8;
+    frameBytes = channels * getSampleBytes(format);
+    headerSize = container == Container::AIFF ? aiffHeaderSize : wavHeaderSize;
+
+    const uint64_t dataBytes = static_cast<uint64_t>(frames) * frameBytes;
+    mappedSize = headerSize + dataBytes + (dataBytes & 1);
+    return fillHeader(header, dataBytes);
+}
+
+/**
+ * @brief Copies encoded frames into the mapping.
+ * @param in Interleaved frames in the file's byte order.
+ * @param frames Number of frames to write.
+ * @return Number of frames written, less than frames if more arrive than announced.
+ */
+sf_count_t MappedWriter::write(const void* in, sf_count_t frames)
+{
+    frames = std::min(frames, capacity - position);
+    if (frames <= 0) {
+        return 0;
+    }
+
+    std::memcpy(base + headerSize + static_cast<uint64_t>(position) * frameBytes, in,
+                static_cast<size_t>(frames) * frameBytes);
+    position += frames;
+    return frames;
+}
+
+/**
+ * @brief Unmaps the file, shrinking it to what was actually written.
+ * A buffered output is shrunk the same way.
+ * @return bool indicating whether the file was completed without error.
+ */
+bool MappedWriter::close()
+{
+    if (!base) {
+        return true;
+    }
+
+    bool ok = true;
+    const uint64_t dataBytes = static_cast<uint64_t>(position) * frameBytes;
+    if (position < capacity) {
+        ok = fillHeader(base, dataBytes);
+    }
+
+    if (buffer) {
+        buffer->resize(headerSize + dataBytes + (dataBytes & 1));
+        buffer = nullptr;
+        base = nullptr;
+        return ok;
+    }
+
+    ok = munmap(base, mappedSize) == 0 && ok;
+    if (position < capacity) {
+        ok = ftruncate(fd, static_cast<off_t>(headerSize + dataBytes + (dataBytes & 1))) == 0 && ok;
+    }
+    ok = ::close(fd) == 0 && ok;
+
+    base = nullptr;
+    fd = -1;
+    return ok;
+}
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    mappedfile.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <cstdint>
+#include <sndfile.h>
+#include <vector>
+#include "audioio.h"
+#include "profile.h"
+#include "wavfile.h"
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+void getLayoutInfo(const PcmLayout& layout, SF_INFO& info);
+
+/**
+ * @brief Native reader for uncompressed WAV, RF64 and AIFF files.
+ * Maps the whole file and decodes samples straight from the mapped pages,
+ * with SSE2/NEON kernels for the common little-endian encodings. Output
+ * is normalized exactly like libsndfile's sf_readf_double. A file already
+ * read into memory is decoded the same way from its buffer.
+ */
+class MappedReader : public AudioReader
+{
+public:
+    ~MappedReader() override { close(); }
+
+    bool open(const char* path, SF_INFO& info);
+    bool open(const unsigned char* data, uint64_t size, SF_INFO& info);
+    sf_count_t read(double* out, sf_count_t frames) override;
+    bool seek(sf_count_t frame) override;
+    void close() override;
+
+    // Whole file, so other readers can open the same bytes
+    const unsigned char* getData() const { return base; }
+    uint64_t getSize() const { return mappedSize; }
+
+private:
+    bool parse(SF_INFO& info);
+
+    const unsigned char* base = nullptr;
+    uint64_t mappedSize = 0;
+    // Whether base is a mapping of our own or a caller's buffer
+    bool mapped = false;
+
+    PcmLayout layout;
+    int frameBytes = 0;
+    sf_count_t totalFrames = 0;
+    sf_count_t position = 0;
+};
+
+/**
+ * @brief Native writer for PCM WAV and AIFF files of known length.
+ * Preallocates the whole file with fallocate and copies the encoded
+ * samples straight into a shared mapping. If fewer frames arrive than
+ * announced, the file is truncated and its header corrected on close.
+ * Small outputs can instead be built in a buffer and written elsewhere.
+ */
+class MappedWriter : public AudioWriter
+{
+public:
+    ~MappedWriter() override { close(); }
+
+    bool open(const char* path, Container container, SampleFormat format,
+              int sampleRate, int channels, sf_count_t frames);
+    bool open(std::vector<unsigned char>& buffer, Container container, SampleFormat format,
+              int sampleRate, int channels, sf_count_t frames);
+    sf_count_t write(const void* in, sf_count_t frames) override;
+    bool close() override;
+
+private:
+    bool setFormat(Container container, SampleFormat format, int sampleRate, int channels, sf_count_t frames,
+                   unsigned char* header);
+    bool fillHeader(unsigned char* header, uint64_t dataBytes) const;
+
+    int fd = -1;
+    // Output built in memory instead of a file, if any
+    std::vector<unsigned char>* buffer = nullptr;
+    unsigned char* base = nullptr;
+    uint64_t mappedSize = 0;
+
+    Container container = Container::WAV;
+    int sampleRate = 0;
+    int channels = 0;
+    int bitsPerSample = 0;
+    int frameBytes = 0;
+    int headerSize = 0;
+    sf_count_t capacity = 0;
+    sf_count_t position = 0;
+};
+
+#endif /* MAPPEDFILE_H */
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    memfile.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "memfile.h"
+#include <cstdio>
+#include <cstring>
+
+SF_VIRTUAL_IO MemoryFile::virtualIO = {
+    &MemoryFile::getLength,
+    &MemoryFile::seek,
+    &MemoryFile::read,
+    &MemoryFile::write,
+    &MemoryFile::tell
+};
+
+/**
+ * @brief Opens the in-memory file with libsndfile.
+ * Opening for writing discards any previous content.
+ * @param mode SFM_READ or SFM_WRITE.
+ * @param sfinfo Format information, as for sf_open.
+ * @return The libsndfile handle, or nullptr on failure.
+ */
+SNDFILE* MemoryFile::open(int mode, SF_INFO* sfinfo)
+{
+    if (mode == SFM_WRITE) {
+        bytes.clear();
+    }
+    position = 0;
+    return sf_open_virtual(&virtualIO, mode, sfinfo, this);
+}
+
+sf_count_t MemoryFile::getLength(void* user)
+{
+    return static_cast<sf_count_t>(static_cast<MemoryFile*>(user)->bytes.size());
+}
+
+sf_count_t MemoryFile::seek(sf_count_t offset, int whence, void* user)
+{
+    MemoryFile* file = static_cast<MemoryFile*>(user);
+    sf_count_t base = 0;
+
+    if (whence == SEEK_CUR) {
+        base = file->position;
+    } else if (whence == SEEK_END) {
+        base = static_cast<sf_count_t>(file->bytes.size());
+    }
+
+    if (base + offset < 0) {
+        return -1;
+    }
+
+    file->position = base + offset;
+    return file->position;
+}
+
+sf_count_t MemoryFile::read(void* ptr, sf_count_t count, void* user)
+{
+    MemoryFile* file = static_cast<MemoryFile*>(user);
+    sf_count_t available = static_cast<sf_count_t>(file->bytes.size()) - file->position;
+
+    if (available <= 0) {
+        return 0;
+    }
+    if (count > available) {
+        count = available;
+    }
+
+    std::memcpy(ptr, file->bytes.data() + file->position, count);
+    file->position += count;
+    return count;
+}
+
+sf_count_t MemoryFile::write(const void* ptr, sf_count_t count, void* user)
+{
+    MemoryFile* file = static_cast<MemoryFile*>(user);
+    size_t end = static_cast<size_t>(file->position + count);
+
+    if (end > file->bytes.size()) {
+        file->bytes.resize(end);
+    }
+
+    std::memcpy(file->bytes.data() + file->position, ptr, count);
+    file->position += count;
+    return count;
+}
+
+sf_count_t MemoryFile::tell(void* user)
+{
+    return static_cast<MemoryFile*>(user)->position;
+}
@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    memfile.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <sndfile.h>
+#include <vector>
+
+#ifndef MEMFILE_H
+#define MEMFILE_H
+
+/**
+ * @brief A growable in-memory file libsndfile can read and write.
+ * Opened through sf_open_virtual, so audio can be decoded from or encoded
+ * to a buffer without touching the filesystem.
+ */
+class MemoryFile
+{
+public:
+    MemoryFile() = default;
+    explicit MemoryFile(std::vector<unsigned char> bytes) : bytes(std::move(bytes)) {}
+
+    SNDFILE* open(int mode, SF_INFO* sfinfo);
+
+    const std::vector<unsigned char>& getBytes() const { return bytes; }
+    std::vector<unsigned char>& getBytes() { return bytes; }
+
+private:
+    static sf_count_t getLength(void* user);
+    static sf_count_t seek(sf_count_t offset, int whence, void* user);
+    static sf_count_t read(void* ptr, sf_count_t count, void* user);
+    static sf_count_t write(const void* ptr, sf_count_t count, void* user);
+    static sf_count_t tell(void* user);
+
+    static SF_VIRTUAL_IO virtualIO;
+
+    std::vector<unsigned char> bytes;
+    sf_count_t position = 0;
+};
+
+#endif /* MEMFILE_H */
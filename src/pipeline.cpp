@@ -0,0 +1,278 @@
+/*
+  ==============================================================================
+
+    pipeline.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "pipeline.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "instrument.h"
+
+/**
+ * @brief Waits until an element can be popped or the pipeline stops.
+ * Spins briefly, then yields, then backs off with short sleeps so stages
+ * waiting on slow storage do not burn a core.
+ * @param ring Ring to pop from.
+ * @param value Receives the element.
+ * @param stop Flag that aborts the wait.
+ * @return bool indicating whether an element was popped.
+ */
+template <typename Ring, typename T>
+static bool waitPop(Ring& ring, T& value, const std::atomic<bool>& stop)
+{
+    for (int spins = 0; !ring.pop(value); spins++) {
+        if (stop.load(std::memory_order_acquire)) {
+            return false;
+        }
+        if (spins < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Stops the thread once its current run has finished.
+ */
+StageThread::~StageThread()
+{
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    changed.notify_all();
+    thread.join();
+}
+
+/**
+ * @brief Runs the body once on the thread, starting the thread if needed.
+ */
+void StageThread::start()
+{
+    if (!thread.joinable()) {
+        thread = std::thread(&StageThread::loop, this);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = true;
+    }
+    changed.notify_all();
+}
+
+/**
+ * @brief Waits until the run begun by start() has finished.
+ */
+void StageThread::join()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return !running; });
+}
+
+void StageThread::loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this]() { return running || quit; });
+        if (quit) {
+            return;
+        }
+        lock.unlock();
+        body();
+        lock.lock();
+        running = false;
+        changed.notify_all();
+    }
+}
+
+/**
+ * @brief Reader stage: fills free input blocks from the source file.
+ * @param reader Source file.
+ * @param blockFrames Frames per block.
+ */
+void Pipeline::readLoop(AudioReader& reader, int blockFrames)
+{
+    InputBlock* block;
+    while (waitPop(freeInput, block, stop)) {
+        {
+            instrument::ScopedTimer timer(instrument::Stage::Read);
+            block->frames = reader.read(block->samples.data(), blockFrames);
+        }
+        block->last = block->frames < blockFrames;
+        framesRead += block->frames;
+
+        // The queues hold every block, so pushing never fails
+        fullInput.push(block);
+        if (block->last) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Writer stage: writes full output blocks to the output file.
+ * @param writer Output file.
+ */
+void Pipeline::writeLoop(AudioWriter& writer)
+{
+    OutputBlock* block;
+    while (waitPop(fullOutput, block, stop)) {
+        bool last = block->last;
+
+        if (block->frames > 0) {
+            sf_count_t written;
+            {
+                instrument::ScopedTimer timer(instrument::Stage::Write);
+                written = writer.write(block->samples.data(), block->frames);
+            }
+            framesWritten += written;
+            if (written < block->frames) {
+                writeFailed = true;
+                stop = true;
+                return;
+            }
+        }
+
+        freeOutput.push(block);
+        if (last) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Converts a whole file through the three stages.
+ * The engine and quantizer must already be set up for the file.
+ * @param reader Source file, read only by the reader thread.
+ * @param writer Output file, written only by the writer thread.
+ * @param engine Resampling engine, used on the calling thread.
+ * @param quantizer Output quantizer, used on the calling thread.
+ * @param channels Number of interleaved source channels.
+ * @param blockFrames Frames per input block.
+ * @param outTotal Number of frames the output should contain.
+ * @param rFrames Receives the number of frames read.
+ * @param wFrames Receives the number of frames written.
+ * @return bool indicating whether the whole output was written.
+ */
+bool Pipeline::run(AudioReader& reader, AudioWriter& writer, ConversionEngine& engine, Quantizer& quantizer,
+                   int channels, int blockFrames, sf_count_t outTotal, sf_count_t& rFrames, sf_count_t& wFrames)
+{
+    this->reader = &reader;
+    this->writer = &writer;
+    this->blockFrames = blockFrames;
+
+    const size_t inSamples = static_cast<size_t>(blockFrames) * channels;
+    const size_t outBytes = static_cast<size_t>(engine.getMaxOutFrames()) * quantizer.getFrameBytes();
+
+    // Blocks are kept between files and only grow
+    for (int i = 0; i < blockCount; i++) {
+        if (inputBlocks[i].samples.size() < inSamples) {
+            inputBlocks[i].samples.resize(inSamples);
+        }
+        if (outputBlocks[i].samples.size() < outBytes) {
+            outputBlocks[i].samples.resize(outBytes);
+        }
+        freeInput.push(&inputBlocks[i]);
+        freeOutput.push(&outputBlocks[i]);
+    }
+    silence.assign(inSamples, 0.0);
+
+    stop = false;
+    writeFailed = false;
+    framesRead = 0;
+    framesWritten = 0;
+
+    readStage.start();
+    writeStage.start();
+
+    sf_count_t produced = 0;
+    bool endOfInput = false;
+    bool sentLast = false;
+
+    while (produced < outTotal) {
+        // Once the source is exhausted keep feeding silence to flush the resamplers
+        InputBlock* in = nullptr;
+        const double* src = silence.data();
+        if (!endOfInput) {
+            if (!waitPop(fullInput, in, stop)) {
+                break;
+            }
+            std::fill(in->samples.begin() + in->frames * channels, in->samples.begin() + inSamples, 0.0);
+            endOfInput = in->last;
+            src = in->samples.data();
+        }
+
+        const double* out;
+        int outFrames;
+        {
+            instrument::ScopedTimer timer(instrument::Stage::Resample);
+            outFrames = engine.process(src, blockFrames, out);
+        }
+
+        sf_count_t toWrite = std::min<sf_count_t>(outFrames, outTotal - produced);
+        if (toWrite > 0) {
+            OutputBlock* block;
+            if (!waitPop(freeOutput, block, stop)) {
+                break;
+            }
+            {
+                instrument::ScopedTimer timer(instrument::Stage::Quantize);
+                quantizer.process(out, block->samples.data(), static_cast<int>(toWrite));
+            }
+            produced += toWrite;
+            block->frames = toWrite;
+            block->last = produced >= outTotal;
+            sentLast = block->last;
+            fullOutput.push(block);
+        }
+
+        // Passthrough output points into the input block, so return it only now
+        if (in) {
+            freeInput.push(in);
+        }
+    }
+
+    // Make sure the writer sees the end even if no frames were left to send
+    if (!sentLast) {
+        OutputBlock* block;
+        if (waitPop(freeOutput, block, stop)) {
+            block->frames = 0;
+            block->last = true;
+            fullOutput.push(block);
+        }
+    }
+
+    writeStage.join();
+
+    // The reader may still be waiting for a free block when the output is complete
+    stop = true;
+    readStage.join();
+
+    // Drain the rings so the next file starts with all blocks free
+    InputBlock* in;
+    while (freeInput.pop(in) || fullInput.pop(in)) {
+    }
+    OutputBlock* out;
+    while (freeOutput.pop(out) || fullOutput.pop(out)) {
+    }
+
+    rFrames = framesRead;
+    wFrames = framesWritten;
+
+    if (writeFailed) {
+        std::cerr << "Error writing the output file." << std::endl;
+        return false;
+    }
+    return wFrames == outTotal;
+}
@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    pipeline.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <sndfile.h>
+#include <thread>
+#include <vector>
+#include "arena.h"
+#include "audioio.h"
+#include "engine.h"
+#include "quantizer.h"
+#include "spscring.h"
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/**
+ * @brief Thread that runs the same stage body once per start().
+ * Kept between files, so a pipeline does not create threads per file.
+ */
+class StageThread
+{
+public:
+    explicit StageThread(std::function<void()> body) : body(std::move(body)) {}
+    ~StageThread();
+
+    void start();
+    void join();
+
+private:
+    void loop();
+
+    std::function<void()> body;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool running = false;
+    bool quit = false;
+};
+
+/**
+ * @brief Three stage reader / DSP / writer conversion of a single file.
+ * The reader and writer run on their own threads while the DSP stage runs
+ * on the caller, so disk reads and writes overlap with resampling. Both
+ * threads are started with the first file and kept for the next ones. Stages
+ * exchange preallocated blocks through lock-free SPSC rings; blocks cycle
+ * back through "free" rings, so nothing is allocated while running.
+ */
+class Pipeline
+{
+public:
+    bool run(AudioReader& reader, AudioWriter& writer, ConversionEngine& engine, Quantizer& quantizer,
+             int channels, int blockFrames, sf_count_t outTotal, sf_count_t& rFrames, sf_count_t& wFrames);
+
+private:
+    // Number of blocks in flight between two stages
+    static const int blockCount = 4;
+
+    struct InputBlock {
+        arena::Vector<double> samples;
+        sf_count_t frames = 0;
+        bool last = false;
+    };
+
+    struct OutputBlock {
+        arena::Vector<unsigned char> samples;
+        sf_count_t frames = 0;
+        bool last = false;
+    };
+
+    using InputRing = SpscRing<InputBlock*, blockCount>;
+    using OutputRing = SpscRing<OutputBlock*, blockCount>;
+
+    void readLoop(AudioReader& reader, int blockFrames);
+    void writeLoop(AudioWriter& writer);
+
+    InputBlock inputBlocks[blockCount];
+    OutputBlock outputBlocks[blockCount];
+    arena::Vector<double> silence;
+
+    InputRing freeInput, fullInput;
+    OutputRing freeOutput, fullOutput;
+
+    std::atomic<bool> stop{false};
+    std::atomic<bool> writeFailed{false};
+    std::atomic<sf_count_t> framesRead{0};
+    std::atomic<sf_count_t> framesWritten{0};
+
+    // Files of the current run, read by the stage threads
+    AudioReader* reader = nullptr;
+    AudioWriter* writer = nullptr;
+    int blockFrames = 0;
+
+    // Last, so the threads are stopped before anything they use goes away
+    StageThread readStage{[this]() { readLoop(*reader, blockFrames); }};
+    StageThread writeStage{[this]() { writeLoop(*writer); }};
+};
+
+#endif /* PIPELINE_H */
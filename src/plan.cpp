@@ -0,0 +1,202 @@
+/*
+  ==============================================================================
+
+    plan.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "plan.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mappedfile.h"
+#include "wavfile.h"
+
+// Enough for the fmt and data chunks of nearly every file. A file with
+// more metadata in front of its samples is probed by libsndfile instead.
+static const size_t probeBytes = 16384;
+
+// Cost of copying a sample relative to converting it. Copies and header
+// rewrites ran about fifty times faster than resampling 44.1 to 48 kHz.
+static const double copyWorkRatio = 0.02;
+
+static const char* actionNames[static_cast<int>(PlanAction::Count)] = {
+    "skip", "copy", "rewrite", "convert"
+};
+
+/**
+ * @brief Gets the name of a plan action, as written to plan files.
+ * @param action Action to name.
+ * @return Name of the action.
+ */
+const char* getPlanActionName(PlanAction action)
+{
+    return actionNames[static_cast<int>(action)];
+}
+
+/**
+ * @brief Reads the format of a source from its header alone.
+ * Uncompressed WAV, RF64 and AIFF headers are parsed from the first few
+ * kilobytes of the file without decoding or mapping anything; other
+ * formats are opened and closed again by libsndfile.
+ * @param path Path of the source.
+ * @param info Receives the frame count, rate, channels and format.
+ * @return bool indicating whether the header could be read.
+ */
+bool probeSource(const std::string& path, SF_INFO& info)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    unsigned char header[probeBytes];
+    struct stat st;
+    const ssize_t got = fstat(fd, &st) == 0 ? pread(fd, header, sizeof(header), 0) : -1;
+    ::close(fd);
+
+    PcmLayout layout;
+    if (got > 0 && parsePcmLayout(header, static_cast<uint64_t>(got), layout, static_cast<uint64_t>(st.st_size))) {
+        getLayoutInfo(layout, info);
+        // RF64 needs its header rewritten rather than copied
+        if (std::memcmp(header, "RF64", 4) == 0) {
+            info.format = (info.format & ~SF_FORMAT_TYPEMASK) | SF_FORMAT_RF64;
+        }
+        return true;
+    }
+
+    info = SF_INFO();
+    SNDFILE* file = sf_open(path.c_str(), SFM_READ, &info);
+    if (!file) {
+        return false;
+    }
+    sf_close(file);
+    return true;
+}
+
+/**
+ * @brief Decides how an output will be produced from a probed source.
+ * Mirrors the checks of tryFastCopy. With trimming on, whether a source
+ * can still be copied is only known once its samples are read, so the
+ * plan counts it as a conversion; normalized outputs are never copied.
+ * @param info Format of the source.
+ * @param settings Settings of the run.
+ * @param profile Profile of the output.
+ * @return PlanAction for the output, never Skip.
+ */
+PlanAction planOutput(const SF_INFO& info, const ConversionSettings& settings, const OutputProfile& profile)
+{
+    if (settings.trim.enabled || settings.normalize.mode != NormalizeMode::None || !canFastCopy(info, profile)) {
+        return PlanAction::Convert;
+    }
+
+    switch (info.format & SF_FORMAT_TYPEMASK) {
+        case SF_FORMAT_WAV:
+            return PlanAction::Copy;
+        case SF_FORMAT_RF64:
+        case SF_FORMAT_W64:
+            return PlanAction::Rewrite;
+        default:
+            return PlanAction::Convert;
+    }
+}
+
+/**
+ * @brief Estimates the cost of producing an output.
+ * @param info Format of the source.
+ * @param action How the output is produced.
+ * @return Work in samples to be converted.
+ */
+double estimateWork(const SF_INFO& info, PlanAction action)
+{
+    const double samples = static_cast<double>(info.frames) * info.channels;
+    switch (action) {
+        case PlanAction::Skip:
+            return 0.0;
+        case PlanAction::Copy:
+        case PlanAction::Rewrite:
+            return samples * copyWorkRatio;
+        default:
+            return samples;
+    }
+}
+
+/**
+ * @brief Formats a duration as hours, minutes and seconds.
+ * @param seconds Duration to format.
+ * @return std::string such as "1:02:03".
+ */
+std::string formatDuration(double seconds)
+{
+    const long long total = seconds > 0.0 ? static_cast<long long>(seconds + 0.5) : 0;
+    char text[32];
+    std::snprintf(text, sizeof(text), "%lld:%02lld:%02lld", total / 3600, total / 60 % 60, total % 60);
+    return text;
+}
+
+/**
+ * @brief Writes one output of a plan as a tab separated line.
+ * Fields are the action, source frames, rate and channels, then the
+ * source and output paths.
+ * @param out Stream to write to.
+ * @param action How the output is produced.
+ * @param info Format of the source, all zero if it could not be probed.
+ * @param source Path of the source.
+ * @param output Path of the output.
+ */
+void writePlanEntry(std::ostream& out, PlanAction action, const SF_INFO& info,
+                    const std::string& source, const std::string& output)
+{
+    out << getPlanActionName(action) << '\t' << info.frames << '\t' << info.samplerate << '\t'
+        << info.channels << '\t' << source << '\t' << output << '\n';
+}
+
+/**
+ * @brief Counts a source of the plan.
+ * @param probed Whether its header could be read.
+ */
+void PlanSummary::addFile(bool probed)
+{
+    files++;
+    if (!probed) {
+        unreadable++;
+    }
+}
+
+/**
+ * @brief Counts an output of the plan and its work.
+ * @param info Format of the source.
+ * @param action How the output is produced.
+ */
+void PlanSummary::addOutput(const SF_INFO& info, PlanAction action)
+{
+    outputs[static_cast<int>(action)]++;
+    work += estimateWork(info, action);
+    if (action == PlanAction::Convert && info.samplerate > 0) {
+        convertFrames += info.frames;
+        convertSeconds += static_cast<double>(info.frames) / info.samplerate;
+    }
+}
+
+/**
+ * @brief Prints the totals of the plan.
+ * @param out Stream to print to.
+ */
+void PlanSummary::print(std::ostream& out) const
+{
+    out << "Plan: " << files << " files";
+    if (unreadable > 0) {
+        out << " (" << unreadable << " with unreadable headers)";
+    }
+    out << std::endl;
+    out << "  convert  " << outputs[static_cast<int>(PlanAction::Convert)] << " outputs, "
+        << convertFrames << " frames, " << formatDuration(convertSeconds) << " of audio" << std::endl;
+    out << "  copy     " << outputs[static_cast<int>(PlanAction::Copy)] << " outputs" << std::endl;
+    out << "  rewrite  " << outputs[static_cast<int>(PlanAction::Rewrite)] << " outputs, header only" << std::endl;
+    out << "  skip     " << outputs[static_cast<int>(PlanAction::Skip)] << " outputs, up to date" << std::endl;
+}
@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    plan.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <cstddef>
+#include <ostream>
+#include <sndfile.h>
+#include <string>
+#include "converter.h"
+
+#ifndef PLAN_H
+#define PLAN_H
+
+/**
+ * @brief What a directory run will do to produce one output.
+ */
+enum class PlanAction {
+    Skip,
+    Copy,
+    Rewrite,
+    Convert,
+    Count
+};
+
+const char* getPlanActionName(PlanAction action);
+bool probeSource(const std::string& path, SF_INFO& info);
+PlanAction planOutput(const SF_INFO& info, const ConversionSettings& settings, const OutputProfile& profile);
+double estimateWork(const SF_INFO& info, PlanAction action);
+std::string formatDuration(double seconds);
+void writePlanEntry(std::ostream& out, PlanAction action, const SF_INFO& info,
+                    const std::string& source, const std::string& output);
+
+/**
+ * @brief Totals of a conversion plan, printed before a directory run starts.
+ * Work is counted in samples (frames times channels) to be resampled, with
+ * copies weighted by how much cheaper they are, so progress and the time
+ * left follow the real cost of each file rather than the file count.
+ */
+class PlanSummary
+{
+public:
+    void addFile(bool probed);
+    void addOutput(const SF_INFO& info, PlanAction action);
+    void print(std::ostream& out) const;
+
+    double getWork() const { return work; }
+
+private:
+    size_t files = 0;
+    size_t unreadable = 0;
+    size_t outputs[static_cast<int>(PlanAction::Count)] = {};
+    sf_count_t convertFrames = 0;
+    double convertSeconds = 0.0;
+    double work = 0.0;
+};
+
+#endif /* PLAN_H */
@@ -0,0 +1,338 @@
+/*
+  ==============================================================================
+
+    profile.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "profile.h"
+#include <cstdio>
+#include <cstdlib>
+
+// Stop-band attenuations of r8brain's CDSPResampler16IR, CDSPResampler16 and CDSPResampler24
+static const double atten16IR = 109.56;
+static const double atten16 = 136.45;
+static const double atten24 = 180.15;
+
+/**
+ * @brief A named output profile for a device in everyday use.
+ */
+struct Preset {
+    const char* name;
+    const char* description;
+    OutputProfile profile;
+};
+
+static const Preset presets[] = {
+    { "sp404", "48 kHz 16 bit WAV, source channels (the default)",
+      { 48000, 0, SampleFormat::PCM16, Container::WAV, { 2.0, atten16 } } },
+    { "cd", "44.1 kHz 16 bit stereo WAV",
+      { 44100, 2, SampleFormat::PCM16, Container::WAV, { 2.0, atten16 } } },
+    { "mono44", "44.1 kHz 16 bit mono WAV",
+      { 44100, 1, SampleFormat::PCM16, Container::WAV, { 2.0, atten16 } } },
+    { "hires", "48 kHz 24 bit WAV, source channels, 24 bit resampler",
+      { 48000, 0, SampleFormat::PCM24, Container::WAV, { 2.0, atten24 } } },
+    { "sp1200", "26.04 kHz 12-in-16 bit mono WAV",
+      { 26040, 1, SampleFormat::PCM12, Container::WAV, { 2.0, atten16 } } },
+    { "s950", "40 kHz 12-in-16 bit mono WAV",
+      { 40000, 1, SampleFormat::PCM12, Container::WAV, { 2.0, atten16 } } },
+    { "aiff", "44.1 kHz 16 bit stereo AIFF",
+      { 44100, 2, SampleFormat::PCM16, Container::AIFF, { 2.0, atten16 } } },
+    { "ulaw", "8 kHz 8 bit mu-law mono WAV",
+      { 8000, 1, SampleFormat::ULaw, Container::WAV, { 2.0, atten16 } } },
+};
+
+/**
+ * @brief Parses an output sample format name given on the command line.
+ * @param name Name of the format.
+ * @param format Receives the format.
+ * @return bool indicating whether the name was recognised.
+ */
+bool parseSampleFormat(const std::string& name, SampleFormat& format)
+{
+    if (name == "pcm16" || name == "16") {
+        format = SampleFormat::PCM16;
+    } else if (name == "pcm24" || name == "24") {
+        format = SampleFormat::PCM24;
+    } else if (name == "pcm12" || name == "12") {
+        format = SampleFormat::PCM12;
+    } else if (name == "ulaw") {
+        format = SampleFormat::ULaw;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses an output container name given on the command line.
+ * @param name Name of the container.
+ * @param container Receives the container.
+ * @return bool indicating whether the name was recognised.
+ */
+bool parseContainer(const std::string& name, Container& container)
+{
+    if (name == "wav") {
+        container = Container::WAV;
+    } else if (name == "aiff" || name == "aif") {
+        container = Container::AIFF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief A named resampler quality tier.
+ */
+struct QualityTier {
+    const char* name;
+    const char* description;
+    ResamplerSpec spec;
+};
+
+// Costs are resampling CPU time relative to standard, measured on x86-64
+// at 22.05-96 kHz to 44.1/48 kHz; delay is the resampler's priming
+static const QualityTier qualityTiers[] = {
+    { "draft", "10% band, 109 dB: ~0.85x the CPU of standard, 1/8 of its delay",
+      { 10.0, atten16IR, false } },
+    { "standard", "CDSPResampler16, 2% band, 136 dB: 1x (the default)",
+      { 2.0, atten16, false } },
+    { "high", "CDSPResampler24, 2% band, 180 dB: ~1.2-1.4x",
+      { 2.0, atten24, false } },
+    { "minphase", "standard made minimum-phase, no pre-ringing on transients: ~1-1.2x",
+      { 2.0, atten16, true } },
+};
+
+/**
+ * @brief Parses a resampler quality given on the command line.
+ * A tier name selects the whole filter spec. 16 and 24 only select the
+ * stop-band attenuation of CDSPResampler16 and CDSPResampler24 and leave
+ * the transition band and phase as they are.
+ * @param name Name of the quality.
+ * @param spec Receives the filter spec.
+ * @return bool indicating whether the name was recognised.
+ */
+bool parseResamplerQuality(const std::string& name, ResamplerSpec& spec)
+{
+    if (name == "16") {
+        spec.atten = atten16;
+        return true;
+    }
+    if (name == "24") {
+        spec.atten = atten24;
+        return true;
+    }
+
+    for (const QualityTier& tier : qualityTiers) {
+        if (name == tier.name) {
+            spec = tier.spec;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Prints the name and description of every resampler quality tier.
+ * @param out Stream to print to.
+ */
+void listQualities(std::ostream& out)
+{
+    for (const QualityTier& tier : qualityTiers) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "  %-8s %s", tier.name, tier.description);
+        out << line << std::endl;
+    }
+}
+
+const char* getSampleFormatName(SampleFormat format)
+{
+    switch (format) {
+        case SampleFormat::PCM24: return "pcm24";
+        case SampleFormat::PCM12: return "pcm12";
+        case SampleFormat::ULaw: return "ulaw";
+        default: return "pcm16";
+    }
+}
+
+const char* getContainerName(Container container)
+{
+    return container == Container::AIFF ? "aiff" : "wav";
+}
+
+/**
+ * @brief Gets the file extension outputs in a container are given.
+ * @param container Container of the output.
+ * @return Extension including the dot.
+ */
+const char* getContainerExtension(Container container)
+{
+    return container == Container::AIFF ? ".aif" : ".wav";
+}
+
+/**
+ * @brief Gets the number of bytes each stored sample takes.
+ * @param format Encoding of the samples.
+ * @return Number of bytes per sample.
+ */
+int getSampleBytes(SampleFormat format)
+{
+    switch (format) {
+        case SampleFormat::PCM24: return 3;
+        case SampleFormat::ULaw: return 1;
+        default: return 2;
+    }
+}
+
+/**
+ * @brief Describes a profile in a compact, stable form.
+ * Outputs written with equal descriptions are interchangeable.
+ * @param profile Profile to describe.
+ * @return std::string such as "wav-pcm16@48000/src/tb2-136.45".
+ */
+std::string describeProfile(const OutputProfile& profile)
+{
+    char resampler[64];
+    std::snprintf(resampler, sizeof(resampler), "tb%g-%g%s", profile.resampler.transBand, profile.resampler.atten,
+                  profile.resampler.minPhase ? "-min" : "");
+
+    return std::string(getContainerName(profile.container)) + "-" + getSampleFormatName(profile.format) + "@" +
+           std::to_string(profile.sampleRate) + "/" +
+           (profile.channels > 0 ? "ch" + std::to_string(profile.channels) : std::string("src")) + "/" + resampler;
+}
+
+/**
+ * @brief Looks up a named device preset.
+ * @param name Name of the preset.
+ * @param profile Receives the preset's profile.
+ * @return bool indicating whether the preset exists.
+ */
+bool findPreset(const std::string& name, OutputProfile& profile)
+{
+    for (const Preset& preset : presets) {
+        if (name == preset.name) {
+            profile = preset.profile;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Prints the name and description of every preset.
+ * @param out Stream to print to.
+ */
+void listPresets(std::ostream& out)
+{
+    for (const Preset& preset : presets) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "  %-8s %s", preset.name, preset.description);
+        out << line << std::endl;
+    }
+}
+
+/**
+ * @brief Applies one named profile setting, as given on the command line or in a job.
+ * "preset" replaces the whole profile, so it should come before the others.
+ * @param name One of preset, rate, channels, format, container, quality or transband.
+ * @param value Value of the setting.
+ * @param profile Profile to change.
+ * @param error Receives the reason the setting was rejected.
+ * @return bool indicating whether the setting was applied.
+ */
+bool applyProfileOption(const std::string& name, const std::string& value, OutputProfile& profile, std::string& error)
+{
+    if (name == "preset") {
+        if (!findPreset(value, profile)) {
+            error = "Unknown preset: " + value;
+            return false;
+        }
+    } else if (name == "rate") {
+        profile.sampleRate = std::atoi(value.c_str());
+        if (profile.sampleRate <= 0) {
+            error = "Invalid target sample rate: " + value;
+            return false;
+        }
+    } else if (name == "channels") {
+        profile.channels = std::atoi(value.c_str());
+        if (profile.channels < 0 || profile.channels > 64 || (profile.channels == 0 && value != "0")) {
+            error = "Invalid channel count: " + value;
+            return false;
+        }
+    } else if (name == "format") {
+        if (!parseSampleFormat(value, profile.format)) {
+            error = "Unknown sample format: " + value;
+            return false;
+        }
+    } else if (name == "container") {
+        if (!parseContainer(value, profile.container)) {
+            error = "Unknown container: " + value;
+            return false;
+        }
+    } else if (name == "quality") {
+        if (!parseResamplerQuality(value, profile.resampler)) {
+            error = "Unknown resampler quality: " + value;
+            return false;
+        }
+    } else if (name == "transband") {
+        profile.resampler.transBand = std::atof(value.c_str());
+        if (!(profile.resampler.transBand >= 0.5 && profile.resampler.transBand <= 45.0)) {
+            error = "Transition band must be between 0.5 and 45 percent: " + value;
+            return false;
+        }
+    } else {
+        error = "Unknown profile setting: " + name;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses a fan-out target such as "cd" or "mono:rate=44100,channels=1".
+ * The label names the target. A label that is a preset name starts from
+ * that preset, any other label from the base profile; the settings after
+ * the colon then adjust it like applyProfileOption.
+ * @param spec Target as given on the command line.
+ * @param base Profile targets without a preset start from.
+ * @param target Receives the target.
+ * @param error Receives the reason the target was rejected.
+ * @return bool indicating whether the target is valid.
+ */
+bool parseTarget(const std::string& spec, const OutputProfile& base, OutputTarget& target, std::string& error)
+{
+    const size_t colon = spec.find(':');
+    target.label = spec.substr(0, colon);
+    if (target.label.empty() || target.label.find_first_of("/\\") != std::string::npos ||
+        target.label == "." || target.label == "..") {
+        error = "Invalid target name: " + spec;
+        return false;
+    }
+
+    if (!findPreset(target.label, target.profile)) {
+        target.profile = base;
+    }
+
+    size_t pos = colon == std::string::npos ? spec.size() : colon + 1;
+    while (pos < spec.size()) {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+
+        const std::string setting = spec.substr(pos, end - pos);
+        const size_t equals = setting.find('=');
+        if (equals == std::string::npos) {
+            error = "Expected name=value in target " + target.label + ": " + setting;
+            return false;
+        }
+        if (!applyProfileOption(setting.substr(0, equals), setting.substr(equals + 1), target.profile, error)) {
+            return false;
+        }
+        pos = end + 1;
+    }
+    return true;
+}
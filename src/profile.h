@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    profile.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <iostream>
+#include <string>
+#include "resamplerpool.h"
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/**
+ * @brief Encoding of the output samples.
+ */
+enum class SampleFormat {
+    PCM16,
+    PCM24,
+    // 12 bit samples stored left-justified in 16 bit words, as SP-1200/S950 era samplers expect
+    PCM12,
+    ULaw
+};
+
+/**
+ * @brief File format the output is written in.
+ */
+enum class Container {
+    WAV,
+    AIFF
+};
+
+/**
+ * @brief Everything that describes the files a conversion produces.
+ */
+struct OutputProfile {
+    int sampleRate = 48000;
+    // Number of output channels, 0 keeps the channel count of the source
+    int channels = 0;
+    SampleFormat format = SampleFormat::PCM16;
+    Container container = Container::WAV;
+    ResamplerSpec resampler;
+};
+
+/**
+ * @brief One of several outputs produced from each source in fan-out mode.
+ */
+struct OutputTarget {
+    // Names the target's output directory or file suffix
+    std::string label;
+    OutputProfile profile;
+};
+
+bool parseSampleFormat(const std::string& name, SampleFormat& format);
+bool parseContainer(const std::string& name, Container& container);
+bool parseResamplerQuality(const std::string& name, ResamplerSpec& spec);
+const char* getSampleFormatName(SampleFormat format);
+const char* getContainerName(Container container);
+const char* getContainerExtension(Container container);
+int getSampleBytes(SampleFormat format);
+std::string describeProfile(const OutputProfile& profile);
+
+bool applyProfileOption(const std::string& name, const std::string& value, OutputProfile& profile, std::string& error);
+bool parseTarget(const std::string& spec, const OutputProfile& base, OutputTarget& target, std::string& error);
+bool findPreset(const std::string& name, OutputProfile& profile);
+void listPresets(std::ostream& out);
+void listQualities(std::ostream& out);
+
+#endif /* PROFILE_H */
@@ -0,0 +1,355 @@
+/*
+  ==============================================================================
+
+    quantizer.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "quantizer.h"
+#include <algorithm>
+#include <cmath>
+#include "includes/r8brain/r8bbase.h"
+
+/**
+ * @brief Integer PCM stored in whole bytes.
+ * Samples are scaled like libsndfile's own writer (full scale is 2^(Bits-1) - 1)
+ * and stored left-justified when Bits is less than the stored width.
+ */
+template <int Bits, int Bytes, bool BigEndian>
+struct PcmFormat {
+    static constexpr double scale = static_cast<double>((1 << (Bits - 1)) - 1);
+    static constexpr double minValue = -static_cast<double>(1 << (Bits - 1));
+    static constexpr double maxValue = scale;
+    static const int bytes = Bytes;
+
+    static void store(int value, unsigned char* out)
+    {
+        const uint32_t word = static_cast<uint32_t>(value) << (Bytes * 8 - Bits);
+        for (int b = 0; b < Bytes; b++) {
+            out[BigEndian ? b : Bytes - 1 - b] = static_cast<unsigned char>(word >> ((Bytes - 1 - b) * 8));
+        }
+    }
+};
+
+/**
+ * @brief G.711 mu-law, encoded from 16 bit samples.
+ */
+struct ULawFormat {
+    static constexpr double scale = 32767.0;
+    static constexpr double minValue = -32768.0;
+    static constexpr double maxValue = 32767.0;
+    static const int bytes = 1;
+
+    static void store(int value, unsigned char* out)
+    {
+        const int sign = value < 0 ? 0x80 : 0;
+        int magnitude = std::min(value < 0 ? -value : value, 32635) + 0x84;
+
+        int exponent = 7;
+        for (int mask = 0x4000; (magnitude & mask) == 0 && exponent > 0; mask >>= 1) {
+            exponent--;
+        }
+        const int mantissa = (magnitude >> (exponent + 3)) & 0x0F;
+        *out = static_cast<unsigned char>(~(sign | (exponent << 4) | mantissa));
+    }
+};
+
+using Pcm16LE = PcmFormat<16, 2, false>;
+using Pcm16BE = PcmFormat<16, 2, true>;
+using Pcm24LE = PcmFormat<24, 3, false>;
+using Pcm24BE = PcmFormat<24, 3, true>;
+using Pcm12LE = PcmFormat<12, 2, false>;
+using Pcm12BE = PcmFormat<12, 2, true>;
+
+// Noise shaping error feedback coefficients
+static const double firstOrderTaps[] = { 1.0 };
+static const double fWeightedTaps[] = { 1.623, -0.982, 0.109 };
+static const double eWeightedTaps[] = { 2.033, -2.165, 1.959, -1.590, 0.6149 };
+
+// Largest error fed back, keeps the shaping loop stable when clipping
+static const double maxError = 4.0;
+
+/**
+ * @brief Parses a dither mode name given on the command line.
+ * @param name Name of the mode.
+ * @param mode Receives the mode.
+ * @return bool indicating whether the name was recognised.
+ */
+bool parseDitherMode(const std::string& name, DitherMode& mode)
+{
+    if (name == "none") {
+        mode = DitherMode::None;
+    } else if (name == "tpdf") {
+        mode = DitherMode::TPDF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses a noise shaping filter name given on the command line.
+ * @param name Name of the filter.
+ * @param shape Receives the filter.
+ * @return bool indicating whether the name was recognised.
+ */
+bool parseNoiseShape(const std::string& name, NoiseShape& shape)
+{
+    if (name == "none") {
+        shape = NoiseShape::None;
+    } else if (name == "first") {
+        shape = NoiseShape::FirstOrder;
+    } else if (name == "fweighted") {
+        shape = NoiseShape::FWeighted;
+    } else if (name == "eweighted") {
+        shape = NoiseShape::EWeighted;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* getDitherModeName(DitherMode mode)
+{
+    return mode == DitherMode::TPDF ? "tpdf" : "none";
+}
+
+const char* getNoiseShapeName(NoiseShape shape)
+{
+    switch (shape) {
+        case NoiseShape::FirstOrder: return "first";
+        case NoiseShape::FWeighted: return "fweighted";
+        case NoiseShape::EWeighted: return "eweighted";
+        default: return "none";
+    }
+}
+
+/**
+ * @brief Rounds scaled, dithered samples and stores them.
+ * Computes sat(round(in[i] * scale * gain + dither[i])) for the output format.
+ * @param in Normalized input samples.
+ * @param out Encoded output samples.
+ * @param count Number of samples.
+ */
+template <typename Format>
+void Quantizer::quantizePlain(const double* in, unsigned char* out, int count)
+{
+    const double* add = ditherBlock.data();
+    const double scale = Format::scale * gain;
+    for (int i = 0; i < count; i++) {
+        double v = std::nearbyint(in[i] * scale + add[i]);
+        v = std::min(Format::maxValue, std::max(Format::minValue, v));
+        Format::store(static_cast<int>(v), out + static_cast<size_t>(i) * Format::bytes);
+    }
+}
+
+/**
+ * @brief 16 bit little-endian output, the default, on SSE2/NEON.
+ * The SIMD targets are little-endian, so the packed words are stored as is.
+ */
+template <>
+void Quantizer::quantizePlain<Pcm16LE>(const double* in, unsigned char* bytes, int count)
+{
+    const double* add = ditherBlock.data();
+    short* out = reinterpret_cast<short*>(bytes);
+    const double gainScale = Pcm16LE::scale * gain;
+    int i = 0;
+
+#if defined(R8B_SSE2)
+    const __m128d scale = _mm_set1_pd(gainScale);
+    const __m128d lower = _mm_set1_pd(-32768.0);
+    const __m128d upper = _mm_set1_pd(32767.0);
+
+    // Clamping first keeps _mm_cvtpd_epi32 inside the int32 range
+    auto convert = [&](int offset) {
+        __m128d v = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(in + offset), scale), _mm_loadu_pd(add + offset));
+        return _mm_cvtpd_epi32(_mm_min_pd(_mm_max_pd(v, lower), upper));
+    };
+
+    for (; i + 8 <= count; i += 8) {
+        // _mm_cvtpd_epi32 rounds to nearest even, _mm_packs_epi32 saturates
+        __m128i a = convert(i);
+        __m128i b = convert(i + 2);
+        __m128i c = convert(i + 4);
+        __m128i d = convert(i + 6);
+        __m128i lo = _mm_unpacklo_epi64(a, b);
+        __m128i hi = _mm_unpacklo_epi64(c, d);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(lo, hi));
+    }
+#elif defined(R8B_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const float64x2_t scale = vdupq_n_f64(gainScale);
+    for (; i + 4 <= count; i += 4) {
+        // vcvtnq rounds to nearest even, vqmovn saturates while narrowing.
+        // Multiply and add stay separate, as in the scalar tail, so a sample
+        // rounds the same wherever a block boundary falls
+        int64x2_t a = vcvtnq_s64_f64(vaddq_f64(vmulq_f64(vld1q_f64(in + i), scale), vld1q_f64(add + i)));
+        int64x2_t b = vcvtnq_s64_f64(vaddq_f64(vmulq_f64(vld1q_f64(in + i + 2), scale), vld1q_f64(add + i + 2)));
+        int32x4_t ab = vcombine_s32(vqmovn_s64(a), vqmovn_s64(b));
+        vst1_s16(out + i, vqmovn_s32(ab));
+    }
+#endif
+
+    for (; i < count; i++) {
+        double v = std::nearbyint(in[i] * gainScale + add[i]);
+        v = std::min(32767.0, std::max(-32768.0, v));
+        Pcm16LE::store(static_cast<int>(v), bytes + static_cast<size_t>(i) * 2);
+    }
+}
+
+/**
+ * @brief Quantizes with error feedback noise shaping.
+ * Each channel's error is fed back, so samples are done one at a time.
+ * @param in Normalized input samples.
+ * @param out Encoded output samples.
+ * @param count Number of samples.
+ */
+template <typename Format>
+void Quantizer::quantizeShaped(const double* in, unsigned char* out, int count)
+{
+    const double scale = Format::scale * gain;
+    for (int i = 0; i < count; i++) {
+        double* err = &errors[static_cast<size_t>(i % channels) * maxTaps];
+
+        double shaped = in[i] * scale;
+        for (int k = 0; k < tapCount; k++) {
+            shaped -= taps[k] * err[k];
+        }
+
+        double q = std::nearbyint(shaped + ditherBlock[i]);
+        q = std::min(Format::maxValue, std::max(Format::minValue, q));
+        Format::store(static_cast<int>(q), out + static_cast<size_t>(i) * Format::bytes);
+
+        for (int k = maxTaps - 1; k > 0; k--) {
+            err[k] = err[k - 1];
+        }
+        err[0] = std::min(maxError, std::max(-maxError, q - shaped));
+    }
+}
+
+/**
+ * @brief Points the kernel at the instantiation for an output format.
+ * Noise shaping needs the per-sample feedback loop, everything else the
+ * plain kernel.
+ */
+template <typename Format>
+void Quantizer::selectKernel()
+{
+    kernel = tapCount > 0 ? &Quantizer::quantizeShaped<Format> : &Quantizer::quantizePlain<Format>;
+}
+
+/**
+ * @brief Prepares the quantizer for a new stream.
+ * Clears the noise shaping history, reseeds the random generator and
+ * picks the kernel for the output format.
+ * @param channels Number of interleaved channels.
+ * @param format Encoding of the output samples.
+ * @param bigEndian Stores multi-byte samples most significant byte first.
+ * @param dither Dither to add before rounding.
+ * @param shape Noise shaping filter to apply.
+ */
+void Quantizer::setup(int channels, SampleFormat format, bool bigEndian, DitherMode dither, NoiseShape shape)
+{
+    this->channels = channels;
+    this->dither = dither;
+    this->shape = shape;
+    frameBytes = channels * getSampleBytes(format);
+    rngState = 0x9E3779B97F4A7C15ull;
+    gain = 1.0;
+
+    switch (shape) {
+        case NoiseShape::FirstOrder:
+            taps = firstOrderTaps;
+            tapCount = 1;
+            break;
+        case NoiseShape::FWeighted:
+            taps = fWeightedTaps;
+            tapCount = 3;
+            break;
+        case NoiseShape::EWeighted:
+            taps = eWeightedTaps;
+            tapCount = 5;
+            break;
+        default:
+            taps = nullptr;
+            tapCount = 0;
+            break;
+    }
+
+    switch (format) {
+        case SampleFormat::PCM24:
+            bigEndian ? selectKernel<Pcm24BE>() : selectKernel<Pcm24LE>();
+            break;
+        case SampleFormat::PCM12:
+            bigEndian ? selectKernel<Pcm12BE>() : selectKernel<Pcm12LE>();
+            break;
+        case SampleFormat::ULaw:
+            selectKernel<ULawFormat>();
+            break;
+        default:
+            bigEndian ? selectKernel<Pcm16BE>() : selectKernel<Pcm16LE>();
+            break;
+    }
+
+    errors.assign(static_cast<size_t>(channels) * maxTaps, 0.0);
+}
+
+/**
+ * @brief Sizes the scratch for blocks of up to maxFrames frames.
+ * process() then never allocates, which realtime callers rely on.
+ * @param maxFrames Largest number of frames passed to process().
+ */
+void Quantizer::reserve(int maxFrames)
+{
+    ditherBlock.reserve(static_cast<size_t>(maxFrames) * channels);
+}
+
+/**
+ * @brief Advances the xorshift64* generator.
+ * @return 64 random bits.
+ */
+uint64_t Quantizer::nextRandom()
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 0x2545F4914F6CDD1Dull;
+}
+
+/**
+ * @brief Fills the dither buffer with TPDF noise of +-1 LSB.
+ * Each random word provides both uniform variables of a sample.
+ * @param count Number of dither values to generate.
+ */
+void Quantizer::fillDither(int count)
+{
+    ditherBlock.resize(count);
+
+    if (dither == DitherMode::None) {
+        std::fill(ditherBlock.begin(), ditherBlock.end(), 0.0);
+        return;
+    }
+
+    const double scale = 1.0 / 4294967296.0;
+    for (int i = 0; i < count; i++) {
+        uint64_t r = nextRandom();
+        double a = static_cast<double>(r & 0xFFFFFFFFu) * scale;
+        double b = static_cast<double>(r >> 32) * scale;
+        ditherBlock[i] = a - b;
+    }
+}
+
+/**
+ * @brief Quantizes a block of interleaved frames.
+ * @param in Interleaved normalized input frames.
+ * @param out Receives frames * getFrameBytes() bytes of encoded output.
+ * @param frames Number of frames to convert.
+ */
+void Quantizer::process(const double* in, unsigned char* out, int frames)
+{
+    const int count = frames * channels;
+    fillDither(count);
+    (this->*kernel)(in, out, count);
+}
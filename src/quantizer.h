@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    quantizer.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "profile.h"
+
+#ifndef QUANTIZER_H
+#define QUANTIZER_H
+
+/**
+ * @brief Dither added before rounding to the output bit depth.
+ */
+enum class DitherMode {
+    None,
+    TPDF
+};
+
+/**
+ * @brief Error feedback filters used to shape the quantization noise.
+ */
+enum class NoiseShape {
+    None,
+    FirstOrder,
+    FWeighted,
+    EWeighted
+};
+
+bool parseDitherMode(const std::string& name, DitherMode& mode);
+bool parseNoiseShape(const std::string& name, NoiseShape& shape);
+const char* getDitherModeName(DitherMode mode);
+const char* getNoiseShapeName(NoiseShape shape);
+
+/**
+ * @brief Converts normalized double samples to encoded output samples.
+ * Applies optional TPDF dither and noise shaping at the LSB of the output
+ * format, saturating instead of wrapping, and stores the samples in the
+ * byte layout of the output file. setup() picks a kernel specialized for
+ * the sample format and byte order, so the per-sample loop never branches
+ * on format; plain 16 bit little-endian output without noise shaping runs
+ * on an SSE2/NEON kernel. Each Quantizer owns its own random generator, so
+ * one per worker thread needs no locking, and it is reseeded by setup() so
+ * a given file always quantizes the same way. A normalization gain is
+ * folded into the scale factor, so it costs nothing on top of quantizing.
+ */
+class Quantizer
+{
+public:
+    void setup(int channels, SampleFormat format, bool bigEndian, DitherMode dither, NoiseShape shape);
+    void process(const double* in, unsigned char* out, int frames);
+    void reserve(int maxFrames);
+    void setGain(double newGain) { gain = newGain; }
+
+    int getFrameBytes() const { return frameBytes; }
+
+private:
+    // Maximum number of taps of the noise shaping filters
+    static const int maxTaps = 5;
+
+    uint64_t nextRandom();
+    void fillDither(int count);
+
+    template <typename Format> void selectKernel();
+    template <typename Format> void quantizePlain(const double* in, unsigned char* out, int count);
+    template <typename Format> void quantizeShaped(const double* in, unsigned char* out, int count);
+
+    int channels = 0;
+    int frameBytes = 0;
+    DitherMode dither = DitherMode::None;
+    NoiseShape shape = NoiseShape::None;
+    uint64_t rngState = 0;
+    // Applied with the scaling to the output format, reset to unity by setup()
+    double gain = 1.0;
+
+    const double* taps = nullptr;
+    int tapCount = 0;
+
+    // Format specialized conversion of a block, chosen by setup()
+    void (Quantizer::*kernel)(const double* in, unsigned char* out, int count) = nullptr;
+
+    // Past quantization errors per channel, most recent first
+    arena::Vector<double> errors;
+    arena::Vector<double> ditherBlock;
+};
+
+#endif /* QUANTIZER_H */
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    resamplerpool.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "resamplerpool.h"
+
+/**
+ * @brief Hands out a resampler for the given conversion.
+ * Reuses an idle resampler when one was released with the same key,
+ * otherwise builds a new one.
+ * @param srcRate Sample rate of the source.
+ * @param dstRate Sample rate of the output.
+ * @param maxInLen Largest number of samples passed to a single process call.
+ * @param spec Filter parameters of the resampler.
+ * @return A resampler in its freshly constructed state.
+ */
+std::unique_ptr<r8b::CDSPResampler> ResamplerPool::acquire(int srcRate, int dstRate, int maxInLen,
+                                                           const ResamplerSpec& spec)
+{
+    auto it = idle.find(Key(srcRate, dstRate, maxInLen, spec.transBand, spec.atten, spec.minPhase));
+    if (it != idle.end() && !it->second.empty()) {
+        std::unique_ptr<r8b::CDSPResampler> resampler = std::move(it->second.back());
+        it->second.pop_back();
+        return resampler;
+    }
+
+    return std::unique_ptr<r8b::CDSPResampler>(new r8b::CDSPResampler(
+        srcRate, dstRate, maxInLen, spec.transBand, spec.atten,
+        spec.minPhase ? r8b::fprMinPhase : r8b::fprLinearPhase));
+}
+
+/**
+ * @brief Returns a resampler to the pool.
+ * The resampler is cleared so the next user starts from silence.
+ * @param srcRate Sample rate of the source the resampler was built for.
+ * @param dstRate Sample rate of the output the resampler was built for.
+ * @param maxInLen Max input length the resampler was built for.
+ * @param resampler The resampler being released.
+ * @param spec Filter parameters the resampler was built with.
+ */
+void ResamplerPool::release(int srcRate, int dstRate, int maxInLen, std::unique_ptr<r8b::CDSPResampler> resampler,
+                            const ResamplerSpec& spec)
+{
+    std::vector<std::unique_ptr<r8b::CDSPResampler>>& slot =
+        idle[Key(srcRate, dstRate, maxInLen, spec.transBand, spec.atten, spec.minPhase)];
+    if (slot.size() >= maxIdlePerKey) {
+        return;
+    }
+
+    resampler->clear();
+    slot.push_back(std::move(resampler));
+}
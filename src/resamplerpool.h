@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    resamplerpool.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+#include "includes/r8brain/CDSPResampler.h"
+
+#ifndef RESAMPLERPOOL_H
+#define RESAMPLERPOOL_H
+
+/**
+ * @brief Filter parameters a resampler is designed with.
+ * The defaults match r8brain's CDSPResampler16.
+ */
+struct ResamplerSpec {
+    // Transition band in percent of the spectral space of the lower rate
+    double transBand = 2.0;
+    // Stop-band attenuation in decibel
+    double atten = 136.45;
+    // Minimum-phase filters: no pre-ringing and far less delay, but not linear-phase
+    bool minPhase = false;
+
+    bool operator==(const ResamplerSpec& other) const
+    {
+        return transBand == other.transBand && atten == other.atten && minPhase == other.minPhase;
+    }
+};
+
+/**
+ * @brief Pool of fully built r8brain resamplers.
+ * Building a resampler designs its step chain and allocates its buffers,
+ * which for short one-shots costs more than the conversion itself. Released
+ * resamplers are kept per (source rate, target rate, max input length) and
+ * handed out again after a clear(); resamplers with different filter
+ * specs are kept apart. A pool is not thread safe; each worker
+ * owns its own.
+ */
+class ResamplerPool
+{
+public:
+    std::unique_ptr<r8b::CDSPResampler> acquire(int srcRate, int dstRate, int maxInLen,
+                                                const ResamplerSpec& spec = ResamplerSpec());
+    void release(int srcRate, int dstRate, int maxInLen, std::unique_ptr<r8b::CDSPResampler> resampler,
+                 const ResamplerSpec& spec = ResamplerSpec());
+
+private:
+    // Maximum number of idle resamplers kept for a single key
+    static const size_t maxIdlePerKey = 32;
+
+    using Key = std::tuple<int, int, int, double, double, bool>;
+    std::map<Key, std::vector<std::unique_ptr<r8b::CDSPResampler>>> idle;
+};
+
+#endif /* RESAMPLERPOOL_H */
@@ -0,0 +1,284 @@
+/*
+  ==============================================================================
+
+    scheduler.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "scheduler.h"
+#include <algorithm>
+#include <chrono>
+#include "topology.h"
+
+// Scheduler and index of the worker running on this thread, if any
+thread_local const TaskScheduler* currentScheduler = nullptr;
+thread_local int currentWorkerIndex = -1;
+
+/**
+ * @brief Starts the worker threads.
+ * Pinned workers are dealt out to the nodes in turn, and within a node to
+ * its CPUs in turn, so any thread count spreads evenly over the sockets.
+ * @param threadCount Number of workers, at least one is started.
+ * @param pin Whether to pin each worker to a CPU.
+ */
+TaskScheduler::TaskScheduler(unsigned int threadCount, bool pin)
+{
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+
+    std::vector<topology::Node> nodes;
+    if (pin) {
+        nodes = topology::readNodes();
+        nodeCount = static_cast<unsigned int>(nodes.size());
+    }
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers.emplace_back(new Worker());
+        if (pin && !nodes[i % nodeCount].cpus.empty()) {
+            const std::vector<int>& cpus = nodes[i % nodeCount].cpus;
+            workers[i]->node = static_cast<int>(i % nodeCount);
+            workers[i]->cpu = cpus[(i / nodeCount) % cpus.size()];
+        }
+    }
+
+    // Round-robin from the thief as before, taking its own node's workers first
+    for (unsigned int i = 0; i < threadCount; i++) {
+        std::vector<unsigned int>& victims = workers[i]->victims;
+        for (int sameNode = 1; sameNode >= 0; sameNode--) {
+            for (unsigned int j = 1; j < threadCount; j++) {
+                const unsigned int victim = (i + j) % threadCount;
+                if ((workers[victim]->node == workers[i]->node) == (sameNode == 1)) {
+                    victims.push_back(victim);
+                }
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        threads.emplace_back(&TaskScheduler::workerLoop, this, i);
+    }
+}
+
+/**
+ * @brief Stops the workers once the queued tasks have run.
+ */
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+/**
+ * @brief Gets the index of the worker the caller runs on.
+ * @return The worker index, or -1 when called from outside this pool.
+ */
+int TaskScheduler::getCurrentWorker() const
+{
+    return currentScheduler == this ? currentWorkerIndex : -1;
+}
+
+/**
+ * @brief Appends a task, growing the ring when it is full.
+ * @param entry Task to append.
+ */
+void TaskScheduler::TaskQueue::pushBack(Entry&& entry)
+{
+    if (count == slots.size()) {
+        std::vector<Entry> grown(std::max<size_t>(16, slots.size() * 2));
+        for (size_t i = 0; i < count; i++) {
+            grown[i] = std::move(slots[(head + i) % slots.size()]);
+        }
+        slots.swap(grown);
+        head = 0;
+    }
+    slots[(head + count) % slots.size()] = std::move(entry);
+    count++;
+}
+
+void TaskScheduler::TaskQueue::popBack(Entry& entry)
+{
+    count--;
+    entry = std::move(slots[(head + count) % slots.size()]);
+}
+
+void TaskScheduler::TaskQueue::popFront(Entry& entry)
+{
+    entry = std::move(slots[head]);
+    head = (head + 1) % slots.size();
+    count--;
+}
+
+/**
+ * @brief Queues a task.
+ * @param task Task to run on one of the workers.
+ * @param group Group to report the task's completion to, if any.
+ */
+void TaskScheduler::submit(Task task, TaskGroup* group)
+{
+    Entry entry;
+    entry.task = std::move(task);
+    entry.group = group;
+
+    int worker = getCurrentWorker();
+    if (worker >= 0) {
+        std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+        workers[worker]->tasks.pushBack(std::move(entry));
+    } else {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        injected.pushBack(std::move(entry));
+    }
+
+    queued++;
+    wake.notify_one();
+}
+
+/**
+ * @brief Runs a dequeued task and reports it to its group.
+ * @param entry Task to run.
+ */
+void TaskScheduler::runEntry(Entry& entry)
+{
+    queued--;
+    entry.task();
+    if (entry.group) {
+        entry.group->finishOne();
+    }
+}
+
+bool TaskScheduler::popLocal(unsigned int index, Entry& entry)
+{
+    Worker& worker = *workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    worker.tasks.popBack(entry);
+    return true;
+}
+
+bool TaskScheduler::steal(unsigned int thief, Entry& entry)
+{
+    for (unsigned int index : workers[thief]->victims) {
+        Worker& victim = *workers[index];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            victim.tasks.popFront(entry);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskScheduler::popInjected(Entry& entry)
+{
+    std::lock_guard<std::mutex> lock(injectMutex);
+    if (injected.empty()) {
+        return false;
+    }
+    injected.popFront(entry);
+    return true;
+}
+
+/**
+ * @brief Runs one of the caller's own or a stolen task.
+ * Used by workers waiting on a TaskGroup. Never takes new work from the
+ * injection queue, so a waiting file never picks up another whole file.
+ * @return bool indicating whether a task was run.
+ */
+bool TaskScheduler::helpOne()
+{
+    int worker = getCurrentWorker();
+    if (worker < 0) {
+        return false;
+    }
+
+    Entry entry;
+    if (popLocal(worker, entry) || steal(worker, entry)) {
+        runEntry(entry);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Main loop of a worker thread.
+ * @param index Index of the worker.
+ */
+void TaskScheduler::workerLoop(unsigned int index)
+{
+    currentScheduler = this;
+    currentWorkerIndex = static_cast<int>(index);
+    // Before the worker allocates anything, so its arena and resamplers
+    // are placed on its own node
+    topology::pinCurrentThread(workers[index]->cpu, workers[index]->node);
+
+    while (true) {
+        Entry entry;
+        if (popLocal(index, entry) || steal(index, entry) || popInjected(entry)) {
+            runEntry(entry);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (stopping && queued == 0) {
+            return;
+        }
+        // The timeout covers a wakeup racing with the check above
+        wake.wait_for(lock, std::chrono::milliseconds(1), [this]() { return queued > 0 || stopping; });
+    }
+}
+
+/**
+ * @brief Queues a task as part of this group.
+ * @param task Task to run.
+ */
+void TaskGroup::run(TaskScheduler::Task task)
+{
+    pending++;
+    scheduler.submit(std::move(task), this);
+}
+
+/**
+ * @brief Counts one task of the group as run, waking waiters on the last.
+ * The count drops under the lock, so a waiter that sees it reach zero
+ * cannot destroy the group while this is still touching it.
+ */
+void TaskGroup::finishOne()
+{
+    std::lock_guard<std::mutex> lock(doneMutex);
+    if (--pending == 0) {
+        done.notify_all();
+    }
+}
+
+/**
+ * @brief Waits until every task of the group has run.
+ * Workers help with queued tasks meanwhile; other threads block.
+ */
+void TaskGroup::wait()
+{
+    if (scheduler.getCurrentWorker() < 0) {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        done.wait(lock, [this]() { return pending == 0; });
+        return;
+    }
+
+    while (pending > 0) {
+        if (!scheduler.helpOne()) {
+            std::this_thread::yield();
+        }
+    }
+    // Lets the task that ran last leave finishOne() before the group goes
+    std::lock_guard<std::mutex> lock(doneMutex);
+}
@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    scheduler.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+class TaskGroup;
+
+/**
+ * @brief Fixed size work-stealing thread pool.
+ * Tasks submitted from outside the pool go to a shared injection queue.
+ * Tasks submitted by a worker go to that worker's own deque, which it
+ * works through newest first while idle workers steal the oldest. Files
+ * and the channels of a file share one pool, so the machine is never
+ * oversubscribed however the work is split. Queues only grow, so once
+ * warmed up submitting a task whose captures fit std::function's inline
+ * storage does not allocate.
+ *
+ * With pinning on, each worker is bound to one CPU, spread evenly over
+ * the NUMA nodes, and steals from the workers of its own node before
+ * those of other nodes, so a file's channels and the memory its
+ * resamplers touch tend to stay on one node.
+ */
+class TaskScheduler
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit TaskScheduler(unsigned int threadCount, bool pin = false);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    void submit(Task task, TaskGroup* group = nullptr);
+    bool helpOne();
+
+    unsigned int getThreadCount() const { return static_cast<unsigned int>(threads.size()); }
+    int getCurrentWorker() const;
+    unsigned int getNodeCount() const { return nodeCount; }
+
+private:
+    struct Entry {
+        Task task;
+        TaskGroup* group = nullptr;
+    };
+
+    /**
+     * @brief Growable ring of queued tasks, usable from both ends.
+     */
+    class TaskQueue
+    {
+    public:
+        bool empty() const { return count == 0; }
+        void pushBack(Entry&& entry);
+        void popBack(Entry& entry);
+        void popFront(Entry& entry);
+
+    private:
+        std::vector<Entry> slots;
+        size_t head = 0;
+        size_t count = 0;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        TaskQueue tasks;
+        // CPU the worker is pinned to, -1 if not pinned, and its node
+        int cpu = -1;
+        int node = 0;
+        // Workers to steal from, same node first
+        std::vector<unsigned int> victims;
+    };
+
+    void workerLoop(unsigned int index);
+    void runEntry(Entry& entry);
+    bool popLocal(unsigned int index, Entry& entry);
+    bool steal(unsigned int thief, Entry& entry);
+    bool popInjected(Entry& entry);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    unsigned int nodeCount = 1;
+
+    std::mutex injectMutex;
+    TaskQueue injected;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<int> queued{0};
+    std::atomic<bool> stopping{false};
+};
+
+/**
+ * @brief A set of tasks that can be waited on together.
+ * A worker waiting on a group keeps running its own and stolen tasks
+ * instead of blocking, so nested parallelism cannot deadlock the pool.
+ * Any other thread sleeps until the last task of the group has run.
+ */
+class TaskGroup
+{
+public:
+    explicit TaskGroup(TaskScheduler& scheduler) : scheduler(scheduler) {}
+    ~TaskGroup() { wait(); }
+
+    void run(TaskScheduler::Task task);
+    void wait();
+
+private:
+    friend class TaskScheduler;
+
+    void finishOne();
+
+    TaskScheduler& scheduler;
+    std::atomic<int> pending{0};
+    std::mutex doneMutex;
+    std::condition_variable done;
+};
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,389 @@
+/*
+  ==============================================================================
+
+    server.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "server.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "instrument.h"
+#include "json.h"
+#include "kernelcache.h"
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Formats the id member that starts a response.
+ * @param id Id the client gave the job, empty if it gave none.
+ * @return std::string containing the member and its comma, empty without an id.
+ */
+static std::string formatId(const std::string& id)
+{
+    return id.empty() ? std::string() : "\"id\":\"" + escapeJson(id) + "\",";
+}
+
+JobServer::Connection::~Connection()
+{
+    if (isSocket) {
+        ::close(inFd);
+    }
+}
+
+/**
+ * @brief Writes one response line, whole, to the client.
+ * Lines from different workers never interleave. A client that has gone
+ * away is not an error; its remaining responses are dropped.
+ * @param line Response without the trailing newline.
+ */
+void JobServer::Connection::send(const std::string& line)
+{
+    const std::string out = line + "\n";
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = isSocket ? ::send(outFd, out.data() + done, out.size() - done, MSG_NOSIGNAL)
+                             : ::write(outFd, out.data() + done, out.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+/**
+ * @brief Creates a server converting on the given worker pool.
+ * @param scheduler Worker pool jobs, and the channels within them, run on.
+ * @param defaults Settings for jobs that do not override them.
+ * @param saveKernels Writes newly designed filters to the kernel cache whenever the server goes idle.
+ */
+JobServer::JobServer(TaskScheduler& scheduler, const ConversionSettings& defaults, bool saveKernels)
+    : scheduler(scheduler), defaults(defaults), saveKernels(saveKernels),
+      converters(scheduler.getThreadCount()), jobs(scheduler)
+{
+}
+
+JobServer::~JobServer()
+{
+    jobs.wait();
+}
+
+/**
+ * @brief Serves jobs read from standard input, responding on standard output.
+ * Returns once the input ends or a shutdown command arrives and every
+ * accepted job has completed.
+ * @return bool indicating whether the server ran.
+ */
+bool JobServer::serveStdio()
+{
+    std::shared_ptr<Connection> conn = std::make_shared<Connection>(STDIN_FILENO, STDOUT_FILENO, false);
+    readJobs(conn);
+    jobs.wait();
+    return true;
+}
+
+/**
+ * @brief Serves jobs from clients connecting to a Unix domain socket.
+ * Every connection is read on its own thread and gets the responses to
+ * its own jobs. Returns once a client sends a shutdown command and every
+ * accepted job has completed.
+ * @param path Filesystem path of the socket, replaced if it exists.
+ * @return bool indicating whether the socket could be set up.
+ */
+bool JobServer::serveSocket(const std::string& path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: socket path is too long." << std::endl;
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        std::cerr << "Error creating the socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    ::unlink(path.c_str());
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listenFd, 16) != 0) {
+        std::cerr << "Error listening on " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    std::cerr << "Listening on " << path << std::endl;
+
+    std::mutex readersMutex;
+    std::condition_variable readersDone;
+    int activeReaders = 0;
+
+    while (!stopping) {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (!stopping) {
+                std::cerr << "Error accepting a connection: " << std::strerror(errno) << std::endl;
+            }
+            break;
+        }
+
+        std::shared_ptr<Connection> conn = std::make_shared<Connection>(fd, fd, true);
+        {
+            std::lock_guard<std::mutex> lock(connMutex);
+            connections.push_back(conn);
+        }
+        {
+            std::lock_guard<std::mutex> lock(readersMutex);
+            activeReaders++;
+        }
+
+        std::thread([this, conn, &readersMutex, &readersDone, &activeReaders]() {
+            readJobs(conn);
+            {
+                std::lock_guard<std::mutex> lock(connMutex);
+                connections.erase(std::find(connections.begin(), connections.end(), conn));
+            }
+            std::lock_guard<std::mutex> lock(readersMutex);
+            activeReaders--;
+            readersDone.notify_all();
+        }).detach();
+    }
+
+    // Let the accepted jobs finish and answer them before dropping the clients
+    jobs.wait();
+    {
+        std::lock_guard<std::mutex> lock(connMutex);
+        for (const std::shared_ptr<Connection>& conn : connections) {
+            ::shutdown(conn->inFd, SHUT_RD);
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(readersMutex);
+        readersDone.wait(lock, [&activeReaders]() { return activeReaders == 0; });
+    }
+    jobs.wait();
+
+    ::close(listenFd);
+    listenFd = -1;
+    ::unlink(path.c_str());
+    return true;
+}
+
+/**
+ * @brief Reads job lines from a client until it disconnects or asks the server to stop.
+ * @param conn Client to read from.
+ */
+void JobServer::readJobs(const std::shared_ptr<Connection>& conn)
+{
+    std::string buffer;
+    char chunk[4096];
+
+    while (!stopping) {
+        ssize_t n = ::read(conn->inFd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        buffer.append(chunk, static_cast<size_t>(n));
+
+        size_t start = 0;
+        size_t end;
+        while ((end = buffer.find('\n', start)) != std::string::npos) {
+            if (!handleLine(buffer.substr(start, end - start), conn)) {
+                requestStop();
+                return;
+            }
+            start = end + 1;
+        }
+        buffer.erase(0, start);
+    }
+
+    // A last job without a trailing newline
+    if (!stopping && !buffer.empty() && !handleLine(buffer, conn)) {
+        requestStop();
+    }
+}
+
+/**
+ * @brief Parses one line from a client and queues the job it describes.
+ * @param line Line without the trailing newline.
+ * @param conn Client the line came from.
+ * @return bool false if the line asked the server to shut down.
+ */
+bool JobServer::handleLine(const std::string& line, const std::shared_ptr<Connection>& conn)
+{
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+        return true;
+    }
+
+    std::map<std::string, std::string> fields;
+    if (!parseJsonObject(line, fields)) {
+        conn->send("{\"status\":\"error\",\"error\":\"Malformed job line\"}");
+        return true;
+    }
+
+    auto command = fields.find("command");
+    if (command != fields.end()) {
+        if (command->second == "shutdown") {
+            return false;
+        }
+        conn->send("{\"status\":\"error\",\"error\":\"Unknown command: " + escapeJson(command->second) + "\"}");
+        return true;
+    }
+
+    Job job;
+    std::string error;
+    if (!parseJob(fields, job, error)) {
+        conn->send("{" + formatId(job.id) + "\"status\":\"error\",\"error\":\"" + escapeJson(error) + "\"}");
+        return true;
+    }
+
+    inFlight++;
+    jobs.run([this, job, conn]() { runJob(job, conn); });
+    return true;
+}
+
+/**
+ * @brief Fills in a job from the members of its line.
+ * @param fields Members of the job object.
+ * @param job Receives the job.
+ * @param error Receives the reason the job was rejected.
+ * @return bool indicating whether the job is valid.
+ */
+bool JobServer::parseJob(const std::map<std::string, std::string>& fields, Job& job, std::string& error) const
+{
+    auto get = [&fields](const char* name) {
+        auto it = fields.find(name);
+        return it != fields.end() ? it->second : std::string();
+    };
+
+    job.id = get("id");
+    job.inPath = get("input");
+    job.outPath = get("output");
+    if (job.inPath.empty() || job.outPath.empty()) {
+        error = "Jobs need an input and an output";
+        return false;
+    }
+
+    // A preset replaces the whole profile, so it goes first
+    job.settings = defaults;
+    static const char* const profileOptions[] = { "preset", "rate", "channels", "format", "container", "quality", "transband" };
+    for (const char* option : profileOptions) {
+        const std::string value = get(option);
+        if (!value.empty() && !applyProfileOption(option, value, job.settings.output, error)) {
+            return false;
+        }
+    }
+
+    const std::string dither = get("dither");
+    if (!dither.empty() && !parseDitherMode(dither, job.settings.dither)) {
+        error = "Unknown dither mode: " + dither;
+        return false;
+    }
+
+    const std::string shape = get("shape");
+    if (!shape.empty() && !parseNoiseShape(shape, job.settings.noiseShape)) {
+        error = "Unknown noise shaping filter: " + shape;
+        return false;
+    }
+
+    static const char* const trimOptions[] = { "trim", "fade" };
+    for (const char* option : trimOptions) {
+        const std::string value = get(option);
+        if (!value.empty() && !applyTrimOption(option, value, job.settings.trim, error)) {
+            return false;
+        }
+    }
+
+    static const char* const normalizeOptions[] = { "normalize", "lookahead" };
+    for (const char* option : normalizeOptions) {
+        const std::string value = get(option);
+        if (!value.empty() && !applyNormalizeOption(option, value, job.settings.normalize, error)) {
+            return false;
+        }
+    }
+
+    if (stopping) {
+        error = "Server is shutting down";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Converts one job on the current worker and reports the outcome.
+ * @param job Job to convert.
+ * @param conn Client the response goes to.
+ */
+void JobServer::runJob(const Job& job, const std::shared_ptr<Connection>& conn)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::unique_ptr<Converter>& conv = converters[scheduler.getCurrentWorker()];
+    if (!conv) {
+        conv.reset(new Converter(job.settings));
+        conv->setScheduler(&scheduler);
+    } else {
+        conv->setSettings(job.settings);
+    }
+
+    // Ensure the parent directory exists for the output file
+    const fs::path outDir = fs::path(job.outPath).parent_path();
+    if (!outDir.empty()) {
+        std::error_code ec;
+        fs::create_directories(outDir, ec);
+    }
+
+    instrument::beginFile();
+    const bool ok = conv->convert(job.inPath.c_str(), job.outPath.c_str());
+    instrument::endFile(job.inPath);
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    char msText[32];
+    std::snprintf(msText, sizeof(msText), "%.3f", ms);
+
+    std::string response = "{" + formatId(job.id) + "\"status\":\"" + (ok ? "ok" : "failed") +
+                           "\",\"input\":\"" + escapeJson(job.inPath) + "\",\"output\":\"" + escapeJson(job.outPath) +
+                           "\",\"ms\":" + msText + "}";
+    conn->send(response);
+
+    // Keep the filters designed so far whenever the queue drains
+    if (--inFlight == 0 && saveKernels && !kernelcache::save()) {
+        std::cerr << "Error writing the kernel cache." << std::endl;
+    }
+}
+
+/**
+ * @brief Stops accepting jobs and wakes the accept loop.
+ */
+void JobServer::requestStop()
+{
+    stopping = true;
+    if (listenFd >= 0) {
+        ::shutdown(listenFd, SHUT_RDWR);
+    }
+}
@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    server.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "converter.h"
+#include "scheduler.h"
+
+#ifndef SERVER_H
+#define SERVER_H
+
+/**
+ * @brief Long-running conversion service fed with JSONL jobs.
+ * Each line is a flat JSON object such as
+ * {"id":"7","input":"a.wav","output":"out/a.wav","rate":44100}; the optional
+ * preset, rate, channels, format, container, quality, transband, dither and
+ * shape members override the settings the server was started with. Jobs run on the shared worker pool with one persistent
+ * Converter per worker, so resampler pools, scratch arenas and the kernel
+ * cache stay warm from one job to the next. Every job gets exactly one
+ * JSON response line on the connection it came from once it completes,
+ * in completion order. {"command":"shutdown"} stops the server after the
+ * jobs already accepted have finished.
+ */
+class JobServer
+{
+public:
+    JobServer(TaskScheduler& scheduler, const ConversionSettings& defaults, bool saveKernels);
+    ~JobServer();
+
+    JobServer(const JobServer&) = delete;
+    JobServer& operator=(const JobServer&) = delete;
+
+    bool serveStdio();
+    bool serveSocket(const std::string& path);
+
+private:
+    /**
+     * @brief Where a client's jobs came from and their responses go.
+     */
+    struct Connection {
+        int inFd;
+        int outFd;
+        bool isSocket;
+        std::mutex writeMutex;
+
+        Connection(int inFd, int outFd, bool isSocket) : inFd(inFd), outFd(outFd), isSocket(isSocket) {}
+        ~Connection();
+        void send(const std::string& line);
+    };
+
+    struct Job {
+        std::string id;
+        std::string inPath;
+        std::string outPath;
+        ConversionSettings settings;
+    };
+
+    void readJobs(const std::shared_ptr<Connection>& conn);
+    bool handleLine(const std::string& line, const std::shared_ptr<Connection>& conn);
+    bool parseJob(const std::map<std::string, std::string>& fields, Job& job, std::string& error) const;
+    void runJob(const Job& job, const std::shared_ptr<Connection>& conn);
+    void requestStop();
+
+    TaskScheduler& scheduler;
+    ConversionSettings defaults;
+    bool saveKernels;
+
+    // One Converter per worker, created by the worker on its first job
+    std::vector<std::unique_ptr<Converter>> converters;
+
+    TaskGroup jobs;
+    std::atomic<int> inFlight{0};
+    std::atomic<bool> stopping{false};
+
+    // Socket mode only: the listening socket and the open client connections
+    int listenFd = -1;
+    std::mutex connMutex;
+    std::vector<std::shared_ptr<Connection>> connections;
+};
+
+#endif /* SERVER_H */
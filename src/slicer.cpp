@@ -0,0 +1,194 @@
+/*
+  ==============================================================================
+
+    slicer.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "slicer.h"
+#include <algorithm>
+#include <iostream>
+#include "instrument.h"
+
+/**
+ * @brief Decides whether and how a source is sliced.
+ * Slices need periodic resamplers, more than one worker and a source at
+ * least two slices long; anything else is better converted in one go.
+ * @param engine Engine set up for the source.
+ * @param srcFrames Number of frames in the source.
+ * @param threadCount Number of workers the slices can run on.
+ * @return bool indicating whether run() should convert the source.
+ */
+bool Slicer::plan(const ConversionEngine& engine, sf_count_t srcFrames, unsigned int threadCount)
+{
+    int memoryFrames;
+    if (threadCount < 2 || !engine.getStatePeriod(periodIn, periodOut, memoryFrames)) {
+        return false;
+    }
+
+    // Priming and slice starts stay on the period, so every slice starts
+    // where a serial run would have its blocks and phases
+    primingFrames = (static_cast<sf_count_t>(memoryFrames) + periodIn - 1) / periodIn * periodIn;
+    sliceFrames = std::max(minSliceFrames, primingFrames * 4);
+    sliceFrames = (sliceFrames + periodIn - 1) / periodIn * periodIn;
+    if (srcFrames < sliceFrames * 2) {
+        return false;
+    }
+
+    this->srcFrames = srcFrames;
+    sliceCount = (srcFrames + sliceFrames - 1) / sliceFrames;
+    return true;
+}
+
+/**
+ * @brief Resamples one slice into its slot, on a worker.
+ * Reading starts primingFrames early, or at the first frame, and the
+ * frames converted from the priming are dropped. Reading continues past
+ * the end of the slice, and the last slice is flushed with silence, until
+ * every output frame of the slice is converted.
+ * @param slot Slot to convert into.
+ * @param index Index of the slice.
+ */
+void Slicer::convertSlice(Slot& slot, sf_count_t index)
+{
+    const sf_count_t first = index * sliceFrames;
+    const sf_count_t start = std::max<sf_count_t>(0, first - primingFrames);
+    const sf_count_t outFirst = first / periodIn * periodOut;
+    const sf_count_t outEnd = index == sliceCount - 1 ? outTotal : (first + sliceFrames) / periodIn * periodOut;
+    sf_count_t skip = (first - start) / periodIn * periodOut;
+
+    slot.first = first;
+    slot.frames = 0;
+
+    SF_INFO info;
+    slot.ok = slot.reader.open(source->getData(), source->getSize(), info) && slot.reader.seek(start);
+    if (!slot.ok) {
+        return;
+    }
+
+    slot.engine.setupLike(*prototype);
+    slot.engine.reset();
+    const int channels = info.channels;
+    const int outChannels = slot.engine.getOutChannels();
+    slot.inBlock.resize(static_cast<size_t>(blockFrames) * channels);
+    slot.output.resize(static_cast<size_t>(outEnd - outFirst) * outChannels);
+
+    bool endOfInput = false;
+    while (slot.frames < outEnd - outFirst) {
+        sf_count_t got = 0;
+        if (!endOfInput) {
+            got = slot.reader.read(slot.inBlock.data(), blockFrames);
+        }
+        if (got < blockFrames) {
+            std::fill(slot.inBlock.begin() + got * channels, slot.inBlock.end(), 0.0);
+            endOfInput = true;
+        }
+
+        const double* outBlock;
+        sf_count_t outFrames = slot.engine.process(slot.inBlock.data(), blockFrames, outBlock);
+        const sf_count_t dropped = std::min(skip, outFrames);
+        skip -= dropped;
+        outBlock += dropped * outChannels;
+        outFrames = std::min(outFrames - dropped, outEnd - outFirst - slot.frames);
+
+        std::copy(outBlock, outBlock + outFrames * outChannels, slot.output.begin() + slot.frames * outChannels);
+        slot.frames += outFrames;
+    }
+    slot.reader.close();
+}
+
+/**
+ * @brief Converts the source planned by plan().
+ * One slot more than there are workers is kept busy, so the workers
+ * resample the next slices while the caller quantizes and writes the
+ * oldest one.
+ * @param source Source opened by the native reader.
+ * @param writer Output file.
+ * @param engine Engine set up for the source, the slices convert like it.
+ * @param quantizer Quantizer set up for the output.
+ * @param scheduler Worker pool the caller is running on.
+ * @param blockFrames Number of frames read from the source per block.
+ * @param outTotal Number of frames the output should contain.
+ * @param rFrames Receives the number of source frames converted.
+ * @param wFrames Receives the number of frames written.
+ * @return bool indicating whether the whole output was written.
+ */
+bool Slicer::run(const MappedReader& source, AudioWriter& writer, const ConversionEngine& engine, Quantizer& quantizer,
+                 TaskScheduler& scheduler, int blockFrames, sf_count_t outTotal, sf_count_t& rFrames, sf_count_t& wFrames)
+{
+    using instrument::ScopedTimer;
+    using instrument::Stage;
+
+    this->source = &source;
+    this->prototype = &engine;
+    this->blockFrames = blockFrames;
+    this->outTotal = outTotal;
+
+    const size_t slotCount = static_cast<size_t>(std::min<sf_count_t>(scheduler.getThreadCount() + 1, sliceCount));
+    while (slots.size() < slotCount) {
+        slots.emplace_back(new Slot());
+    }
+    std::vector<std::unique_ptr<TaskGroup>> groups;
+    for (size_t i = 0; i < slotCount; i++) {
+        groups.emplace_back(new TaskGroup(scheduler));
+    }
+
+    const int outChannels = engine.getOutChannels();
+    const int chunkFrames = engine.getMaxOutFrames();
+    pcmBlock.resize(static_cast<size_t>(chunkFrames) * quantizer.getFrameBytes());
+
+    auto submit = [&](sf_count_t index) {
+        Slot& slot = *slots[index % slotCount];
+        groups[index % slotCount]->run([this, &slot, index]() { convertSlice(slot, index); });
+    };
+    for (sf_count_t index = 0; index < static_cast<sf_count_t>(slotCount); index++) {
+        submit(index);
+    }
+
+    rFrames = 0;
+    wFrames = 0;
+    for (sf_count_t index = 0; index < sliceCount; index++) {
+        const size_t k = static_cast<size_t>(index % slotCount);
+        {
+            // Waiting runs other slices on the calling worker
+            ScopedTimer timer(Stage::Resample);
+            groups[k]->wait();
+        }
+
+        Slot& slot = *slots[k];
+        if (!slot.ok) {
+            std::cerr << "Error reading the input file." << std::endl;
+            return false;
+        }
+
+        // In slice order, so the quantizer sees the frames as a serial run would
+        for (sf_count_t done = 0; done < slot.frames;) {
+            const int frames = static_cast<int>(std::min<sf_count_t>(chunkFrames, slot.frames - done));
+            {
+                ScopedTimer timer(Stage::Quantize);
+                quantizer.process(slot.output.data() + static_cast<size_t>(done) * outChannels, pcmBlock.data(), frames);
+            }
+
+            sf_count_t written;
+            {
+                ScopedTimer timer(Stage::Write);
+                written = writer.write(pcmBlock.data(), frames);
+            }
+            done += written;
+            wFrames += written;
+            if (written < frames) {
+                std::cerr << "Error writing the output file." << std::endl;
+                return false;
+            }
+        }
+        rFrames += std::min(srcFrames, slot.first + sliceFrames) - slot.first;
+
+        if (index + static_cast<sf_count_t>(slotCount) < sliceCount) {
+            submit(index + static_cast<sf_count_t>(slotCount));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    slicer.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <memory>
+#include <sndfile.h>
+#include <vector>
+#include "arena.h"
+#include "audioio.h"
+#include "engine.h"
+#include "mappedfile.h"
+#include "quantizer.h"
+#include "scheduler.h"
+
+#ifndef SLICER_H
+#define SLICER_H
+
+/**
+ * @brief Converts one long file as slices resampled in parallel.
+ * The source is cut at multiples of the resamplers' period, where r8brain's
+ * blocks and interpolation phases line up again. Each slice is resampled on
+ * the worker pool by its own engine, reading the shared mapping through its
+ * own reader, starting a whole number of periods early and dropping what it
+ * outputs for those frames, so its first kept frame already sees the same
+ * history a serial run would. The slices are quantized and written on the
+ * calling thread in order, keeping the dither sequence, so the output is
+ * identical to converting the file in one go.
+ */
+class Slicer
+{
+public:
+    bool plan(const ConversionEngine& engine, sf_count_t srcFrames, unsigned int threadCount);
+    bool run(const MappedReader& source, AudioWriter& writer, const ConversionEngine& engine, Quantizer& quantizer,
+             TaskScheduler& scheduler, int blockFrames, sf_count_t outTotal, sf_count_t& rFrames, sf_count_t& wFrames);
+
+private:
+    // Slices start at least this many source frames apart, and at least
+    // four times their priming, so priming stays a small part of the work
+    static const sf_count_t minSliceFrames = 1 << 20;
+
+    /**
+     * @brief State of one slice being converted.
+     */
+    struct Slot {
+        ConversionEngine engine;
+        MappedReader reader;
+        arena::Vector<double> inBlock;
+        // Converted frames the slice contributes to the output
+        arena::Vector<double> output;
+        sf_count_t first = 0;
+        sf_count_t frames = 0;
+        bool ok = false;
+    };
+
+    void convertSlice(Slot& slot, sf_count_t index);
+
+    sf_count_t srcFrames = 0;
+    sf_count_t outTotal = 0;
+    sf_count_t sliceFrames = 0;
+    sf_count_t primingFrames = 0;
+    sf_count_t sliceCount = 0;
+    int periodIn = 0;
+    int periodOut = 0;
+
+    // What the slices of the current run convert, and how
+    const MappedReader* source = nullptr;
+    const ConversionEngine* prototype = nullptr;
+    int blockFrames = 0;
+
+    std::vector<std::unique_ptr<Slot>> slots;
+    arena::Vector<unsigned char> pcmBlock;
+};
+
+#endif /* SLICER_H */
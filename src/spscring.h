@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    spscring.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+/**
+ * @brief Bounded lock-free single-producer/single-consumer ring buffer.
+ * Exactly one thread may push and exactly one other thread may pop.
+ * @tparam T Element type, usually a pointer to a preallocated block.
+ * @tparam Capacity Number of slots, must be a power of two.
+ */
+template <typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    /**
+     * @brief Appends an element.
+     * @param value Element to append.
+     * @return bool indicating whether there was room for the element.
+     */
+    bool push(const T& value)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[t & (Capacity - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element.
+     * @param value Receives the element.
+     * @return bool indicating whether an element was available.
+     */
+    bool pop(T& value)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> slots;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
+
+#endif /* SPSCRING_H */
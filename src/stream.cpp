@@ -0,0 +1,203 @@
+/*
+  ==============================================================================
+
+    stream.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "stream.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/**
+ * @brief Prepares the converter for a stream and sizes all of its buffers.
+ * Only the rate, channel count and filter spec of the profile are used,
+ * the output is always 16 bit in native byte order.
+ * @param srcRate Sample rate of the pushed frames.
+ * @param channels Number of interleaved channels of the pushed frames.
+ * @param profile Rate, channels and resampler of the output.
+ * @param maxPushFrames Largest number of frames passed to a single push.
+ * @param dither Dither added before rounding to 16 bit.
+ * @param shape Noise shaping filter.
+ * @return bool indicating whether the stream could be set up.
+ */
+bool StreamConverter::setup(int srcRate, int channels, const OutputProfile& profile, int maxPushFrames,
+                            DitherMode dither, NoiseShape shape)
+{
+    if (srcRate <= 0 || profile.sampleRate <= 0 || channels < 1 || maxPushFrames < 1) {
+        std::cerr << "Error setting up the stream: invalid rate, channels or block length." << std::endl;
+        return false;
+    }
+
+    this->srcRate = srcRate;
+    this->channels = channels;
+    this->maxPushFrames = maxPushFrames;
+    this->dither = dither;
+    this->shape = shape;
+    dstRate = profile.sampleRate;
+    outChannels = profile.channels > 0 ? profile.channels : channels;
+
+    engine.setup(srcRate, dstRate, channels, outChannels, maxPushFrames, profile.resampler);
+
+    // Room for two of the largest pushes, so a caller pulling after every
+    // push is never refused
+    fifoFrames = 2 * engine.getMaxOutFrames();
+    fifo.assign(static_cast<size_t>(fifoFrames) * outChannels, 0);
+    inBlock.assign(static_cast<size_t>(maxPushFrames) * channels, 0.0);
+    silence.assign(static_cast<size_t>(maxPushFrames) * channels, 0.0);
+
+    reset();
+    quantizer.reserve(engine.getMaxOutFrames());
+    return true;
+}
+
+/**
+ * @brief Starts a new stream with the format given to setup().
+ * Drops anything pushed or converted so far without allocating.
+ */
+void StreamConverter::reset()
+{
+    engine.reset();
+    const bool bigEndian = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+    quantizer.setup(outChannels, SampleFormat::PCM16, bigEndian, dither, shape);
+
+    readPos = 0;
+    writePos = 0;
+    pushedFrames = 0;
+    producedFrames = 0;
+    outTotal = 0;
+    finished = false;
+}
+
+/**
+ * @brief Moves the unread frames to the front of the queue if a push might not fit.
+ * @return bool indicating whether the largest push's output now fits.
+ */
+bool StreamConverter::makeRoom()
+{
+    const int maxOutFrames = engine.getMaxOutFrames();
+    if (fifoFrames - writePos >= maxOutFrames) {
+        return true;
+    }
+
+    const int available = writePos - readPos;
+    std::copy(fifo.begin() + static_cast<size_t>(readPos) * outChannels,
+              fifo.begin() + static_cast<size_t>(writePos) * outChannels, fifo.begin());
+    readPos = 0;
+    writePos = available;
+    return fifoFrames - writePos >= maxOutFrames;
+}
+
+/**
+ * @brief Quantizes converted frames onto the end of the queue.
+ * @param samples Interleaved frames from the engine.
+ * @param frames Number of frames.
+ */
+void StreamConverter::append(const double* samples, int frames)
+{
+    quantizer.process(samples, reinterpret_cast<unsigned char*>(&fifo[static_cast<size_t>(writePos) * outChannels]),
+                      frames);
+    writePos += frames;
+    producedFrames += frames;
+}
+
+/**
+ * @brief Converts a chunk of interleaved float frames.
+ * Nothing is consumed when the call is refused, so the chunk can be pushed
+ * again after pulling.
+ * @param in Interleaved frames at the source rate, normalized to +-1.
+ * @param frames Number of frames, at most the maxPushFrames given to setup().
+ * @return bool indicating whether the chunk was taken; false after finish(),
+ * for an oversized chunk, or while too much converted output is unread.
+ */
+bool StreamConverter::push(const float* in, int frames)
+{
+    if (finished || frames < 0 || frames > maxPushFrames || !makeRoom()) {
+        return false;
+    }
+
+    std::copy(in, in + static_cast<size_t>(frames) * channels, inBlock.begin());
+
+    const double* out;
+    const int outFrames = engine.process(inBlock.data(), frames, out);
+    append(out, outFrames);
+    pushedFrames += frames;
+    return true;
+}
+
+/**
+ * @brief Marks the end of the source.
+ * The frames still held by the resamplers are flushed by the following pulls.
+ */
+void StreamConverter::finish()
+{
+    if (finished) {
+        return;
+    }
+    finished = true;
+    outTotal = engine.isPassthrough() ? pushedFrames : static_cast<int64_t>(
+        std::ceil(pushedFrames * static_cast<double>(dstRate) / srcRate));
+}
+
+/**
+ * @brief Takes converted frames off the queue.
+ * Once the stream is finished, silence is fed through the resamplers to
+ * flush their tail, which is cut to the length of the source.
+ * @param out Receives up to maxFrames interleaved 16 bit frames.
+ * @param maxFrames Number of frames out has room for.
+ * @return Number of frames written to out.
+ */
+int StreamConverter::pull(int16_t* out, int maxFrames)
+{
+    // Frames produced past the end of the source are never handed out
+    if (finished && producedFrames > outTotal) {
+        writePos -= static_cast<int>(std::min<int64_t>(producedFrames - outTotal, writePos - readPos));
+        producedFrames = outTotal;
+    }
+
+    while (finished && writePos - readPos < maxFrames && producedFrames < outTotal && makeRoom()) {
+        const double* flushed;
+        const int flushedFrames = engine.process(silence.data(), maxPushFrames, flushed);
+        append(flushed, static_cast<int>(std::min<int64_t>(flushedFrames, outTotal - producedFrames)));
+    }
+
+    const int frames = std::min(maxFrames, writePos - readPos);
+    std::copy(fifo.begin() + static_cast<size_t>(readPos) * outChannels,
+              fifo.begin() + static_cast<size_t>(readPos + frames) * outChannels, out);
+    readPos += frames;
+    return frames;
+}
+
+/**
+ * @brief Checks whether every frame of a finished stream has been pulled.
+ * @return bool indicating whether the stream is done.
+ */
+bool StreamConverter::isDone() const
+{
+    return finished && producedFrames >= outTotal && readPos == writePos;
+}
+
+/**
+ * @brief Gets the number of source frames pushed before the first frame can be pulled.
+ * @return Number of frames at the source rate.
+ */
+int StreamConverter::getLatencyFrames() const
+{
+    return engine.getPrimingFrames();
+}
+
+/**
+ * @brief Gets the end-to-end delay added by the conversion.
+ * The priming of the resamplers plus any fractional delay they leave in
+ * the output. Chunking adds up to one push of delay on top, which depends
+ * on the caller.
+ * @return Latency in seconds.
+ */
+double StreamConverter::getLatencySeconds() const
+{
+    return static_cast<double>(getLatencyFrames()) / srcRate + engine.getLatencyFrac() / dstRate;
+}
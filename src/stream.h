@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    stream.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <cstdint>
+#include "arena.h"
+#include "engine.h"
+#include "profile.h"
+#include "quantizer.h"
+
+#ifndef STREAM_H
+#define STREAM_H
+
+/**
+ * @brief Converts audio pushed in chunks, for callers that receive it as it arrives.
+ * Interleaved float frames go in through push() and 16 bit frames at the
+ * profile's rate and channel count come out of pull(). Everything is
+ * sized by setup(), so push() and pull() never allocate and can run from
+ * a fixed-size audio callback. r8brain compensates its own filter delay
+ * by holding back output until it is primed: the first pushes return no
+ * frames, and the stream starts exactly at the first source frame rather
+ * than after a run of filter delay. getLatencyFrames() reports how much
+ * has to be pushed before output appears. After finish() the held back
+ * tail is flushed by pull(), cut so the output is exactly as long as the
+ * source at the new rate.
+ */
+class StreamConverter
+{
+public:
+    bool setup(int srcRate, int channels, const OutputProfile& profile, int maxPushFrames,
+               DitherMode dither = DitherMode::TPDF, NoiseShape shape = NoiseShape::None);
+    void reset();
+
+    bool push(const float* in, int frames);
+    void finish();
+    int pull(int16_t* out, int maxFrames);
+
+    int getAvailableFrames() const { return writePos - readPos; }
+    bool isDone() const;
+
+    int getOutRate() const { return dstRate; }
+    int getOutChannels() const { return outChannels; }
+    int getLatencyFrames() const;
+    double getLatencySeconds() const;
+
+private:
+    bool makeRoom();
+    void append(const double* samples, int frames);
+
+    int srcRate = 0;
+    int dstRate = 0;
+    int channels = 0;
+    int outChannels = 0;
+    int maxPushFrames = 0;
+    DitherMode dither = DitherMode::TPDF;
+    NoiseShape shape = NoiseShape::None;
+
+    ConversionEngine engine;
+    Quantizer quantizer;
+
+    // Converted frames waiting to be pulled, compacted to the front when full
+    arena::Vector<int16_t> fifo;
+    int fifoFrames = 0;
+    int readPos = 0;
+    int writePos = 0;
+
+    // Push sized scratch: the input as doubles, and silence for flushing
+    arena::Vector<double> inBlock;
+    arena::Vector<double> silence;
+
+    int64_t pushedFrames = 0;
+    int64_t producedFrames = 0;
+    int64_t outTotal = 0;
+    bool finished = false;
+};
+
+#endif /* STREAM_H */
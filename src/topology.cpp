@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    topology.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "topology.h"
+#include <algorithm>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace topology {
+
+// Node the calling thread was pinned to
+static thread_local int currentNode = 0;
+
+/**
+ * @brief Parses a kernel CPU list such as "0-3,8-11".
+ * @param text List to parse.
+ * @param cpus Receives the CPUs in the list, in order.
+ * @return bool indicating whether the list was well formed.
+ */
+bool parseCpuList(const std::string& text, std::vector<int>& cpus)
+{
+    cpus.clear();
+    const char* p = text.c_str();
+    while (*p && *p != '\n') {
+        char* end;
+        const long first = std::strtol(p, &end, 10);
+        if (end == p || first < 0) {
+            return false;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = std::strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first) {
+                return false;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p && *p != '\n') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the NUMA nodes and the CPUs of each the process may run on.
+ * @return Nodes in order of their id, nodes without allowed CPUs left out.
+ * Always holds at least one node.
+ */
+std::vector<Node> readNodes()
+{
+    std::vector<int> allowed;
+#if defined(__linux__)
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                allowed.push_back(cpu);
+            }
+        }
+    }
+#endif
+
+    std::vector<Node> nodes;
+    if (DIR* dir = opendir("/sys/devices/system/node")) {
+        while (dirent* entry = readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+
+            std::ifstream file("/sys/devices/system/node/" + name + "/cpulist");
+            std::string list;
+            Node node;
+            node.id = std::atoi(name.c_str() + 4);
+            if (!std::getline(file, list) || !parseCpuList(list, node.cpus)) {
+                continue;
+            }
+            node.cpus.erase(std::remove_if(node.cpus.begin(), node.cpus.end(), [&allowed](int cpu) {
+                return !std::binary_search(allowed.begin(), allowed.end(), cpu);
+            }), node.cpus.end());
+            if (!node.cpus.empty()) {
+                nodes.push_back(std::move(node));
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const Node& a, const Node& b) { return a.id < b.id; });
+
+    if (nodes.empty()) {
+        nodes.emplace_back();
+        nodes[0].cpus = allowed;
+    }
+    return nodes;
+}
+
+/**
+ * @brief Pins the calling thread to one CPU.
+ * Memory the thread touches first afterwards is placed on that CPU's node
+ * by the kernel, which is how per-worker buffers become node-local.
+ * @param cpu CPU to run on, negative to leave the affinity alone.
+ * @param node Index of the CPU's node in readNodes(), reported by
+ * getCurrentNode() from now on.
+ * @return bool indicating whether the thread was pinned.
+ */
+bool pinCurrentThread(int cpu, int node)
+{
+    currentNode = node;
+    if (cpu < 0) {
+        return false;
+    }
+
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Gets the node the calling thread was pinned to.
+ * @return Index of the node in readNodes(), 0 for threads never pinned.
+ */
+int getCurrentNode()
+{
+    return currentNode;
+}
+
+} // namespace topology
@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    topology.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <string>
+#include <vector>
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+/**
+ * @brief NUMA nodes of the machine and the node the caller runs on.
+ * Nodes are read from /sys/devices/system/node and limited to the CPUs
+ * the process may run on. Machines without NUMA, and anything that is not
+ * Linux, show up as a single node holding every allowed CPU. A thread
+ * counts as being on node 0 until it is pinned.
+ */
+namespace topology {
+
+/**
+ * @brief A NUMA node and the CPUs that belong to it.
+ */
+struct Node {
+    int id = 0;
+    std::vector<int> cpus;
+};
+
+bool parseCpuList(const std::string& text, std::vector<int>& cpus);
+std::vector<Node> readNodes();
+
+bool pinCurrentThread(int cpu, int node);
+int getCurrentNode();
+
+} // namespace topology
+
+#endif /* TOPOLOGY_H */
@@ -0,0 +1,280 @@
+/*
+  ==============================================================================
+
+    trim.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "trim.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "includes/r8brain/r8bbase.h"
+
+/**
+ * @brief Finds the first sample louder than a threshold.
+ * Eight samples are compared per step on SSE2/NEON, and only the step
+ * that contains a loud sample is searched one sample at a time.
+ * @param in Samples to scan.
+ * @param count Number of samples.
+ * @param threshold Linear level samples have to exceed, in magnitude.
+ * @return Index of the sample, or count if every sample is at or below the threshold.
+ */
+sf_count_t findFirstAbove(const double* in, sf_count_t count, double threshold)
+{
+    sf_count_t i = 0;
+
+#if defined(R8B_SSE2)
+    const __m128d magnitude = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFll));
+    const __m128d limit = _mm_set1_pd(threshold);
+    auto above = [&](sf_count_t offset) {
+        return _mm_cmpgt_pd(_mm_and_pd(_mm_loadu_pd(in + offset), magnitude), limit);
+    };
+    for (; i + 8 <= count; i += 8) {
+        const __m128d any = _mm_or_pd(_mm_or_pd(above(i), above(i + 2)), _mm_or_pd(above(i + 4), above(i + 6)));
+        if (_mm_movemask_pd(any)) {
+            break;
+        }
+    }
+#elif defined(R8B_NEON)
+    const float64x2_t limit = vdupq_n_f64(threshold);
+    auto above = [&](sf_count_t offset) { return vcagtq_f64(vld1q_f64(in + offset), limit); };
+    for (; i + 8 <= count; i += 8) {
+        const uint64x2_t any = vorrq_u64(vorrq_u64(above(i), above(i + 2)), vorrq_u64(above(i + 4), above(i + 6)));
+        if (vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1)) {
+            break;
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        if (std::fabs(in[i]) > threshold) {
+            return i;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Finds the last sample louder than a threshold.
+ * Scans backward, eight samples per step on SSE2/NEON.
+ * @param in Samples to scan.
+ * @param count Number of samples.
+ * @param threshold Linear level samples have to exceed, in magnitude.
+ * @return Index of the sample, or -1 if every sample is at or below the threshold.
+ */
+sf_count_t findLastAbove(const double* in, sf_count_t count, double threshold)
+{
+    sf_count_t i = count;
+
+#if defined(R8B_SSE2)
+    const __m128d magnitude = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFll));
+    const __m128d limit = _mm_set1_pd(threshold);
+    auto above = [&](sf_count_t offset) {
+        return _mm_cmpgt_pd(_mm_and_pd(_mm_loadu_pd(in + offset), magnitude), limit);
+    };
+    for (; i >= 8; i -= 8) {
+        const __m128d any = _mm_or_pd(_mm_or_pd(above(i - 8), above(i - 6)), _mm_or_pd(above(i - 4), above(i - 2)));
+        if (_mm_movemask_pd(any)) {
+            break;
+        }
+    }
+#elif defined(R8B_NEON)
+    const float64x2_t limit = vdupq_n_f64(threshold);
+    auto above = [&](sf_count_t offset) { return vcagtq_f64(vld1q_f64(in + offset), limit); };
+    for (; i >= 8; i -= 8) {
+        const uint64x2_t any = vorrq_u64(vorrq_u64(above(i - 8), above(i - 6)), vorrq_u64(above(i - 4), above(i - 2)));
+        if (vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1)) {
+            break;
+        }
+    }
+#endif
+
+    while (--i >= 0) {
+        if (std::fabs(in[i]) > threshold) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Describes trim settings in a compact, stable form.
+ * @param settings Settings to describe.
+ * @return std::string such as "trim-60-fade5", empty if trimming is off.
+ */
+std::string describeTrim(const TrimSettings& settings)
+{
+    if (!settings.enabled) {
+        return std::string();
+    }
+
+    char text[64];
+    std::snprintf(text, sizeof(text), "trim%g-fade%g", settings.thresholdDb, settings.fadeMs);
+    return text;
+}
+
+/**
+ * @brief Applies a trim option given by name, as on the command line or in a job.
+ * "trim" sets the threshold in dBFS and turns trimming on, "fade" sets the
+ * fade length in milliseconds.
+ * @param name Option name: trim or fade.
+ * @param value Value of the option.
+ * @param settings Settings to adjust.
+ * @param error Receives the reason the value was rejected.
+ * @return bool indicating whether the option was applied.
+ */
+bool applyTrimOption(const std::string& name, const std::string& value, TrimSettings& settings, std::string& error)
+{
+    char* end;
+    const double number = std::strtod(value.c_str(), &end);
+    if (name == "trim") {
+        if (end == value.c_str() || *end || !(number >= -200.0 && number <= 0.0)) {
+            error = "Trim threshold must be between -200 and 0 dBFS: " + value;
+            return false;
+        }
+        settings.enabled = true;
+        settings.thresholdDb = number;
+    } else if (name == "fade") {
+        if (end == value.c_str() || *end || !(number >= 0.0 && number <= 10000.0)) {
+            error = "Fade length must be between 0 and 10000 ms: " + value;
+            return false;
+        }
+        settings.fadeMs = number;
+    } else {
+        error = "Unknown trim option: " + name;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the audible part of a source and moves the source to its start.
+ * @param source Reader positioned at the first frame of the source.
+ * @param channels Number of interleaved channels.
+ * @param rate Sample rate of the source, used to size the fades.
+ * @param frames Number of frames in the source.
+ * @param settings Threshold and fade length.
+ * @return bool indicating whether the source could be scanned.
+ */
+bool TrimmedReader::open(AudioReader& source, int channels, int rate, sf_count_t frames,
+                         const TrimSettings& settings)
+{
+    this->source = &source;
+    this->channels = channels;
+    sourceFrames = frames;
+
+    const double threshold = std::pow(10.0, settings.thresholdDb / 20.0);
+    scan.resize(static_cast<size_t>(scanFrames) * channels);
+
+    // First audible frame, reading forward through the leading silence
+    start = frames;
+    for (sf_count_t pos = 0; pos < frames;) {
+        const sf_count_t got = source.read(scan.data(), scanFrames);
+        if (got <= 0) {
+            break;
+        }
+        const sf_count_t index = findFirstAbove(scan.data(), got * channels, threshold);
+        if (index < got * channels) {
+            start = pos + index / channels;
+            break;
+        }
+        pos += got;
+    }
+
+    // Last audible frame, reading backward through the trailing silence
+    end = start;
+    for (sf_count_t blockEnd = frames; blockEnd > start;) {
+        const sf_count_t blockStart = std::max(start, blockEnd - scanFrames);
+        const sf_count_t length = blockEnd - blockStart;
+        if (!source.seek(blockStart) || source.read(scan.data(), length) != length) {
+            return false;
+        }
+        const sf_count_t index = findLastAbove(scan.data(), length * channels, threshold);
+        if (index >= 0) {
+            end = blockStart + index / channels + 1;
+            break;
+        }
+        blockEnd = blockStart;
+    }
+
+    fadeFrames = std::min<sf_count_t>(std::llround(settings.fadeMs * rate / 1000.0), (end - start) / 2);
+    position = start;
+    return source.seek(start);
+}
+
+/**
+ * @brief Reads the next audible frames, faded at either end.
+ * @param out Receives frames * channels samples.
+ * @param frames Number of frames to read.
+ * @return Number of frames read, less than frames at the last audible frame.
+ */
+sf_count_t TrimmedReader::read(double* out, sf_count_t frames)
+{
+    frames = std::min(frames, end - position);
+    if (frames <= 0) {
+        return 0;
+    }
+
+    const sf_count_t got = source->read(out, frames);
+    if (got <= 0) {
+        return 0;
+    }
+    if (fadeFrames > 0) {
+        applyFades(out, got);
+    }
+    position += got;
+    return got;
+}
+
+/**
+ * @brief Scales the frames of a block that fall inside the fades.
+ * Raised cosine fades, which click less than linear ones of the same length.
+ * @param samples Interleaved frames starting at the current position.
+ * @param frames Number of frames.
+ */
+void TrimmedReader::applyFades(double* samples, sf_count_t frames) const
+{
+    const sf_count_t first = position - start;
+    const sf_count_t length = end - start;
+    auto scale = [&](sf_count_t i, sf_count_t fromEdge) {
+        const double gain = 0.5 - 0.5 * std::cos(R8B_PI * (fromEdge + 0.5) / fadeFrames);
+        double* frame = samples + static_cast<size_t>(i) * channels;
+        for (int c = 0; c < channels; c++) {
+            frame[c] *= gain;
+        }
+    };
+
+    for (sf_count_t i = 0; i < frames && first + i < fadeFrames; i++) {
+        scale(i, first + i);
+    }
+    for (sf_count_t i = std::max<sf_count_t>(0, length - fadeFrames - first); i < frames; i++) {
+        scale(i, length - 1 - (first + i));
+    }
+}
+
+/**
+ * @brief Moves to a frame of the audible part.
+ * @param frame Index of the frame, counted from the first audible frame.
+ * @return bool indicating whether the source could seek there.
+ */
+bool TrimmedReader::seek(sf_count_t frame)
+{
+    if (frame < 0 || frame > end - start || !source->seek(start + frame)) {
+        return false;
+    }
+    position = start + frame;
+    return true;
+}
+
+void TrimmedReader::close()
+{
+    if (source) {
+        source->close();
+        source = nullptr;
+    }
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    trim.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <string>
+#include "arena.h"
+#include "audioio.h"
+
+#ifndef TRIM_H
+#define TRIM_H
+
+/**
+ * @brief How leading and trailing silence is cut from the sources.
+ */
+struct TrimSettings {
+    bool enabled = false;
+    // Samples at or below this level, in dBFS, count as silence
+    double thresholdDb = -60.0;
+    // Length of the fade in and out at the new start and end, 0 for none
+    double fadeMs = 0.0;
+};
+
+sf_count_t findFirstAbove(const double* in, sf_count_t count, double threshold);
+sf_count_t findLastAbove(const double* in, sf_count_t count, double threshold);
+std::string describeTrim(const TrimSettings& settings);
+bool applyTrimOption(const std::string& name, const std::string& value, TrimSettings& settings, std::string& error);
+
+/**
+ * @brief AudioReader passing on only the audible part of another reader.
+ * open() finds the first and last frame above the threshold by scanning
+ * forward from the start and backward from the end of the source, so only
+ * the silence and a block either side of it are read twice. Reads then
+ * stop at the last audible frame, and the optional fades are applied as
+ * the frames pass through, before anything is resampled.
+ */
+class TrimmedReader : public AudioReader
+{
+public:
+    bool open(AudioReader& source, int channels, int rate, sf_count_t frames, const TrimSettings& settings);
+    sf_count_t read(double* out, sf_count_t frames) override;
+    bool seek(sf_count_t frame) override;
+    void close() override;
+
+    bool isTrimmed() const { return start > 0 || end < sourceFrames; }
+    sf_count_t getStart() const { return start; }
+    sf_count_t getFrames() const { return end - start; }
+
+private:
+    // Number of frames scanned per read while looking for the audible part
+    static const int scanFrames = 8192;
+
+    void applyFades(double* samples, sf_count_t frames) const;
+
+    AudioReader* source = nullptr;
+    int channels = 0;
+    sf_count_t sourceFrames = 0;
+
+    // Audible frames of the source are [start, end)
+    sf_count_t start = 0;
+    sf_count_t end = 0;
+    sf_count_t position = 0;
+    sf_count_t fadeFrames = 0;
+
+    arena::Vector<double> scan;
+};
+
+#endif /* TRIM_H */
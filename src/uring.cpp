@@ -0,0 +1,341 @@
+/*
+  ==============================================================================
+
+    uring.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "uring.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#if defined(HAVE_IO_URING)
+static int ringSetup(unsigned int entries, io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ringEnter(int fd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+#endif
+
+/**
+ * @brief Runs a request as a blocking pread/pwrite.
+ * @return Bytes transferred, or a negative errno.
+ */
+static int runBlocking(bool write, int fd, void* buffer, unsigned int length, uint64_t offset)
+{
+    ssize_t result = write ? pwrite(fd, buffer, length, static_cast<off_t>(offset))
+                           : pread(fd, buffer, length, static_cast<off_t>(offset));
+    return result < 0 ? -errno : static_cast<int>(result);
+}
+
+IoRing::~IoRing()
+{
+#if defined(HAVE_IO_URING)
+    // Requests still in the kernel write into buffers owned by the caller
+    Completion completion;
+    while (pending > 0 && wait(completion)) {
+    }
+
+    if (sqes) {
+        munmap(sqes, sqesSize);
+    }
+    if (cqRing && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    if (sqRing) {
+        munmap(sqRing, sqRingSize);
+    }
+    if (ringFd >= 0) {
+        ::close(ringFd);
+    }
+#endif
+}
+
+/**
+ * @brief Sets up the kernel ring.
+ * @param entries Number of requests that may be pending at once.
+ * @return bool indicating whether io_uring is used; if not, the ring
+ * still works, one blocking request at a time.
+ */
+bool IoRing::init(unsigned int entries)
+{
+    this->entries = entries > 0 ? entries : 1;
+
+#if defined(HAVE_IO_URING)
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    const int fd = ringSetup(this->entries, &params);
+    if (fd < 0) {
+        return false;
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap) {
+        sqRingSize = cqRingSize = sqRingSize > cqRingSize ? sqRingSize : cqRingSize;
+    }
+
+    void* sq = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    void* cq = sq;
+    if (sq != MAP_FAILED && !singleMap) {
+        cq = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    }
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* entriesMap = MAP_FAILED;
+    if (sq != MAP_FAILED && cq != MAP_FAILED) {
+        entriesMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    }
+
+    if (entriesMap == MAP_FAILED) {
+        if (cq != MAP_FAILED && cq != sq) {
+            munmap(cq, cqRingSize);
+        }
+        if (sq != MAP_FAILED) {
+            munmap(sq, sqRingSize);
+        }
+        ::close(fd);
+        return false;
+    }
+
+    ringFd = fd;
+    sqRing = sq;
+    cqRing = cq;
+    sqes = entriesMap;
+
+    unsigned char* sqBase = static_cast<unsigned char*>(sqRing);
+    unsigned char* cqBase = static_cast<unsigned char*>(cqRing);
+    sqTail = reinterpret_cast<unsigned int*>(sqBase + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned int*>(sqBase + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned int*>(sqBase + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned int*>(cqBase + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned int*>(cqBase + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned int*>(cqBase + params.cq_off.ring_mask);
+    cqes = cqBase + params.cq_off.cqes;
+
+    // The kernel may round the ring up, but never more than asked may be pending
+    if (params.sq_entries < this->entries) {
+        this->entries = params.sq_entries;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Queues a read of part of a file.
+ * Only call when hasSpace() is true.
+ * @param fd File to read from.
+ * @param buffer Receives the bytes, kept alive until the request completes.
+ * @param length Number of bytes to read.
+ * @param offset Position in the file.
+ * @param tag Returned with the completion.
+ */
+void IoRing::queueRead(int fd, void* buffer, unsigned int length, uint64_t offset, uint64_t tag)
+{
+#if defined(HAVE_IO_URING)
+    queue(IORING_OP_READ, fd, buffer, length, offset, tag);
+#else
+    queue(0, fd, buffer, length, offset, tag);
+#endif
+}
+
+/**
+ * @brief Queues a write of part of a file.
+ * Only call when hasSpace() is true.
+ * @param fd File to write to.
+ * @param buffer Bytes to write, kept alive until the request completes.
+ * @param length Number of bytes to write.
+ * @param offset Position in the file.
+ * @param tag Returned with the completion.
+ */
+void IoRing::queueWrite(int fd, const void* buffer, unsigned int length, uint64_t offset, uint64_t tag)
+{
+#if defined(HAVE_IO_URING)
+    queue(IORING_OP_WRITE, fd, const_cast<void*>(buffer), length, offset, tag);
+#else
+    queue(1, fd, const_cast<void*>(buffer), length, offset, tag);
+#endif
+}
+
+void IoRing::queue(int opcode, int fd, void* buffer, unsigned int length, uint64_t offset, uint64_t tag)
+{
+    pending++;
+
+#if defined(HAVE_IO_URING)
+    if (ringFd >= 0) {
+        const unsigned int tail = *sqTail;
+        const unsigned int index = tail & *sqMask;
+        io_uring_sqe& sqe = static_cast<io_uring_sqe*>(sqes)[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = static_cast<unsigned char>(opcode);
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = length;
+        sqe.off = offset;
+        sqe.user_data = tag;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        unsubmitted++;
+        return;
+    }
+    const bool write = opcode == IORING_OP_WRITE;
+#else
+    const bool write = opcode == 1;
+#endif
+
+    finished.push_back({ tag, runBlocking(write, fd, buffer, length, offset) });
+}
+
+/**
+ * @brief Gives up on a kernel ring that stopped working.
+ * Requests the kernel already took may still be reading into or writing
+ * from the caller's buffers, so their completions are waited for first;
+ * they land in the mapped ring even if io_uring_enter keeps failing.
+ * Requests it never took run blocking. Either way their completions are
+ * returned by wait() as usual, and later requests run blocking, as if
+ * io_uring had never been available.
+ */
+void IoRing::abandon()
+{
+#if defined(HAVE_IO_URING)
+    if (ringFd < 0) {
+        return;
+    }
+
+    unsigned int inKernel = pending - unsubmitted - static_cast<unsigned int>(finished.size());
+    while (inKernel > 0) {
+        Completion completion;
+        if (popRing(completion)) {
+            finished.push_back(completion);
+            inKernel--;
+        } else if (ringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            usleep(100);
+        }
+    }
+
+    // Without SQPOLL the kernel takes queued entries in order, so the ones
+    // it never saw are the last unsubmitted before the tail
+    const unsigned int tail = *sqTail;
+    for (unsigned int i = tail - unsubmitted; i != tail; i++) {
+        const io_uring_sqe& sqe = static_cast<io_uring_sqe*>(sqes)[sqArray[i & *sqMask]];
+        finished.push_back({ sqe.user_data, runBlocking(sqe.opcode == IORING_OP_WRITE, sqe.fd,
+                                                        reinterpret_cast<void*>(sqe.addr), sqe.len, sqe.off) });
+    }
+    unsubmitted = 0;
+
+    ::close(ringFd);
+    ringFd = -1;
+#endif
+}
+
+/**
+ * @brief Hands every queued request to the kernel.
+ * @return bool indicating whether the kernel took them, false if the ring
+ * failed and they ran blocking instead.
+ */
+bool IoRing::submit()
+{
+#if defined(HAVE_IO_URING)
+    while (ringFd >= 0 && unsubmitted > 0) {
+        const int submitted = ringEnter(ringFd, unsubmitted, 0, 0);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            abandon();
+            return false;
+        }
+        unsubmitted -= static_cast<unsigned int>(submitted);
+    }
+#endif
+    return true;
+}
+
+/**
+ * @brief Takes a finished request off the kernel's completion ring.
+ * @param completion Receives the request's tag and result.
+ * @return bool indicating whether a request had finished.
+ */
+bool IoRing::popRing(Completion& completion)
+{
+#if defined(HAVE_IO_URING)
+    if (ringFd >= 0) {
+        const unsigned int head = *cqHead;
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        const io_uring_cqe& cqe = static_cast<io_uring_cqe*>(cqes)[head & *cqMask];
+        completion.tag = cqe.user_data;
+        completion.result = cqe.res;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+#endif
+    (void)completion;
+    return false;
+}
+
+/**
+ * @brief Takes a finished request, blocking or from the kernel, if there is one.
+ * @param completion Receives the request's tag and result.
+ * @return bool indicating whether a request had finished.
+ */
+bool IoRing::reap(Completion& completion)
+{
+    if (!finished.empty()) {
+        completion = finished.front();
+        finished.pop_front();
+        pending--;
+        return true;
+    }
+    if (popRing(completion)) {
+        pending--;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Waits for the next request to finish, submitting any still queued.
+ * If the kernel ring fails, the requests it held still complete first.
+ * @param completion Receives the request's tag and result.
+ * @return bool indicating whether a request finished, false when nothing
+ * is pending.
+ */
+bool IoRing::wait(Completion& completion)
+{
+    while (pending > 0) {
+        if (reap(completion)) {
+            return true;
+        }
+        submit();
+#if defined(HAVE_IO_URING)
+        if (ringFd >= 0 && ringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            abandon();
+        }
+#endif
+        if (ringFd < 0 && finished.empty()) {
+            return false;
+        }
+    }
+    return false;
+}
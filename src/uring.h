@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    uring.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#ifndef URING_H
+#define URING_H
+
+/**
+ * @brief Minimal Linux io_uring for batched file reads and writes.
+ * Set up through the raw syscalls, so no liburing is needed. Requests are
+ * queued, handed to the kernel together by submit() and reaped one at a
+ * time by wait(). Where io_uring is unavailable (older kernels, other
+ * systems, or disabled by seccomp or sysctl) every request runs as a
+ * blocking pread/pwrite when it is queued, and completes just the same.
+ * Not thread safe: one thread owns the ring.
+ */
+class IoRing
+{
+public:
+    /**
+     * @brief Result of a finished request.
+     */
+    struct Completion {
+        uint64_t tag;
+        // Bytes transferred, or a negative errno
+        int result;
+    };
+
+    IoRing() = default;
+    ~IoRing();
+
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    bool init(unsigned int entries);
+    bool isAsync() const { return ringFd >= 0; }
+    bool hasSpace() const { return pending < entries; }
+    unsigned int getPending() const { return pending; }
+
+    void queueRead(int fd, void* buffer, unsigned int length, uint64_t offset, uint64_t tag);
+    void queueWrite(int fd, const void* buffer, unsigned int length, uint64_t offset, uint64_t tag);
+    bool submit();
+    bool wait(Completion& completion);
+
+private:
+    void queue(int opcode, int fd, void* buffer, unsigned int length, uint64_t offset, uint64_t tag);
+    bool popRing(Completion& completion);
+    bool reap(Completion& completion);
+    void abandon();
+
+    int ringFd = -1;
+    unsigned int entries = 1;
+    // Requests queued or in the kernel that have not been reaped yet
+    unsigned int pending = 0;
+    unsigned int unsubmitted = 0;
+
+    void* sqRing = nullptr;
+    size_t sqRingSize = 0;
+    void* cqRing = nullptr;
+    size_t cqRingSize = 0;
+    void* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    unsigned int* sqTail = nullptr;
+    unsigned int* sqMask = nullptr;
+    unsigned int* sqArray = nullptr;
+    unsigned int* cqHead = nullptr;
+    unsigned int* cqTail = nullptr;
+    unsigned int* cqMask = nullptr;
+    void* cqes = nullptr;
+
+    // Completions of the blocking fallback
+    std::deque<Completion> finished;
+};
+
+#endif /* URING_H */
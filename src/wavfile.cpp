@@ -0,0 +1,490 @@
+/*
+  ==============================================================================
+
+    wavfile.cpp
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include "wavfile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
+// Sony Wave64 GUIDs share this tail after their four character prefix
+static const unsigned char w64GuidTail[12] = {
+    0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A
+};
+
+static const unsigned char w64RiffGuid[16] = {
+    'r', 'i', 'f', 'f', 0x2E, 0x91, 0xCF, 0x11, 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00
+};
+
+static uint32_t readLE32(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint64_t readLE64(const unsigned char* p)
+{
+    return readLE32(p) | (static_cast<uint64_t>(readLE32(p + 4)) << 32);
+}
+
+static void writeLE16(unsigned char* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void writeLE32(unsigned char* p, uint32_t v)
+{
+    writeLE16(p, v & 0xFFFF);
+    writeLE16(p + 2, v >> 16);
+}
+
+static void writeBE16(unsigned char* p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+static void writeBE32(unsigned char* p, uint32_t v)
+{
+    writeBE16(p, v >> 16);
+    writeBE16(p + 2, v & 0xFFFF);
+}
+
+/**
+ * @brief Walks the chunks of a RIFF or RF64 file looking for the data chunk.
+ * @param file Stream positioned just after the 12 byte RIFF/RF64 header.
+ * @param isRF64 Whether the sizes come from the ds64 chunk.
+ * @param payload Receives the payload location.
+ * @return bool indicating whether a data chunk was found.
+ */
+static bool findRiffData(std::ifstream& file, bool isRF64, PcmPayload& payload)
+{
+    uint64_t rf64DataSize = 0;
+    unsigned char chunk[8];
+
+    while (file.read(reinterpret_cast<char*>(chunk), sizeof(chunk))) {
+        uint64_t size = readLE32(chunk + 4);
+
+        if (std::memcmp(chunk, "ds64", 4) == 0 && size >= 16) {
+            unsigned char ds64[16];
+            if (!file.read(reinterpret_cast<char*>(ds64), sizeof(ds64))) {
+                return false;
+            }
+            rf64DataSize = readLE64(ds64 + 8);
+            size -= sizeof(ds64);
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            payload.offset = static_cast<uint64_t>(file.tellg());
+            payload.length = (isRF64 && size == 0xFFFFFFFF) ? rf64DataSize : size;
+            return true;
+        }
+
+        // Chunks are padded to an even size
+        file.seekg(static_cast<std::streamoff>(size + (size & 1)), std::ios::cur);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Walks the chunks of a Sony Wave64 file looking for the data chunk.
+ * @param file Stream positioned just after the 40 byte Wave64 header.
+ * @param payload Receives the payload location.
+ * @return bool indicating whether a data chunk was found.
+ */
+static bool findW64Data(std::ifstream& file, PcmPayload& payload)
+{
+    unsigned char chunk[24];
+
+    while (file.read(reinterpret_cast<char*>(chunk), sizeof(chunk))) {
+        // Wave64 chunk sizes include the 24 byte chunk header
+        uint64_t size = readLE64(chunk + 16);
+        if (size < sizeof(chunk)) {
+            return false;
+        }
+
+        if (std::memcmp(chunk, "data", 4) == 0 && std::memcmp(chunk + 4, w64GuidTail, sizeof(w64GuidTail)) == 0) {
+            payload.offset = static_cast<uint64_t>(file.tellg());
+            payload.length = size - sizeof(chunk);
+            return true;
+        }
+
+        // Chunks are aligned to 8 bytes
+        uint64_t skip = ((size + 7) & ~static_cast<uint64_t>(7)) - sizeof(chunk);
+        file.seekg(static_cast<std::streamoff>(skip), std::ios::cur);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Locates the PCM payload of a little-endian RIFF-family file.
+ * Understands RIFF WAV, RF64 and Sony Wave64. Big-endian RIFX files
+ * and any other container are rejected.
+ * @param path Path of the file to inspect.
+ * @param payload Receives the container type and payload location.
+ * @return bool indicating whether the payload was found.
+ */
+bool findPcmPayload(const std::string& path, PcmPayload& payload)
+{
+    std::ifstream file(path, std::ios::binary);
+    unsigned char header[40];
+
+    if (!file.read(reinterpret_cast<char*>(header), 12)) {
+        return false;
+    }
+
+    if (std::memcmp(header, "RIFF", 4) == 0 && std::memcmp(header + 8, "WAVE", 4) == 0) {
+        payload.container = RiffContainer::WAV;
+        return findRiffData(file, false, payload);
+    }
+
+    if (std::memcmp(header, "RF64", 4) == 0 && std::memcmp(header + 8, "WAVE", 4) == 0) {
+        payload.container = RiffContainer::RF64;
+        return findRiffData(file, true, payload);
+    }
+
+    if (std::memcmp(header, w64RiffGuid, 12) == 0) {
+        if (!file.read(reinterpret_cast<char*>(header + 12), 28) || std::memcmp(header + 12, w64RiffGuid + 12, 4) != 0) {
+            return false;
+        }
+        payload.container = RiffContainer::W64;
+        return findW64Data(file, payload);
+    }
+
+    return false;
+}
+
+static uint16_t readLE16(const unsigned char* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint16_t readBE16(const unsigned char* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static uint32_t readBE32(const unsigned char* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/**
+ * @brief Decodes the 80 bit IEEE extended sample rate of an AIFF COMM chunk.
+ * @param p The ten bytes of the value.
+ * @return The value, 0 if it is not a usable rate.
+ */
+static double readExtended(const unsigned char* p)
+{
+    const int exponent = ((p[0] & 0x7F) << 8) | p[1];
+    const uint64_t mantissa = (static_cast<uint64_t>(readBE32(p + 2)) << 32) | readBE32(p + 6);
+    if ((p[0] & 0x80) || exponent == 0 || exponent == 0x7FFF) {
+        return 0.0;
+    }
+    return std::ldexp(static_cast<double>(mantissa), exponent - 16383 - 63);
+}
+
+/**
+ * @brief Gets the size of a single sample.
+ * @param encoding Sample encoding.
+ * @return Size of a sample, in bytes.
+ */
+int getBytesPerSample(SampleEncoding encoding)
+{
+    switch (encoding) {
+        case SampleEncoding::UInt8:
+        case SampleEncoding::Int8:
+            return 1;
+        case SampleEncoding::Int16:
+            return 2;
+        case SampleEncoding::Int24:
+            return 3;
+        default:
+            return 4;
+    }
+}
+
+/**
+ * @brief Maps a sample size in bits to an integer encoding.
+ * @param bits Bits per sample.
+ * @param unsigned8 Whether 8 bit samples are unsigned, as in WAV.
+ * @param encoding Receives the encoding.
+ * @return bool indicating whether the size is supported.
+ */
+static bool getIntEncoding(int bits, bool unsigned8, SampleEncoding& encoding)
+{
+    switch (bits) {
+        case 8:
+            encoding = unsigned8 ? SampleEncoding::UInt8 : SampleEncoding::Int8;
+            return true;
+        case 16:
+            encoding = SampleEncoding::Int16;
+            return true;
+        case 24:
+            encoding = SampleEncoding::Int24;
+            return true;
+        case 32:
+            encoding = SampleEncoding::Int32;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Parses the chunks of an in-memory RIFF or RF64 WAV file.
+ * @param data The whole file.
+ * @param size Size of the file, in bytes.
+ * @param isRF64 Whether the sizes come from the ds64 chunk.
+ * @param layout Receives the format and payload location.
+ * @return bool indicating whether a supported fmt and data chunk were found.
+ */
+static bool parseRiff(const unsigned char* data, uint64_t size, bool isRF64, PcmLayout& layout)
+{
+    uint64_t rf64DataSize = 0;
+    bool haveFormat = false;
+
+    for (uint64_t pos = 12; pos + 8 <= size;) {
+        const unsigned char* chunk = data + pos;
+        uint64_t length = readLE32(chunk + 4);
+        pos += 8;
+
+        if (std::memcmp(chunk, "ds64", 4) == 0 && length >= 16 && pos + 16 <= size) {
+            rf64DataSize = readLE64(chunk + 16);
+        } else if (std::memcmp(chunk, "fmt ", 4) == 0 && length >= 16 && pos + length <= size) {
+            const unsigned char* fmt = chunk + 8;
+            int tag = readLE16(fmt);
+            const int bits = readLE16(fmt + 14);
+            const int blockAlign = readLE16(fmt + 12);
+
+            // WAVE_FORMAT_EXTENSIBLE keeps the real tag at the start of its GUID
+            if (tag == 0xFFFE && length >= 26) {
+                tag = readLE16(fmt + 24);
+            }
+
+            layout.channels = readLE16(fmt + 2);
+            layout.sampleRate = static_cast<int>(readLE32(fmt + 4));
+            if (tag == 1) {
+                haveFormat = getIntEncoding(bits, true, layout.encoding);
+            } else if (tag == 3 && bits == 32) {
+                layout.encoding = SampleEncoding::Float32;
+                haveFormat = true;
+            }
+            // Padded containers such as 24 in 32 bit are left to libsndfile
+            if (haveFormat && blockAlign != layout.channels * getBytesPerSample(layout.encoding)) {
+                haveFormat = false;
+            }
+            if (!haveFormat) {
+                return false;
+            }
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            layout.offset = pos;
+            layout.length = (isRF64 && length == 0xFFFFFFFF) ? rf64DataSize : length;
+            layout.bigEndian = false;
+            layout.aiff = false;
+            return haveFormat;
+        }
+
+        // Chunks are padded to an even size
+        pos += length + (length & 1);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Parses the chunks of an in-memory AIFF or AIFF-C file.
+ * @param data The whole file.
+ * @param size Size of the file, in bytes.
+ * @param isAIFC Whether the COMM chunk carries a compression type.
+ * @param layout Receives the format and payload location.
+ * @return bool indicating whether a supported COMM and SSND chunk were found.
+ */
+static bool parseAiff(const unsigned char* data, uint64_t size, bool isAIFC, PcmLayout& layout)
+{
+    bool haveFormat = false;
+
+    for (uint64_t pos = 12; pos + 8 <= size;) {
+        const unsigned char* chunk = data + pos;
+        uint64_t length = readBE32(chunk + 4);
+        pos += 8;
+
+        if (std::memcmp(chunk, "COMM", 4) == 0 && length >= 18 && pos + length <= size) {
+            const unsigned char* comm = chunk + 8;
+            const int bits = readBE16(comm + 6);
+            layout.channels = readBE16(comm);
+            layout.sampleRate = static_cast<int>(std::lround(readExtended(comm + 8)));
+            layout.bigEndian = true;
+
+            if (!isAIFC || (length >= 22 && (std::memcmp(comm + 18, "NONE", 4) == 0 ||
+                                             std::memcmp(comm + 18, "twos", 4) == 0))) {
+                haveFormat = getIntEncoding(bits, false, layout.encoding);
+            } else if (length >= 22 && std::memcmp(comm + 18, "sowt", 4) == 0) {
+                layout.bigEndian = false;
+                haveFormat = getIntEncoding(bits, false, layout.encoding);
+            } else if (length >= 22 && (std::memcmp(comm + 18, "fl32", 4) == 0 ||
+                                        std::memcmp(comm + 18, "FL32", 4) == 0)) {
+                layout.encoding = SampleEncoding::Float32;
+                haveFormat = true;
+            }
+            if (!haveFormat) {
+                return false;
+            }
+        } else if (std::memcmp(chunk, "SSND", 4) == 0 && length >= 8 && pos + 8 <= size) {
+            // The payload starts after the offset and block size fields plus the offset itself
+            const uint64_t skip = 8 + static_cast<uint64_t>(readBE32(chunk + 8));
+            if (skip > length) {
+                return false;
+            }
+            layout.offset = pos + skip;
+            layout.length = length - skip;
+            layout.aiff = true;
+            return haveFormat;
+        }
+
+        pos += length + (length & 1);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Parses the header of an uncompressed RIFF, RF64 or AIFF file.
+ * The payload length is clamped to what the file actually holds, so a
+ * truncated file reads as far as it goes.
+ * @param data The whole file, usually a read-only mapping, or just its start.
+ * @param size Size of data, in bytes.
+ * @param layout Receives the format and payload location.
+ * @param fileSize Size of the whole file when data only holds its start, 0 if data is the whole file.
+ * @return bool indicating whether the file can be decoded natively.
+ */
+bool parsePcmLayout(const unsigned char* data, uint64_t size, PcmLayout& layout, uint64_t fileSize)
+{
+    if (size < 12) {
+        return false;
+    }
+
+    bool ok = false;
+    if (std::memcmp(data, "RIFF", 4) == 0 && std::memcmp(data + 8, "WAVE", 4) == 0) {
+        ok = parseRiff(data, size, false, layout);
+    } else if (std::memcmp(data, "RF64", 4) == 0 && std::memcmp(data + 8, "WAVE", 4) == 0) {
+        ok = parseRiff(data, size, true, layout);
+    } else if (std::memcmp(data, "FORM", 4) == 0 && std::memcmp(data + 8, "AIFF", 4) == 0) {
+        ok = parseAiff(data, size, false, layout);
+    } else if (std::memcmp(data, "FORM", 4) == 0 && std::memcmp(data + 8, "AIFC", 4) == 0) {
+        ok = parseAiff(data, size, true, layout);
+    }
+
+    const uint64_t total = fileSize > 0 ? fileSize : size;
+    if (!ok || layout.channels < 1 || layout.sampleRate < 1 || layout.offset > total) {
+        return false;
+    }
+
+    layout.length = std::min(layout.length, total - layout.offset);
+    return true;
+}
+
+/**
+ * @brief Fills in a canonical 44 byte PCM WAV header.
+ * @param header Buffer of at least wavHeaderSize bytes.
+ * @param sampleRate Sample rate of the payload.
+ * @param channels Number of interleaved channels.
+ * @param bitsPerSample Bits per sample of the PCM payload.
+ * @param dataBytes Length of the payload that follows the header.
+ * @return bool indicating whether the header was filled in. Payloads that
+ * do not fit a 32 bit RIFF size are refused.
+ */
+bool fillWavHeader(unsigned char* header, int sampleRate, int channels, int bitsPerSample, uint64_t dataBytes)
+{
+    if (dataBytes > 0xFFFFFFFFull - 37) {
+        return false;
+    }
+
+    const int blockAlign = channels * (bitsPerSample / 8);
+
+    // An odd sized data chunk is followed by a pad byte
+    std::memcpy(header, "RIFF", 4);
+    writeLE32(header + 4, static_cast<uint32_t>(36 + dataBytes + (dataBytes & 1)));
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    writeLE32(header + 16, 16);
+    writeLE16(header + 20, 1);
+    writeLE16(header + 22, static_cast<uint16_t>(channels));
+    writeLE32(header + 24, static_cast<uint32_t>(sampleRate));
+    writeLE32(header + 28, static_cast<uint32_t>(sampleRate * blockAlign));
+    writeLE16(header + 32, static_cast<uint16_t>(blockAlign));
+    writeLE16(header + 34, static_cast<uint16_t>(bitsPerSample));
+    std::memcpy(header + 36, "data", 4);
+    writeLE32(header + 40, static_cast<uint32_t>(dataBytes));
+    return true;
+}
+
+/**
+ * @brief Fills in a minimal 54 byte AIFF header (COMM and SSND chunks).
+ * @param header Buffer of at least aiffHeaderSize bytes.
+ * @param sampleRate Sample rate of the payload.
+ * @param channels Number of interleaved channels.
+ * @param bitsPerSample Bits per sample of the big-endian PCM payload.
+ * @param dataBytes Length of the payload that follows the header.
+ * @return bool indicating whether the header was filled in. Payloads that
+ * do not fit a 32 bit FORM size are refused.
+ */
+bool fillAiffHeader(unsigned char* header, int sampleRate, int channels, int bitsPerSample, uint64_t dataBytes)
+{
+    if (dataBytes > 0xFFFFFFFFull - 47 || sampleRate <= 0) {
+        return false;
+    }
+
+    const int frameBytes = channels * (bitsPerSample / 8);
+
+    std::memcpy(header, "FORM", 4);
+    writeBE32(header + 4, static_cast<uint32_t>(46 + dataBytes + (dataBytes & 1)));
+    std::memcpy(header + 8, "AIFFCOMM", 8);
+    writeBE32(header + 16, 18);
+    writeBE16(header + 20, static_cast<uint16_t>(channels));
+    writeBE32(header + 22, static_cast<uint32_t>(dataBytes / frameBytes));
+    writeBE16(header + 26, static_cast<uint16_t>(bitsPerSample));
+
+    // The sample rate is an 80 bit IEEE extended float with an explicit integer bit
+    int exponent = 31;
+    while ((static_cast<uint32_t>(sampleRate) & (1u << exponent)) == 0) {
+        exponent--;
+    }
+    writeBE16(header + 28, static_cast<uint16_t>(16383 + exponent));
+    const uint64_t mantissa = static_cast<uint64_t>(sampleRate) << (63 - exponent);
+    writeBE32(header + 30, static_cast<uint32_t>(mantissa >> 32));
+    writeBE32(header + 34, static_cast<uint32_t>(mantissa));
+
+    std::memcpy(header + 38, "SSND", 4);
+    writeBE32(header + 42, static_cast<uint32_t>(8 + dataBytes));
+    writeBE32(header + 46, 0);
+    writeBE32(header + 50, 0);
+    return true;
+}
+
+/**
+ * @brief Writes a canonical 44 byte PCM WAV header.
+ * @param fd File descriptor to write the header to, at its current position.
+ * @param sampleRate Sample rate of the payload.
+ * @param channels Number of interleaved channels.
+ * @param bitsPerSample Bits per sample of the PCM payload.
+ * @param dataBytes Length of the payload that follows the header.
+ * @return bool indicating whether the header was written. Payloads that do
+ * not fit a 32 bit RIFF size are refused.
+ */
+bool writeWavHeader(int fd, int sampleRate, int channels, int bitsPerSample, uint64_t dataBytes)
+{
+    unsigned char header[wavHeaderSize];
+    if (!fillWavHeader(header, sampleRate, channels, bitsPerSample, dataBytes)) {
+        return false;
+    }
+
+    return write(fd, header, sizeof(header)) == static_cast<ssize_t>(sizeof(header));
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    wavfile.h
+    Created: 14/10/2026
+    Author:  David Winton
+
+  ==============================================================================
+*/
+
+#include <cstdint>
+#include <string>
+
+#ifndef WAVFILE_H
+#define WAVFILE_H
+
+/**
+ * @brief RIFF-family containers understood by findPcmPayload.
+ */
+enum class RiffContainer {
+    WAV,
+    RF64,
+    W64
+};
+
+/**
+ * @brief Location of the little-endian PCM payload inside a RIFF-family file.
+ */
+struct PcmPayload {
+    RiffContainer container;
+    uint64_t offset;
+    uint64_t length;
+};
+
+/**
+ * @brief Encoding of the samples of an uncompressed payload.
+ */
+enum class SampleEncoding {
+    UInt8,
+    Int8,
+    Int16,
+    Int24,
+    Int32,
+    Float32
+};
+
+/**
+ * @brief Format and location of an uncompressed PCM payload.
+ */
+struct PcmLayout {
+    int sampleRate;
+    int channels;
+    SampleEncoding encoding;
+    bool bigEndian;
+    bool aiff;
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Size of the canonical header written by fillWavHeader
+static const int wavHeaderSize = 44;
+
+// Size of the header written by fillAiffHeader
+static const int aiffHeaderSize = 54;
+
+bool findPcmPayload(const std::string& path, PcmPayload& payload);
+bool parsePcmLayout(const unsigned char* data, uint64_t size, PcmLayout& layout, uint64_t fileSize = 0);
+int getBytesPerSample(SampleEncoding encoding);
+bool fillWavHeader(unsigned char* header, int sampleRate, int channels, int bitsPerSample, uint64_t dataBytes);
+bool fillAiffHeader(unsigned char* header, int sampleRate, int channels, int bitsPerSample, uint64_t dataBytes);
+bool writeWavHeader(int fd, int sampleRate, int channels, int bitsPerSample, uint64_t dataBytes);
+
+#endif /* WAVFILE_H */